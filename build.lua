@@ -14,4 +14,8 @@ group "tome_engine"
 	include "tome_engine/build_tome_engine.lua"
 group ""
 
+group "tools"
+	include "tome_shaderc/build_tome_shaderc.lua"
+group ""
+
 include "tome_app/build_tome_app.lua"
\ No newline at end of file
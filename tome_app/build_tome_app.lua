@@ -55,4 +55,9 @@ project "tome_app"
        defines { "DIST" }
        runtime "Release"
        optimize "On"
-       symbols "Off"
\ No newline at end of file
+       symbols "Off"
+       dependson { "tome_shaderc" }
+       postbuildcommands {
+           "{MKDIR} %{cfg.targetdir}/shaders",
+           "\"../binaries/" .. OutputDir .. "/tome_shaderc/tome_shaderc\" ../tome_engine/shaders %{cfg.targetdir}/shaders/tome_shaders.pak"
+       }
\ No newline at end of file
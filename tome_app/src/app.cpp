@@ -1,10 +1,19 @@
 #include "engine/engine.h"
 
-int main()
+int main(int argc, char **argv)
 {
     Engine engine;
 
-    engine.Init();
+    // the first argument is a glTF scene to draw, the second a KTX2 texture to stream onto it
+    EngineConfig config;
+    if (argc > 1) {
+        config.scenePath = argv[1];
+    }
+    if (argc > 2) {
+        config.texturePath = argv[2];
+    }
+
+    engine.Init(config);
 
     engine.Run();
 
@@ -36,7 +36,6 @@ project "tome_engine"
       "spdlog",
       "vk-bootstrap",
       "glfw",
-      "$(VULKAN_SDK)/lib/slang"
    }
 
    targetdir ("../binaries/" .. OutputDir .. "/%{prj.name}")
@@ -49,6 +48,10 @@ project "tome_engine"
            "/utf-8"
        }
 
+   -- Dist loads precompiled shaders from the tome_shaderc archive and never links slang
+   filter "configurations:not Dist"
+       links { "$(VULKAN_SDK)/lib/slang" }
+
    filter "configurations:Debug"
        defines { "DEBUG" }
        runtime "Debug"
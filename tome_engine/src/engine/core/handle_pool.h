@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// 32 bit reference into a HandlePool: slot index in the low bits, slot generation in the high bits.
+// Tag only keeps handles of different pools from converting into each other.
+// A default constructed handle is invalid, generation 0 is never handed out.
+template<typename Tag>
+class Handle {
+public:
+    static constexpr uint32_t INDEX_BITS = 20;
+    static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+    constexpr Handle() = default;
+    constexpr Handle(uint32_t index, uint32_t generation)
+        : _value((generation & GENERATION_MASK) << INDEX_BITS | (index & INDEX_MASK)) {}
+
+    constexpr uint32_t Index() const { return _value & INDEX_MASK; }
+    constexpr uint32_t Generation() const { return _value >> INDEX_BITS; }
+    constexpr uint32_t Value() const { return _value; }
+
+    // Only tells apart default constructed handles, use HandlePool::IsValid to detect stale ones.
+    constexpr bool IsNull() const { return _value == 0; }
+
+    constexpr bool operator==(const Handle &) const = default;
+
+private:
+    uint32_t _value = 0;
+};
+
+template<typename Tag>
+struct std::hash<Handle<Tag>> {
+    size_t operator()(const Handle<Tag> &handle) const noexcept { return std::hash<uint32_t>{}(handle.Value()); }
+};
+
+// Generational pool storing one dense array per component (SoA). Handles index a sparse slot array
+// which maps to the dense position, destroying swaps the last element into the hole so that the
+// component arrays never contain gaps and ForEach walks them linearly.
+//
+// Create and Destroy are O(1), freed slots are recycled through a free list with their generation
+// bumped, so handles to destroyed elements fail IsValid and Get returns nullptr for them.
+template<typename Tag, typename... Components>
+class HandlePool {
+public:
+    using HandleType = Handle<Tag>;
+
+    HandleType Create(Components... components) {
+        uint32_t index;
+        if (!_freeIndices.empty()) {
+            index = _freeIndices.back();
+            _freeIndices.pop_back();
+        } else {
+            if (_slots.size() > HandleType::INDEX_MASK) {
+                return {};
+            }
+            index = static_cast<uint32_t>(_slots.size());
+            _slots.push_back({ .dense = INVALID_DENSE, .generation = 1 });
+        }
+
+        Slot &slot = _slots[index];
+        slot.dense = static_cast<uint32_t>(_denseToIndex.size());
+        _denseToIndex.push_back(index);
+        std::apply([&](auto &...arrays) { (arrays.push_back(std::move(components)), ...); }, _components);
+
+        return HandleType(index, slot.generation);
+    }
+
+    // Returns false for stale or null handles.
+    bool Destroy(HandleType handle) {
+        if (!IsValid(handle)) {
+            return false;
+        }
+
+        Slot &slot = _slots[handle.Index()];
+        const uint32_t dense = slot.dense;
+        const uint32_t last = static_cast<uint32_t>(_denseToIndex.size()) - 1;
+
+        if (dense != last) {
+            std::apply([&](auto &...arrays) { ((arrays[dense] = std::move(arrays[last])), ...); }, _components);
+            _denseToIndex[dense] = _denseToIndex[last];
+            _slots[_denseToIndex[dense]].dense = dense;
+        }
+        std::apply([](auto &...arrays) { (arrays.pop_back(), ...); }, _components);
+        _denseToIndex.pop_back();
+
+        slot.dense = INVALID_DENSE;
+        // generation 0 is reserved for null handles
+        slot.generation = (slot.generation + 1) & HandleType::GENERATION_MASK;
+        if (slot.generation == 0) {
+            slot.generation = 1;
+        }
+        _freeIndices.push_back(handle.Index());
+        return true;
+    }
+
+    bool IsValid(HandleType handle) const {
+        if (handle.Index() >= _slots.size()) {
+            return false;
+        }
+        const Slot &slot = _slots[handle.Index()];
+        return slot.dense != INVALID_DENSE && slot.generation == handle.Generation();
+    }
+
+    // Component I of the element, nullptr for stale handles. Only valid until the next Create or Destroy.
+    template<size_t I>
+    auto *Get(HandleType handle) {
+        return IsValid(handle) ? &std::get<I>(_components)[_slots[handle.Index()].dense] : nullptr;
+    }
+
+    template<size_t I>
+    const auto *Get(HandleType handle) const {
+        return IsValid(handle) ? &std::get<I>(_components)[_slots[handle.Index()].dense] : nullptr;
+    }
+
+    // Dense array of component I, in no particular order.
+    template<size_t I>
+    const auto &GetArray() const {
+        return std::get<I>(_components);
+    }
+
+    // Calls function(handle, components...) for every live element.
+    template<typename Function>
+    void ForEach(Function &&function) {
+        for (uint32_t dense = 0; dense < _denseToIndex.size(); dense++) {
+            const uint32_t index = _denseToIndex[dense];
+            std::apply([&](auto &...arrays) {
+                function(HandleType(index, _slots[index].generation), arrays[dense]...);
+            },
+                _components);
+        }
+    }
+
+    uint32_t Size() const { return static_cast<uint32_t>(_denseToIndex.size()); }
+
+    void Clear() {
+        while (!_denseToIndex.empty()) {
+            const uint32_t index = _denseToIndex.back();
+            Destroy(HandleType(index, _slots[index].generation));
+        }
+    }
+
+private:
+    static constexpr uint32_t INVALID_DENSE = ~0u;
+
+    struct Slot {
+        uint32_t dense;
+        uint32_t generation;
+    };
+
+    std::vector<Slot> _slots;
+    std::vector<uint32_t> _freeIndices;
+    std::vector<uint32_t> _denseToIndex;
+    std::tuple<std::vector<Components>...> _components;
+};
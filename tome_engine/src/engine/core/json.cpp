@@ -0,0 +1,297 @@
+#include "json.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+#include "spdlog/spdlog.h"
+
+// deeper documents are rejected instead of overflowing the stack
+static constexpr uint32_t MAX_DEPTH = 256;
+
+static const JsonValue NULL_VALUE = {};
+
+// Recursive descent over RFC 8259 JSON, failing on the first error.
+class JsonParser {
+public:
+    explicit JsonParser(std::string_view text) : _text(text) {}
+
+    std::optional<JsonValue> Parse() {
+        JsonValue root;
+        if (!ParseValue(root, 0)) {
+            spdlog::error("Invalid JSON at offset {}: {}", _position, _error);
+            return std::nullopt;
+        }
+        SkipWhitespace();
+        if (_position != _text.size()) {
+            spdlog::error("Invalid JSON at offset {}: trailing characters", _position);
+            return std::nullopt;
+        }
+        return root;
+    }
+
+private:
+    std::string_view _text;
+    size_t _position = 0;
+    const char *_error = "";
+
+    bool Fail(const char *error) {
+        _error = error;
+        return false;
+    }
+
+    void SkipWhitespace() {
+        while (_position < _text.size() && (_text[_position] == ' ' || _text[_position] == '\t' ||
+                                               _text[_position] == '\n' || _text[_position] == '\r')) {
+            _position++;
+        }
+    }
+
+    bool Consume(std::string_view literal) {
+        if (_text.substr(_position, literal.size()) != literal) {
+            return false;
+        }
+        _position += literal.size();
+        return true;
+    }
+
+    bool ParseValue(JsonValue &value, uint32_t depth) {
+        if (depth > MAX_DEPTH) {
+            return Fail("nested too deeply");
+        }
+
+        SkipWhitespace();
+        if (_position == _text.size()) {
+            return Fail("unexpected end");
+        }
+
+        switch (_text[_position]) {
+        case '{':
+            return ParseObject(value, depth);
+        case '[':
+            return ParseArray(value, depth);
+        case '"':
+            value._type = JsonValue::Type::String;
+            return ParseString(value._string);
+        case 't':
+        case 'f':
+            value._type = JsonValue::Type::Bool;
+            value._bool = _text[_position] == 't';
+            return Consume(value._bool ? "true" : "false") || Fail("invalid literal");
+        case 'n':
+            return Consume("null") || Fail("invalid literal");
+        default:
+            return ParseNumber(value);
+        }
+    }
+
+    bool ParseObject(JsonValue &value, uint32_t depth) {
+        value._type = JsonValue::Type::Object;
+        _position++;
+
+        SkipWhitespace();
+        if (Consume("}")) {
+            return true;
+        }
+
+        while (true) {
+            SkipWhitespace();
+            std::string &key = value._keys.emplace_back();
+            if (_position == _text.size() || _text[_position] != '"' || !ParseString(key)) {
+                return Fail("expected member name");
+            }
+
+            SkipWhitespace();
+            if (!Consume(":")) {
+                return Fail("expected ':'");
+            }
+            if (!ParseValue(value._elements.emplace_back(), depth + 1)) {
+                return false;
+            }
+
+            SkipWhitespace();
+            if (Consume("}")) {
+                return true;
+            }
+            if (!Consume(",")) {
+                return Fail("expected ',' or '}'");
+            }
+        }
+    }
+
+    bool ParseArray(JsonValue &value, uint32_t depth) {
+        value._type = JsonValue::Type::Array;
+        _position++;
+
+        SkipWhitespace();
+        if (Consume("]")) {
+            return true;
+        }
+
+        while (true) {
+            if (!ParseValue(value._elements.emplace_back(), depth + 1)) {
+                return false;
+            }
+
+            SkipWhitespace();
+            if (Consume("]")) {
+                return true;
+            }
+            if (!Consume(",")) {
+                return Fail("expected ',' or ']'");
+            }
+        }
+    }
+
+    bool ParseNumber(JsonValue &value) {
+        // from_chars takes neither a leading '+' nor "inf" and "nan", which JSON forbids as well
+        const char *begin = _text.data() + _position;
+        const char *end = _text.data() + _text.size();
+        if (*begin == '+' || (*begin != '-' && (*begin < '0' || *begin > '9'))) {
+            return Fail("unexpected character");
+        }
+
+        const auto [pointer, error] = std::from_chars(begin, end, value._number);
+        if (error != std::errc() || !std::isfinite(value._number)) {
+            return Fail("invalid number");
+        }
+        value._type = JsonValue::Type::Number;
+        _position += pointer - begin;
+        return true;
+    }
+
+    bool ParseHex4(uint32_t &codePoint) {
+        if (_position + 4 > _text.size()) {
+            return Fail("truncated escape");
+        }
+        codePoint = 0;
+        for (uint32_t i = 0; i < 4; i++) {
+            const char c = _text[_position++];
+            codePoint <<= 4;
+            if (c >= '0' && c <= '9') {
+                codePoint |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                codePoint |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                codePoint |= c - 'A' + 10;
+            } else {
+                return Fail("invalid escape");
+            }
+        }
+        return true;
+    }
+
+    static void AppendUtf8(std::string &string, uint32_t codePoint) {
+        if (codePoint < 0x80) {
+            string += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            string += static_cast<char>(0xC0 | (codePoint >> 6));
+            string += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            string += static_cast<char>(0xE0 | (codePoint >> 12));
+            string += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            string += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            string += static_cast<char>(0xF0 | (codePoint >> 18));
+            string += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            string += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            string += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    bool ParseString(std::string &string) {
+        _position++;
+        while (_position < _text.size()) {
+            const char c = _text[_position++];
+            if (c == '"') {
+                return true;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                return Fail("control character in string");
+            }
+            if (c != '\\') {
+                string += c;
+                continue;
+            }
+
+            if (_position == _text.size()) {
+                break;
+            }
+            switch (_text[_position++]) {
+            case '"':
+                string += '"';
+                break;
+            case '\\':
+                string += '\\';
+                break;
+            case '/':
+                string += '/';
+                break;
+            case 'b':
+                string += '\b';
+                break;
+            case 'f':
+                string += '\f';
+                break;
+            case 'n':
+                string += '\n';
+                break;
+            case 'r':
+                string += '\r';
+                break;
+            case 't':
+                string += '\t';
+                break;
+            case 'u': {
+                uint32_t codePoint;
+                if (!ParseHex4(codePoint)) {
+                    return false;
+                }
+                // characters outside the basic plane are escaped as a surrogate pair
+                if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+                    uint32_t low;
+                    if (!Consume("\\u") || !ParseHex4(low) || low < 0xDC00 || low >= 0xE000) {
+                        return Fail("unpaired surrogate");
+                    }
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                } else if (codePoint >= 0xDC00 && codePoint < 0xE000) {
+                    return Fail("unpaired surrogate");
+                }
+                AppendUtf8(string, codePoint);
+                break;
+            }
+            default:
+                return Fail("invalid escape");
+            }
+        }
+        return Fail("unterminated string");
+    }
+};
+
+std::optional<JsonValue> JsonValue::Parse(std::string_view text) {
+    return JsonParser(text).Parse();
+}
+
+uint32_t JsonValue::AsUint(uint32_t fallback) const {
+    if (_type != Type::Number || _number < 0.0 || _number > double(UINT32_MAX) || std::floor(_number) != _number) {
+        return fallback;
+    }
+    return static_cast<uint32_t>(_number);
+}
+
+const JsonValue &JsonValue::operator[](size_t index) const {
+    return _type == Type::Array && index < _elements.size() ? _elements[index] : NULL_VALUE;
+}
+
+const JsonValue &JsonValue::operator[](std::string_view key) const {
+    for (size_t i = 0; i < _keys.size(); i++) {
+        if (_keys[i] == key) {
+            return _elements[i];
+        }
+    }
+    return NULL_VALUE;
+}
+
+bool JsonValue::Contains(std::string_view key) const {
+    return std::find(_keys.begin(), _keys.end(), key) != _keys.end();
+}
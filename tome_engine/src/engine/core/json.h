@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read only JSON document, enough for asset formats like glTF. Lookups of missing members or
+// out of range elements return a null value, so optional fields read as their default.
+class JsonValue {
+public:
+    enum class Type : uint8_t {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object,
+    };
+
+    // Nullopt and an error log on malformed input.
+    static std::optional<JsonValue> Parse(std::string_view text);
+
+    Type GetType() const { return _type; }
+    bool IsNull() const { return _type == Type::Null; }
+    bool IsNumber() const { return _type == Type::Number; }
+    bool IsString() const { return _type == Type::String; }
+    bool IsArray() const { return _type == Type::Array; }
+    bool IsObject() const { return _type == Type::Object; }
+
+    bool AsBool(bool fallback = false) const { return _type == Type::Bool ? _bool : fallback; }
+    double AsNumber(double fallback = 0.0) const { return _type == Type::Number ? _number : fallback; }
+    float AsFloat(float fallback = 0.f) const { return static_cast<float>(AsNumber(fallback)); }
+    // fallback for negative and fractional numbers too
+    uint32_t AsUint(uint32_t fallback = 0) const;
+    const std::string &AsString() const { return _string; }
+
+    // elements of an array, members of an object
+    size_t Size() const { return _elements.size(); }
+    const JsonValue &operator[](size_t index) const;
+    const JsonValue &operator[](std::string_view key) const;
+    bool Contains(std::string_view key) const;
+
+    const std::vector<JsonValue> &GetElements() const { return _elements; }
+    // object member names, in the order of GetElements
+    const std::vector<std::string> &GetKeys() const { return _keys; }
+
+private:
+    friend class JsonParser;
+
+    Type _type = Type::Null;
+    bool _bool = false;
+    double _number = 0.0;
+    std::string _string;
+    std::vector<JsonValue> _elements;
+    std::vector<std::string> _keys;
+};
@@ -0,0 +1,45 @@
+#include "thread_pool.h"
+
+void ThreadPool::Init(uint32_t threadCount) {
+    _stopping = false;
+    for (uint32_t i = 0; i < threadCount; i++) {
+        _workers.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+void ThreadPool::Shutdown() {
+    {
+        std::lock_guard lock(_mutex);
+        _stopping = true;
+    }
+    _condition.notify_all();
+
+    for (std::thread &worker : _workers) {
+        worker.join();
+    }
+    _workers.clear();
+}
+
+void ThreadPool::Submit(std::function<void()> &&job) {
+    {
+        std::lock_guard lock(_mutex);
+        _jobs.push_back(std::move(job));
+    }
+    _condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(_mutex);
+            _condition.wait(lock, [this]() { return _stopping || !_jobs.empty(); });
+            if (_jobs.empty()) {
+                return;
+            }
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+        job();
+    }
+}
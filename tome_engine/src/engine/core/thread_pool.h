@@ -0,0 +1,28 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads consuming a FIFO of jobs.
+class ThreadPool {
+public:
+    void Init(uint32_t threadCount);
+
+    // Runs every job still queued, then joins the workers.
+    void Shutdown();
+
+    void Submit(std::function<void()> &&job);
+
+private:
+    std::vector<std::thread> _workers;
+    std::deque<std::function<void()>> _jobs;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _stopping = false;
+
+    void WorkerLoop();
+};
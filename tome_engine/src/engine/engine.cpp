@@ -5,23 +5,28 @@
 #define VMA_IMPLEMENTATION
 #include "vk_mem_alloc.h"
 #define GLFW_INCLUDE_VULKAN
+#include <algorithm>
 #include <fstream>
 
 #include "GLFW/glfw3.h"
+#include "rendering/vulkan/vk_benchmarks.h"
 #include "rendering/vulkan/vk_images.h"
 #include "rendering/vulkan/vk_initializers.h"
 #include "rendering/vulkan/vk_pipelines.h"
 #include "spdlog/spdlog.h"
+#ifndef DIST
 #include "slang/slang.h"
 #include "slang/slang-com-ptr.h"
+#endif
 
 constexpr bool USE_VALIDATION_LAYERS = true;
+constexpr bool RUN_BENCHMARKS = false;
 
 static Engine *LOADED_ENGINE = nullptr;
 
 Engine &Engine::Get() { return *LOADED_ENGINE; }
 
-void Engine::Init() {
+void Engine::Init(const EngineConfig &config) {
     assert(!LOADED_ENGINE);
     LOADED_ENGINE = this;
 
@@ -49,13 +54,32 @@ void Engine::Init() {
     InitSwapchain();
     InitCommands();
     InitSyncStructures();
+    InitBuffers();
 
     InitDescriptors();
 
+    // leave one core for the render thread
+    _threadPool.Init(std::max(2u, std::thread::hardware_concurrency()) - 1);
+
+    InitUploads();
+
     InitShaderCompiler();
     InitPipelines();
 
+    InitDefaultData();
+
+    if (!config.scenePath.empty()) {
+        _scene = LoadGltf(config.scenePath);
+    }
+    if (!config.texturePath.empty()) {
+        _meshTexture = _textureStreamer.Register(config.texturePath);
+    }
+
     _isInitialized = true;
+
+    if (RUN_BENCHMARKS) {
+        RunBenchmarks();
+    }
 }
 
 void Engine::Cleanup() {
@@ -65,6 +89,9 @@ void Engine::Cleanup() {
 
     vkDeviceWaitIdle(_device);
 
+    // finish background compiles before anything they use is destroyed
+    _threadPool.Shutdown();
+
     for (FrameData &frame : _frames) {
         vkDestroyCommandPool(_device, frame.commandPool, nullptr);
         vkDestroyFence(_device, frame.renderFence, nullptr);
@@ -94,8 +121,17 @@ void Engine::Draw() {
     // wait until gpu has finished rendering last frame
     VK_CHECK(vkWaitForFences(_device, 1, &currentFrame.renderFence, true, 1000000000));
     currentFrame.deletionQueue.Flush();
+    currentFrame.frameDescriptors.ClearPools(_device);
+    currentFrame.frameDescriptorSets.Clear();
+    _memoryBudget.Update(_frameNumber);
+    _frameRing.BeginFrame(_frameNumber % FRAME_OVERLAP);
+    _textureStreamer.Update(_frameNumber % FRAME_OVERLAP, _frameNumber);
+    _mipGenerator.BeginFrame(_frameNumber % FRAME_OVERLAP);
+    _readbacks.BeginFrame(_frameNumber % FRAME_OVERLAP, _frameNumber);
     VK_CHECK(vkResetFences(_device, 1, &currentFrame.renderFence));
 
+    _pipelineLibrary.Update(currentFrame.deletionQueue);
+
     uint32_t swapchainImageIndex;
     VK_CHECK(
         vkAcquireNextImageKHR(_device,_swapchain,1000000000, currentFrame.swapchainSemaphore, nullptr, &
@@ -108,30 +144,62 @@ void Engine::Draw() {
     const VkCommandBufferBeginInfo cmdBeginInfo = vk::CommandBufferBeginInfo(
         VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
-    _drawExtent.width = _drawImage.imageExtent.width;
-    _drawExtent.height = _drawImage.imageExtent.height;
+    const VkExtent3D drawImageExtent = _resources.GetImageExtent(_drawImage);
+    _drawExtent.width = drawImageExtent.width;
+    _drawExtent.height = drawImageExtent.height;
+    const VkImage drawImage = _resources.GetImage(_drawImage);
 
     VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
 
-    vk::TransitionImage(cmd, _drawImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    _defragmentation.Update(cmd, _frameNumber);
+
+    // never waits, textures whose upload finished become usable from this frame on
+    _uploadQueue.Update(cmd);
+    _textureLoader.Update();
+
+    _transientImages.BeginUse(cmd,
+        _drawImageId,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
 
     DrawBackground(cmd);
 
-    vk::TransitionImage(cmd, _drawImage.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    // the pool knows the background was a compute write, so these wait on exactly that
+    _resources.TransitionImage(cmd,
+        _drawImage,
+        { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+          VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+          VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT });
+
+    DrawGeometry(cmd);
+
+    _resources.TransitionImage(cmd,
+        _drawImage,
+        { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT });
     vk::TransitionImage(cmd,
         _swapchainImages[swapchainImageIndex],
         VK_IMAGE_LAYOUT_UNDEFINED,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
-    vk::CopyImageToImage(cmd, _drawImage.image, _swapchainImages[swapchainImageIndex], _drawExtent, _swapchainExtent);
+    vk::CopyImageToImage(cmd, drawImage, _swapchainImages[swapchainImageIndex], _drawExtent, _swapchainExtent);
 
     vk::TransitionImage(cmd,
         _swapchainImages[swapchainImageIndex],
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
         VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 
+    for (ReadbackCallback &capture : _frameCaptures) {
+        _readbacks.ReadImage(cmd, _drawImage, std::move(capture));
+    }
+    _frameCaptures.clear();
+
+    _textureStreamer.EndFrame(cmd);
+
     VK_CHECK(vkEndCommandBuffer(cmd));
 
+    _frameRing.Flush();
+
     VkCommandBufferSubmitInfo cmdSubmitInfo = vk::CommandBufferSubmitInfo(cmd);
     VkSemaphoreSubmitInfo WaitSemaphoreInfo = vk::SemaphoreSubmitInfo(
         VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
@@ -193,6 +261,15 @@ void Engine::InitVulkan() {
     features12.pNext = nullptr;
     features12.bufferDeviceAddress = true;
     features12.descriptorIndexing = true;
+    // bindless heap
+    features12.runtimeDescriptorArray = true;
+    features12.descriptorBindingPartiallyBound = true;
+    features12.descriptorBindingSampledImageUpdateAfterBind = true;
+    features12.descriptorBindingStorageImageUpdateAfterBind = true;
+    features12.descriptorBindingStorageBufferUpdateAfterBind = true;
+    features12.shaderSampledImageArrayNonUniformIndexing = true;
+    features12.shaderStorageImageArrayNonUniformIndexing = true;
+    features12.shaderStorageBufferArrayNonUniformIndexing = true;
 
     vkb::PhysicalDeviceSelector physicalDeviceSelector{ vkbInstance };
     vkb::PhysicalDevice physicalDevice = physicalDeviceSelector.set_minimum_version(1, 3)
@@ -202,19 +279,127 @@ void Engine::InitVulkan() {
                                                                .select()
                                                                .value();
 
+    // optional extensions are only enabled when the gpu also reports the features we rely on
+    VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures = {};
+    shaderObjectFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT;
+
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT dynamicState3Features = {};
+    dynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+    dynamicState3Features.pNext = &shaderObjectFeatures;
+
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures = {};
+    pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    pipelineLibraryFeatures.pNext = &dynamicState3Features;
+
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptorBufferFeatures = {};
+    descriptorBufferFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
+    descriptorBufferFeatures.pNext = &pipelineLibraryFeatures;
+
+    VkPhysicalDeviceFeatures2 supportedFeatures = {};
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures.pNext = &descriptorBufferFeatures;
+    vkGetPhysicalDeviceFeatures2(physicalDevice.physical_device, &supportedFeatures);
+
+    _deviceExtensions.shaderObject = shaderObjectFeatures.shaderObject &&
+                                     physicalDevice.enable_extension_if_present(VK_EXT_SHADER_OBJECT_EXTENSION_NAME);
+
+    _deviceExtensions.extendedDynamicState3 = dynamicState3Features.extendedDynamicState3PolygonMode &&
+                                              dynamicState3Features.extendedDynamicState3ColorBlendEnable &&
+                                              dynamicState3Features.extendedDynamicState3ColorBlendEquation &&
+                                              dynamicState3Features.extendedDynamicState3ColorWriteMask &&
+                                              physicalDevice.enable_extension_if_present(
+                                                  VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+
+    _deviceExtensions.graphicsPipelineLibrary = pipelineLibraryFeatures.graphicsPipelineLibrary &&
+                                                physicalDevice.enable_extensions_if_present({
+                                                    VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME,
+                                                    VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME });
+
+    _deviceExtensions.pushDescriptor = physicalDevice.enable_extension_if_present(
+        VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+
+    _deviceExtensions.memoryBudget = physicalDevice.enable_extension_if_present(
+        VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    // textures are stored block compressed, the loader checks per format what the device can sample
+    VkPhysicalDeviceFeatures optionalFeatures = {};
+    optionalFeatures.textureCompressionBC = supportedFeatures.features.textureCompressionBC;
+    optionalFeatures.textureCompressionASTC_LDR = supportedFeatures.features.textureCompressionASTC_LDR;
+    // the downsample shader writes its storage images without a declared format, MipGenerator::GetMethod
+    // only picks the compute path when the device supports this
+    optionalFeatures.shaderStorageImageWriteWithoutFormat =
+        supportedFeatures.features.shaderStorageImageWriteWithoutFormat;
+    physicalDevice.enable_features_if_present(optionalFeatures);
+
+    _deviceExtensions.descriptorBuffer = descriptorBufferFeatures.descriptorBuffer &&
+                                         physicalDevice.enable_extension_if_present(
+                                             VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+
     vkb::DeviceBuilder deviceBuilder{ physicalDevice };
+
+    if (_deviceExtensions.shaderObject) {
+        shaderObjectFeatures = {};
+        shaderObjectFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT;
+        shaderObjectFeatures.shaderObject = VK_TRUE;
+        deviceBuilder.add_pNext(&shaderObjectFeatures);
+    }
+
+    if (_deviceExtensions.extendedDynamicState3) {
+        dynamicState3Features = {};
+        dynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+        dynamicState3Features.extendedDynamicState3PolygonMode = VK_TRUE;
+        dynamicState3Features.extendedDynamicState3ColorBlendEnable = VK_TRUE;
+        dynamicState3Features.extendedDynamicState3ColorBlendEquation = VK_TRUE;
+        dynamicState3Features.extendedDynamicState3ColorWriteMask = VK_TRUE;
+        deviceBuilder.add_pNext(&dynamicState3Features);
+    }
+
+    if (_deviceExtensions.graphicsPipelineLibrary) {
+        pipelineLibraryFeatures = {};
+        pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+        pipelineLibraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+        deviceBuilder.add_pNext(&pipelineLibraryFeatures);
+    }
+
+    if (_deviceExtensions.descriptorBuffer) {
+        descriptorBufferFeatures = {};
+        descriptorBufferFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
+        descriptorBufferFeatures.descriptorBuffer = VK_TRUE;
+        deviceBuilder.add_pNext(&descriptorBufferFeatures);
+    }
+
     vkb::Device vkbDevice = deviceBuilder.build().value();
     _device = vkbDevice.device;
     _chosenGpu = physicalDevice.physical_device;
 
+    vk::LoadDeviceExtensions(_device, _deviceExtensions);
+    spdlog::info("Shader objects: {}", _deviceExtensions.shaderObject ? "enabled" : "unavailable, using pipelines");
+    spdlog::info("Graphics pipeline library: {}",
+        _deviceExtensions.graphicsPipelineLibrary ? "enabled" : "unavailable, using monolithic pipelines");
+    spdlog::info("Descriptor buffer: {}", _deviceExtensions.descriptorBuffer ? "enabled" : "unavailable");
+    spdlog::info("Push descriptors: {}", _deviceExtensions.pushDescriptor ? "enabled" : "unavailable");
+
     _graphicsQueue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
     _graphicsQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
 
+    if (auto transferQueue = vkbDevice.get_dedicated_queue(vkb::QueueType::transfer)) {
+        _transferQueue = transferQueue.value();
+        _transferQueueFamily = vkbDevice.get_dedicated_queue_index(vkb::QueueType::transfer).value();
+    } else {
+        _transferQueue = _graphicsQueue;
+        _transferQueueFamily = _graphicsQueueFamily;
+    }
+    spdlog::info("Dedicated transfer queue: {}", _transferQueue != _graphicsQueue ? "enabled" : "unavailable");
+
     VmaAllocatorCreateInfo vmaAllocatorCreateInfo = {};
     vmaAllocatorCreateInfo.physicalDevice = _chosenGpu;
     vmaAllocatorCreateInfo.device = _device;
     vmaAllocatorCreateInfo.instance = _instance;
+    vmaAllocatorCreateInfo.vulkanApiVersion = VK_API_VERSION_1_3;
     vmaAllocatorCreateInfo.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+    if (_deviceExtensions.memoryBudget) {
+        vmaAllocatorCreateInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    }
     vmaCreateAllocator(&vmaAllocatorCreateInfo, &_allocator);
 
     _deletionQueue.PushFunction([&]() {
@@ -222,6 +407,23 @@ void Engine::InitVulkan() {
         vmaDestroyAllocator(_allocator);
     });
 
+    _resources.Init(_device, _allocator);
+    _deletionQueue.PushFunction([&]() {
+        _resources.Cleanup();
+    });
+
+    _transientImages.Init(_device, _allocator, _resources);
+
+    _defragmentation.Init(_device, _allocator, _resources, FRAME_OVERLAP);
+    _defragmentation.SetBufferMovedCallback([this](BufferHandle handle) {
+        OnBufferMoved(handle);
+    });
+    _deletionQueue.PushFunction([&]() {
+        _defragmentation.Cleanup();
+    });
+
+    _memoryBudget.Init(_allocator, _deviceExtensions.memoryBudget);
+
 }
 
 void Engine::InitSwapchain() {
@@ -233,38 +435,27 @@ void Engine::InitSwapchain() {
         1
     };
 
-    _drawImage.imageFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
-    _drawImage.imageExtent = drawImageExtent;
-
     VkImageUsageFlags drawImageUsages{};
     drawImageUsages |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
     drawImageUsages |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
     drawImageUsages |= VK_IMAGE_USAGE_STORAGE_BIT;
     drawImageUsages |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-    VkImageCreateInfo renderImageInfo = vk::ImageCreateInfo(_drawImage.imageFormat, drawImageUsages, drawImageExtent);
-
-    VmaAllocationCreateInfo renderImageAllocinfo = {};
-    renderImageAllocinfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-    renderImageAllocinfo.requiredFlags = static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    vmaCreateImage(_allocator,
-        &renderImageInfo,
-        &renderImageAllocinfo,
-        &_drawImage.image,
-        &_drawImage.allocation,
-        nullptr);
-
-    VkImageViewCreateInfo renderImageViewCreateInfo = vk::ImageviewCreateInfo(_drawImage.imageFormat,
-        _drawImage.image,
-        VK_IMAGE_ASPECT_COLOR_BIT);
-
-    VK_CHECK(vkCreateImageView(_device,&renderImageViewCreateInfo, nullptr, &_drawImage.imageView));
+    // written by the background pass, drawn into by the geometry pass and copied out at the end of the frame
+    _drawImageId = _transientImages.Declare({
+        .format = VK_FORMAT_R16G16B16A16_SFLOAT,
+        .extent = drawImageExtent,
+        .usage = drawImageUsages,
+        .firstPass = 0,
+        .lastPass = 2,
+        .lastStage = VK_PIPELINE_STAGE_2_BLIT_BIT | VK_PIPELINE_STAGE_2_COPY_BIT,
+        .lastAccess = VK_ACCESS_2_TRANSFER_READ_BIT });
+    _transientImages.Build();
+    _drawImage = _transientImages.GetImage(_drawImageId);
 
     _deletionQueue.PushFunction([&]() {
-        spdlog::info("Deleting image");
-        vkDestroyImageView(_device, _drawImage.imageView, nullptr);
-        vmaDestroyImage(_allocator, _drawImage.image, _drawImage.allocation);
+        spdlog::info("Deleting transient images");
+        _transientImages.Cleanup();
     });
 }
 
@@ -279,6 +470,15 @@ void Engine::InitCommands() {
 
         VK_CHECK(vkAllocateCommandBuffers(_device, &commandBufferAllocateInfo, &frame.mainCommandBuffer));
     }
+
+    VK_CHECK(vkCreateCommandPool(_device, &commandPoolCreateInfo, nullptr, &_immCommandPool));
+
+    VkCommandBufferAllocateInfo immCommandBufferAllocateInfo = vk::CommandBufferAllocateInfo(_immCommandPool);
+    VK_CHECK(vkAllocateCommandBuffers(_device, &immCommandBufferAllocateInfo, &_immCommandBuffer));
+
+    _deletionQueue.PushFunction([&]() {
+        vkDestroyCommandPool(_device, _immCommandPool, nullptr);
+    });
 }
 
 void Engine::InitSyncStructures() {
@@ -291,46 +491,108 @@ void Engine::InitSyncStructures() {
         VK_CHECK(vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &frame.renderSemaphore));
     }
 
+    VK_CHECK(vkCreateFence(_device, &fenceCreateInfo, nullptr, &_immFence));
+    _deletionQueue.PushFunction([&]() {
+        vkDestroyFence(_device, _immFence, nullptr);
+    });
 }
 
-void Engine::InitDescriptors() {
-    std::vector<DescriptorAllocator::PoolSizeRatio> poolSizeRatios = {
-        { .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .ratio = 1 }
-    };
+void Engine::InitBuffers() {
+    _frameRing.Init(_device, _chosenGpu, _allocator, FRAME_RING_SIZE, FRAME_OVERLAP);
+    _deletionQueue.PushFunction([&]() {
+        _frameRing.Cleanup();
+    });
+}
+
+void Engine::InitUploads() {
+    _uploadQueue.Init(_device,
+        _allocator,
+        _transferQueue,
+        _transferQueueFamily,
+        _graphicsQueueFamily,
+        _mipGenerator);
+    _deletionQueue.PushFunction([&]() {
+        _uploadQueue.Cleanup();
+    });
+
+    _textureLoader.Init(_device, _chosenGpu, _allocator, _threadPool, _uploadQueue, _resources);
+
+    _textureStreamer.Init(_device,
+        _allocator,
+        _textureLoader,
+        _resources,
+        _bindlessHeap,
+        _memoryBudget,
+        FRAME_OVERLAP,
+        TEXTURE_STREAMING_BUDGET);
+    _deletionQueue.PushFunction([&]() {
+        _textureStreamer.Cleanup();
+    });
+
+    _readbacks.Init(_device, _allocator, _threadPool, _resources, READBACK_SLOTS);
+    _deletionQueue.PushFunction([&]() {
+        _readbacks.Cleanup();
+    });
+}
 
-    _globalDescriptorAllocator.InitPool(_device, 10, poolSizeRatios);
+void Engine::InitDescriptors() {
+    _descriptorLayoutCache.Init(_device);
 
+    // the draw image's set lives in the frame's descriptor buffer when there is one, otherwise it is
+    // pushed per dispatch or comes from the frame's descriptor pools
     {
+        VkDescriptorSetLayoutCreateFlags layoutFlags = 0;
+        if (_deviceExtensions.descriptorBuffer) {
+            layoutFlags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+        } else if (_deviceExtensions.pushDescriptor) {
+            layoutFlags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+        }
+
         DescriptorLayoutBuilder descriptorLayoutBuilder;
         descriptorLayoutBuilder.AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-        _drawImageDescriptorSetLayout = descriptorLayoutBuilder.Build(_device, VK_SHADER_STAGE_COMPUTE_BIT);
+        _drawImageDescriptorSetLayout = _descriptorLayoutCache.Get(descriptorLayoutBuilder,
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            layoutFlags);
     }
 
-    _drawImageDescriptorSet = _globalDescriptorAllocator.Allocate(_device, _drawImageDescriptorSetLayout);
-
-    VkDescriptorImageInfo descriptorImageInfo = {};
-    descriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-    descriptorImageInfo.imageView = _drawImage.imageView;
-
-    VkWriteDescriptorSet drawImageWrite = {};
-    drawImageWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    drawImageWrite.pNext = nullptr;
-    drawImageWrite.dstBinding = 0;
-    drawImageWrite.dstSet = _drawImageDescriptorSet;
-    drawImageWrite.descriptorCount = 1;
-    drawImageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    drawImageWrite.pImageInfo = &descriptorImageInfo;
-
-    vkUpdateDescriptorSets(_device, 1, &drawImageWrite, 0, nullptr);
+    _deletionQueue.PushFunction([&]() {
+        _descriptorLayoutCache.Cleanup();
+    });
 
+    _bindlessHeap.Init(_device, _chosenGpu);
     _deletionQueue.PushFunction([&]() {
-        _globalDescriptorAllocator.DestroyPool(_device);
-        vkDestroyDescriptorSetLayout(_device, _drawImageDescriptorSetLayout, nullptr);
+        _bindlessHeap.Cleanup();
     });
 
+    _drawImageBindlessIndex = _bindlessHeap.RegisterStorageImage(_resources.GetImageView(_drawImage));
+
+    std::vector<DescriptorAllocatorGrowable::PoolSizeRatio> frameSizeRatios = {
+        { .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .ratio = 3 },
+        { .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .ratio = 3 },
+        { .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .ratio = 3 },
+        { .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .ratio = 4 },
+    };
+
+    for (FrameData &frame : _frames) {
+        frame.frameDescriptors.Init(_device, 1000, frameSizeRatios);
+        if (_deviceExtensions.descriptorBuffer) {
+            frame.frameDescriptors.InitDescriptorBuffer(_device, _chosenGpu, _allocator, FRAME_DESCRIPTOR_BUFFER_SIZE);
+        }
+
+        _deletionQueue.PushFunction([this, frameDescriptors = &frame.frameDescriptors]() {
+            frameDescriptors->DestroyPools(_device);
+        });
+    }
 }
 
 void Engine::InitShaderCompiler() {
+#ifdef DIST
+    // shipping builds never compile shaders, everything comes precompiled from tome_shaderc
+    const std::string archivePath = std::string("shaders/") + SHADER_ARCHIVE_FILE_NAME;
+    if (!_shaderArchive.Open(archivePath.c_str())) {
+        spdlog::critical("Shader archive {} missing", archivePath);
+    }
+#else
     using namespace slang;
 
     createGlobalSession(_slangGlobalSession.writeRef());
@@ -358,11 +620,48 @@ void Engine::InitShaderCompiler() {
     sessionDesc.compilerOptionEntries = compilerOptions.data();
     sessionDesc.compilerOptionEntryCount = static_cast<uint32_t>(compilerOptions.size());
 
-    _slangGlobalSession->createSession(sessionDesc, _slangSession.writeRef());
+    _slangGlobalSession->createSession(sessionDesc, _shaderCompiler.session.writeRef());
+#endif
+}
+
+std::optional<ShaderProgram> Engine::LoadShaderProgram(const char *moduleName,
+    std::span<const char *const> entryPoints) {
+#ifdef DIST
+    return vk::LoadShaderProgram(_shaderArchive, moduleName, entryPoints);
+#else
+    return _shaderCompiler.Compile(moduleName, entryPoints);
+#endif
+}
+
+std::optional<ShaderProgram> Engine::LoadShaderProgram(const char *moduleName,
+    std::initializer_list<const char *> entryPoints) {
+    return LoadShaderProgram(moduleName, std::span<const char *const>(entryPoints.begin(), entryPoints.size()));
 }
 
 void Engine::InitPipelines() {
+    _pipelineLibrary.Init(_device, _deviceExtensions.graphicsPipelineLibrary);
+    _deletionQueue.PushFunction([&]() {
+        _pipelineLibrary.Cleanup();
+    });
+
+    _pipelineManager.Init(_device,
+        _threadPool,
+        _pipelineLibrary,
+        [this](const char *moduleName, std::span<const char *const> entryPoints) {
+            return LoadShaderProgram(moduleName, entryPoints);
+        });
+    _deletionQueue.PushFunction([&]() {
+        _pipelineManager.Cleanup();
+    });
+
+    _mipGenerator.Init(_device, _chosenGpu, _pipelineManager, FRAME_OVERLAP);
+    _deletionQueue.PushFunction([&]() {
+        _mipGenerator.Cleanup();
+    });
+
     InitBackgroundPipelines();
+    InitTrianglePipeline();
+    InitMeshPipeline();
 }
 
 void Engine::InitBackgroundPipelines() {
@@ -374,31 +673,287 @@ void Engine::InitBackgroundPipelines() {
 
     VK_CHECK(vkCreatePipelineLayout(_device, &computeLayout, nullptr, &_gradientPipelineLayout));
 
-    auto computeDrawShader = vk::LoadShaderModule("gradient.slang", _device, _slangSession);
-    if (!computeDrawShader.has_value()) {
-        return;
+    _deletionQueue.PushFunction([&]() {
+        vkDestroyPipelineLayout(_device, _gradientPipelineLayout, nullptr);
+    });
+
+    // shader objects have no pipeline to compile, only the shader itself is compiled up front
+    if (_deviceExtensions.shaderObject) {
+        if (auto gradientProgram = LoadShaderProgram("gradient", { "computeMain" })) {
+            auto shaderObjects = vk::CreateShaderObjects(_device,
+                gradientProgram.value(),
+                std::span(&_drawImageDescriptorSetLayout, 1));
+            if (shaderObjects.has_value()) {
+                _gradientShaderObjects = std::move(shaderObjects.value());
+
+                _deletionQueue.PushFunction([&]() {
+                    vk::DestroyShaderObjects(_device, _gradientShaderObjects);
+                });
+                return;
+            }
+        }
     }
 
-    VkPipelineShaderStageCreateInfo stageCreateInfo = {};
-    stageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    stageCreateInfo.pNext = nullptr;
-    stageCreateInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-    stageCreateInfo.module = computeDrawShader.value();
-    stageCreateInfo.pName = "main";
+    _gradientPipeline = _pipelineManager.CreateComputePipeline("gradient",
+        "computeMain",
+        _gradientPipelineLayout,
+        _deviceExtensions.descriptorBuffer ? VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0);
+}
 
-    VkComputePipelineCreateInfo computePipelineCreateInfo{};
-    computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-    computePipelineCreateInfo.pNext = nullptr;
-    computePipelineCreateInfo.layout = _gradientPipelineLayout;
-    computePipelineCreateInfo.stage = stageCreateInfo;
+void Engine::InitTrianglePipeline() {
+    // geometry reaches its resources through the bindless heap, so it shares the heap's layout
+    if (_deviceExtensions.shaderObject) {
+        if (auto triangleProgram = LoadShaderProgram("triangle", { "vertexMain", "fragmentMain" })) {
+            const VkDescriptorSetLayout heapSetLayout = _bindlessHeap.GetSetLayout();
+            const VkPushConstantRange heapPushConstants = BindlessHeap::GetPushConstantRange();
+            auto shaderObjects = vk::CreateShaderObjects(_device,
+                triangleProgram.value(),
+                std::span(&heapSetLayout, 1),
+                std::span(&heapPushConstants, 1));
+            if (shaderObjects.has_value()) {
+                _triangleShaderObjects = std::move(shaderObjects.value());
+
+                _deletionQueue.PushFunction([&]() {
+                    vk::DestroyShaderObjects(_device, _triangleShaderObjects);
+                });
+                return;
+            }
+        }
+    }
 
-    VK_CHECK(vkCreateComputePipelines(_device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &_gradientPipeline));
-    vkDestroyShaderModule(_device, computeDrawShader.value(), nullptr);
+    PipelineBuilder pipelineBuilder;
+    pipelineBuilder.SetColorAttachmentFormat(_resources.GetImageFormat(_drawImage))
+                   .SetDepthFormat(VK_FORMAT_UNDEFINED)
+                   .SetLayout(_bindlessHeap.GetPipelineLayout());
+    if (_deviceExtensions.extendedDynamicState3) {
+        pipelineBuilder.EnableExtendedDynamicState3();
+    }
+    _trianglePipeline = _pipelineManager.CreateGraphicsPipeline("triangle",
+        "vertexMain",
+        "fragmentMain",
+        pipelineBuilder);
+}
+
+void Engine::InitMeshPipeline() {
+    // vertices are pulled through a device address, so there is no vertex input state and this one
+    // pipeline draws every mesh regardless of its vertex format
+    if (_deviceExtensions.shaderObject) {
+        if (auto meshProgram = LoadShaderProgram("mesh", { "vertexMain", "fragmentMain" })) {
+            const VkDescriptorSetLayout heapSetLayout = _bindlessHeap.GetSetLayout();
+            const VkPushConstantRange heapPushConstants = BindlessHeap::GetPushConstantRange();
+            auto shaderObjects = vk::CreateShaderObjects(_device,
+                meshProgram.value(),
+                std::span(&heapSetLayout, 1),
+                std::span(&heapPushConstants, 1));
+            if (shaderObjects.has_value()) {
+                _meshShaderObjects = std::move(shaderObjects.value());
+
+                _deletionQueue.PushFunction([&]() {
+                    vk::DestroyShaderObjects(_device, _meshShaderObjects);
+                });
+                return;
+            }
+        }
+    }
+
+    PipelineBuilder pipelineBuilder;
+    pipelineBuilder.SetColorAttachmentFormat(_resources.GetImageFormat(_drawImage))
+                   .SetDepthFormat(VK_FORMAT_UNDEFINED)
+                   .SetLayout(_bindlessHeap.GetPipelineLayout());
+    if (_deviceExtensions.extendedDynamicState3) {
+        pipelineBuilder.EnableExtendedDynamicState3();
+    }
+    _meshPipeline = _pipelineManager.CreateGraphicsPipeline("mesh", "vertexMain", "fragmentMain", pipelineBuilder);
+}
+
+void Engine::InitDefaultData() {
+    std::array<Vertex, 4> rectangleVertices = {};
+    rectangleVertices[0].position = { 0.5, -0.5, 0 };
+    rectangleVertices[1].position = { 0.5, 0.5, 0 };
+    rectangleVertices[2].position = { -0.5, -0.5, 0 };
+    rectangleVertices[3].position = { -0.5, 0.5, 0 };
+
+    rectangleVertices[0].color = { 0, 0, 0, 1 };
+    rectangleVertices[1].color = { 0.5, 0.5, 0.5, 1 };
+    rectangleVertices[2].color = { 1, 0, 0, 1 };
+    rectangleVertices[3].color = { 0, 1, 0, 1 };
+
+    rectangleVertices[0].uvX = 1;
+    rectangleVertices[1].uvX = 1;
+    rectangleVertices[1].uvY = 1;
+    rectangleVertices[3].uvY = 1;
+
+    const std::array<uint32_t, 6> rectangleIndices = { 0, 1, 2, 2, 1, 3 };
+
+    _rectangle = UploadMesh(rectangleIndices, rectangleVertices);
 
     _deletionQueue.PushFunction([&]() {
-        vkDestroyPipelineLayout(_device, _gradientPipelineLayout, nullptr);
-        vkDestroyPipeline(_device, _gradientPipeline, nullptr);
+        _resources.DestroyBuffer(_rectangle.indexBuffer);
+        _resources.DestroyBuffer(_rectangle.vertexBuffer);
+    });
+
+    VkSamplerCreateInfo samplerInfo = { .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    _linearSampler = _resources.CreateSampler(samplerInfo);
+    _linearSamplerIndex = _bindlessHeap.RegisterSampler(_resources.GetSampler(_linearSampler));
+
+    _deletionQueue.PushFunction([&]() {
+        _bindlessHeap.Release(BindlessResourceType::Sampler, _linearSamplerIndex);
+        _resources.DestroySampler(_linearSampler);
+    });
+}
+
+void Engine::ImmediateSubmit(std::function<void(VkCommandBuffer cmd)> &&function) {
+    VK_CHECK(vkResetFences(_device, 1, &_immFence));
+    VK_CHECK(vkResetCommandBuffer(_immCommandBuffer, 0));
+
+    const VkCommandBufferBeginInfo cmdBeginInfo = vk::CommandBufferBeginInfo(
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    VK_CHECK(vkBeginCommandBuffer(_immCommandBuffer, &cmdBeginInfo));
+
+    function(_immCommandBuffer);
+
+    VK_CHECK(vkEndCommandBuffer(_immCommandBuffer));
+
+    VkCommandBufferSubmitInfo cmdSubmitInfo = vk::CommandBufferSubmitInfo(_immCommandBuffer);
+    VkSubmitInfo2 submit = vk::SubmitInfo(&cmdSubmitInfo, nullptr, nullptr);
+
+    VK_CHECK(vkQueueSubmit2(_graphicsQueue, 1, &submit, _immFence));
+    VK_CHECK(vkWaitForFences(_device, 1, &_immFence, true, 9999999999));
+}
+
+GPUMeshBuffers Engine::UploadMesh(std::span<const uint32_t> indices, std::span<const Vertex> vertices) {
+    const VkDeviceSize vertexBufferSize = vertices.size_bytes();
+    const VkDeviceSize indexBufferSize = indices.size_bytes();
+
+    GPUMeshBuffers newSurface = {};
+
+    // read by the vertex shader as a storage buffer through its address
+    newSurface.vertexBuffer = _resources.CreateBuffer(vertexBufferSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+    newSurface.indexBuffer = _resources.CreateBuffer(indexBufferSize,
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+    AllocatedBuffer staging = vk::CreateBuffer(_device,
+        _allocator,
+        vertexBufferSize + indexBufferSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VMA_MEMORY_USAGE_AUTO,
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+    memcpy(staging.mapped, vertices.data(), vertexBufferSize);
+    memcpy(static_cast<std::byte *>(staging.mapped) + vertexBufferSize, indices.data(), indexBufferSize);
+    vmaFlushAllocation(_allocator, staging.allocation, 0, VK_WHOLE_SIZE);
+
+    ImmediateSubmit([&](VkCommandBuffer cmd) {
+        VkBufferCopy vertexCopy = {};
+        vertexCopy.srcOffset = 0;
+        vertexCopy.dstOffset = 0;
+        vertexCopy.size = vertexBufferSize;
+        vkCmdCopyBuffer(cmd, staging.buffer, _resources.GetBuffer(newSurface.vertexBuffer), 1, &vertexCopy);
+
+        VkBufferCopy indexCopy = {};
+        indexCopy.srcOffset = vertexBufferSize;
+        indexCopy.dstOffset = 0;
+        indexCopy.size = indexBufferSize;
+        vkCmdCopyBuffer(cmd, staging.buffer, _resources.GetBuffer(newSurface.indexBuffer), 1, &indexCopy);
+    });
+
+    vk::DestroyBuffer(_allocator, staging);
+
+    return newSurface;
+}
+
+std::optional<LoadedGltf> Engine::LoadGltf(const std::string &path) {
+    std::optional<GltfScene> scene = vk::LoadGltf(path);
+    if (!scene) {
+        return std::nullopt;
+    }
+
+    LoadedGltf loaded;
+    loaded.nodes = std::move(scene->nodes);
+    loaded.rootNodes = std::move(scene->rootNodes);
+    for (MeshGeometry &geometry : scene->meshes) {
+        MeshAsset &mesh = loaded.meshes.emplace_back();
+        mesh.name = std::move(geometry.name);
+        mesh.surfaces = std::move(geometry.surfaces);
+        // meshes left without triangles keep null buffers
+        if (geometry.indices.empty()) {
+            continue;
+        }
+
+        mesh.meshBuffers = UploadMesh(geometry.indices, geometry.vertices);
+        _deletionQueue.PushFunction([this, meshBuffers = mesh.meshBuffers]() {
+            _resources.DestroyBuffer(meshBuffers.indexBuffer);
+            _resources.DestroyBuffer(meshBuffers.vertexBuffer);
+        });
+    }
+    return loaded;
+}
+
+void Engine::CaptureFrame(ReadbackCallback &&callback) {
+    _frameCaptures.push_back(std::move(callback));
+}
+
+BindlessIndex Engine::GetBindlessBuffer(BufferHandle handle) {
+    auto [it, inserted] = _bindlessBuffers.try_emplace(handle, INVALID_BINDLESS_INDEX);
+    if (inserted) {
+        it->second = _bindlessHeap.RegisterStorageBuffer(_resources.GetBuffer(handle));
+    }
+    return it->second;
+}
+
+void Engine::ReleaseBindlessBuffer(BufferHandle handle) {
+    auto it = _bindlessBuffers.find(handle);
+    if (it == _bindlessBuffers.end()) {
+        return;
+    }
+
+    GetCurrentFrame().deletionQueue.PushFunction([this, index = it->second]() {
+        _bindlessHeap.Release(BindlessResourceType::StorageBuffer, index);
     });
+    _bindlessBuffers.erase(it);
+}
+
+void Engine::OnBufferMoved(BufferHandle handle) {
+    // sets cached earlier this frame would keep reading the old buffer, the ones of frames in
+    // flight are fine as it is only destroyed once they retired
+    GetCurrentFrame().frameDescriptorSets.Clear();
+
+    // Frames in flight may still read the old slot, so rewriting it in place isn't allowed. The
+    // buffer gets a new slot and the old one is released after this frame.
+    ReleaseBindlessBuffer(handle);
+    GetBindlessBuffer(handle);
+
+    // device addresses need nothing, ResourcePool already hands out the new buffer's
+}
+
+void Engine::RunBenchmarks() {
+    if (_deviceExtensions.shaderObject) {
+        if (auto gradientProgram = LoadShaderProgram("gradient", { "computeMain" })) {
+            vk::BenchmarkShaderObjects(_device,
+                gradientProgram.value(),
+                _drawImageDescriptorSetLayout,
+                _gradientPipelineLayout,
+                100);
+        }
+    }
+
+    if (_deviceExtensions.descriptorBuffer) {
+        vk::BenchmarkDescriptorBuffer(_device,
+            _chosenGpu,
+            _allocator,
+            _resources.GetImageView(_drawImage),
+            100,
+            1000);
+    }
 }
 
 void Engine::CreateSwapchain(uint32_t width, uint32_t height) {
@@ -429,7 +984,148 @@ void Engine::DestroySwapchain() {
 }
 
 void Engine::DrawBackground(VkCommandBuffer cmd) {
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _gradientPipeline);
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _gradientPipelineLayout, 0, 1, &_drawImageDescriptorSet, 0, nullptr);
+    if (!_gradientShaderObjects.shaders.empty()) {
+        vk::BindShaderObjects(cmd, _gradientShaderObjects);
+    } else if (VkPipeline gradientPipeline = _pipelineManager.Get(_gradientPipeline)) {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, gradientPipeline);
+    } else {
+        // still compiling
+        return;
+    }
+
+    // the draw image's memory is aliased and may move between frames, so the set is written per
+    // frame and dies with the frame's descriptors
+    DescriptorWriter writer;
+    writer.WriteImage(VK_NULL_HANDLE,
+        0,
+        _resources.GetImageView(_drawImage),
+        VK_NULL_HANDLE,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+
+    FrameData &frame = GetCurrentFrame();
+    if (_deviceExtensions.descriptorBuffer) {
+        std::optional<DescriptorBufferSet> drawImageSet = frame.frameDescriptorSets.GetBufferSet(
+            frame.frameDescriptors,
+            _drawImageDescriptorSetLayout,
+            writer);
+        if (!drawImageSet.has_value()) {
+            return;
+        }
+        frame.frameDescriptors.descriptorBuffer.Bind(cmd,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            _gradientPipelineLayout,
+            0,
+            std::span(&drawImageSet.value(), 1));
+    } else if (_deviceExtensions.pushDescriptor) {
+        writer.Push(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _gradientPipelineLayout, 0);
+    } else {
+        VkDescriptorSet drawImageSet = frame.frameDescriptorSets.Get(_device,
+            frame.frameDescriptors,
+            _drawImageDescriptorSetLayout,
+            writer);
+
+        vkCmdBindDescriptorSets(cmd,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            _gradientPipelineLayout,
+            0,
+            1,
+            &drawImageSet,
+            0,
+            nullptr);
+    }
+
     vkCmdDispatch(cmd, std::ceil(_drawExtent.width/16.0), std::ceil(_drawExtent.height / 16.0) , 1);
+}
+
+void Engine::DrawGeometry(VkCommandBuffer cmd) {
+    VkRenderingAttachmentInfo colorAttachment = vk::AttachmentInfo(_resources.GetImageView(_drawImage),
+        nullptr,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    VkRenderingInfo renderInfo = vk::RenderingInfo(_drawExtent, &colorAttachment, nullptr);
+
+    vkCmdBeginRendering(cmd, &renderInfo);
+
+    // bound once, every draw below only pushes its resource indices
+    _bindlessHeap.Bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+    DynamicGraphicsState graphicsState;
+    graphicsState.SetExtent(_drawExtent);
+
+    if (!_triangleShaderObjects.shaders.empty()) {
+        vk::BindShaderObjects(cmd, _triangleShaderObjects);
+        vk::SetShaderObjectGraphicsState(cmd, graphicsState);
+        vkCmdDraw(cmd, 3, 1, 0, 0);
+    } else if (VkPipeline trianglePipeline = _pipelineManager.Get(_trianglePipeline)) {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, trianglePipeline);
+        vk::SetDynamicGraphicsState(cmd, graphicsState, _deviceExtensions.extendedDynamicState3);
+        vkCmdDraw(cmd, 3, 1, 0, 0);
+    }
+
+    bool meshBound = false;
+    if (!_meshShaderObjects.shaders.empty()) {
+        vk::BindShaderObjects(cmd, _meshShaderObjects);
+        vk::SetShaderObjectGraphicsState(cmd, graphicsState);
+        meshBound = true;
+    } else if (VkPipeline meshPipeline = _pipelineManager.Get(_meshPipeline)) {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, meshPipeline);
+        vk::SetDynamicGraphicsState(cmd, graphicsState, _deviceExtensions.extendedDynamicState3);
+        meshBound = true;
+    }
+
+    if (meshBound && _scene) {
+        for (const SceneNode &node : _scene->nodes) {
+            if (node.meshIndex == INVALID_MESH_INDEX) {
+                continue;
+            }
+            const MeshAsset &mesh = _scene->meshes[node.meshIndex];
+            // meshes without triangles have no buffers
+            if (!mesh.meshBuffers.indexBuffer.IsNull()) {
+                DrawMesh(cmd, mesh.meshBuffers, mesh.surfaces, node.worldTransform);
+            }
+        }
+    } else if (meshBound) {
+        const GeoSurface rectangle = { .startIndex = 0, .count = 6, .materialIndex = INVALID_MATERIAL_INDEX };
+        DrawMesh(cmd, _rectangle, { &rectangle, 1 }, glm::mat4{ 1.f });
+    }
+
+    vkCmdEndRendering(cmd);
+}
+
+void Engine::DrawMesh(VkCommandBuffer cmd,
+    const GPUMeshBuffers &meshBuffers,
+    std::span<const GeoSurface> surfaces,
+    const glm::mat4 &transform) {
+    GPUDrawData data = {};
+    data.worldMatrix = transform;
+    data.texture = INVALID_BINDLESS_INDEX;
+    if (_meshTexture != INVALID_STREAMED_TEXTURE) {
+        // invalid until the mip tail has loaded, the draw uses vertex colors until then
+        data.texture = _textureStreamer.GetBindlessIndex(_meshTexture);
+        data.sampler = _linearSamplerIndex;
+        data.streamedTexture = _meshTexture;
+        data.feedbackBuffer = _textureStreamer.GetFeedbackBufferIndex();
+        const VkExtent2D extent = _textureStreamer.GetExtent(_meshTexture);
+        data.textureSize = { extent.width, extent.height };
+    }
+
+    std::optional<RingAllocation> drawData = _frameRing.Push(data);
+    if (!drawData) {
+        return;
+    }
+
+    GPUDrawPushConstants pushConstants = {};
+    pushConstants.drawData = drawData->deviceAddress;
+    pushConstants.vertexBuffer = _resources.GetBufferAddress(meshBuffers.vertexBuffer);
+
+    vkCmdPushConstants(cmd,
+        _bindlessHeap.GetPipelineLayout(),
+        VK_SHADER_STAGE_ALL,
+        0,
+        sizeof(GPUDrawPushConstants),
+        &pushConstants);
+    vkCmdBindIndexBuffer(cmd, _resources.GetBuffer(meshBuffers.indexBuffer), 0, VK_INDEX_TYPE_UINT32);
+    for (const GeoSurface &surface : surfaces) {
+        vkCmdDrawIndexed(cmd, surface.count, 1, surface.startIndex, 0, 0);
+    }
 }
\ No newline at end of file
@@ -1,25 +1,32 @@
 #pragma once
 
+#include <unordered_map>
+
+#include "core/thread_pool.h"
+#include "rendering/vulkan/vk_bindless.h"
+#include "rendering/vulkan/vk_defragmentation.h"
+#include "rendering/vulkan/vk_buffers.h"
 #include "rendering/vulkan/vk_descriptors.h"
+#include "rendering/vulkan/vk_extensions.h"
+#include "rendering/vulkan/vk_loader.h"
+#include "rendering/vulkan/vk_memory_budget.h"
+#include "rendering/vulkan/vk_mipmaps.h"
+#include "rendering/vulkan/vk_pipeline_library.h"
+#include "rendering/vulkan/vk_pipeline_manager.h"
+#include "rendering/vulkan/vk_pipelines.h"
+#include "rendering/vulkan/vk_readback.h"
+#include "rendering/vulkan/vk_resources.h"
+#include "rendering/vulkan/vk_shader_archive.h"
+#include "rendering/vulkan/vk_texture_loader.h"
+#include "rendering/vulkan/vk_texture_streaming.h"
+#include "rendering/vulkan/vk_transient_images.h"
 #include "rendering/vulkan/vk_types.h"
+#include "rendering/vulkan/vk_upload.h"
 
+#ifndef DIST
 #include "slang/slang.h"
 #include "slang/slang-com-ptr.h"
-
-struct DeletionQueue {
-    std::deque<std::function<void()>> deletors;
-
-    void PushFunction(std::function<void()>&& function) {
-        deletors.push_back(function);
-    }
-
-    void Flush() {
-        for (auto it = deletors.rbegin(); it!= deletors.rend(); it++) {
-            (*it)();
-        }
-        deletors.clear();
-    }
-};
+#endif
 
 struct FrameData {
     VkCommandPool commandPool;
@@ -28,15 +35,37 @@ struct FrameData {
     VkSemaphore renderSemaphore;
     VkFence renderFence;
     DeletionQueue deletionQueue;
+    DescriptorAllocatorGrowable frameDescriptors;
+    DescriptorSetCache frameDescriptorSets;
 };
 
 constexpr unsigned int FRAME_OVERLAP = 2;
 
+// per frame in flight, for constants written by the cpu each frame
+constexpr VkDeviceSize FRAME_RING_SIZE = 1024 * 1024;
+
+// per frame in flight, descriptor sets of the frame when VK_EXT_descriptor_buffer is enabled
+constexpr VkDeviceSize FRAME_DESCRIPTOR_BUFFER_SIZE = 64 * 1024;
+
+// device memory streamed texture detail may use, the heap's budget can lower it further
+constexpr VkDeviceSize TEXTURE_STREAMING_BUDGET = 512ull * 1024 * 1024;
+
+// readback buffers, two more than the frames in flight leave room for callbacks still running
+constexpr uint32_t READBACK_SLOTS = FRAME_OVERLAP + 2;
+
+// Content loaded by Engine::Init, empty paths load nothing.
+struct EngineConfig {
+    // glTF file the geometry pass draws in place of the test rectangle
+    std::string scenePath;
+    // KTX2 texture streamed by TextureStreamer and applied to every mesh the geometry pass draws
+    std::string texturePath;
+};
+
 class Engine {
 public:
     static Engine& Get();
 
-    void Init();
+    void Init(const EngineConfig &config = {});
 
     void Cleanup();
 
@@ -44,6 +73,27 @@ public:
 
     void Run();
 
+    // Records commands with function and blocks until the gpu has executed them. For init time
+    // work like uploads, never call it while drawing a frame.
+    void ImmediateSubmit(std::function<void(VkCommandBuffer cmd)> &&function);
+
+    // Copies indices and vertices into device local buffers through a staging buffer.
+    GPUMeshBuffers UploadMesh(std::span<const uint32_t> indices, std::span<const Vertex> vertices);
+
+    // Loads a glTF file with vk::LoadGltf and uploads its meshes, which are kept until Cleanup.
+    // Blocks like UploadMesh, for load time only.
+    std::optional<LoadedGltf> LoadGltf(const std::string &path);
+
+    // Reads back the draw image at the end of the next frame. callback runs on a worker thread
+    // once that frame has retired, it is dropped if every readback slot is busy.
+    void CaptureFrame(ReadbackCallback &&callback);
+
+    // Storage buffer slot of a pool buffer in the bindless heap, registered on first use. The slot
+    // changes when defragmentation moves the buffer, so look it up each frame instead of keeping it.
+    BindlessIndex GetBindlessBuffer(BufferHandle handle);
+    // Frees the buffer's slot once the current frame has retired, call before destroying the buffer.
+    void ReleaseBindlessBuffer(BufferHandle handle);
+
 private:
     bool _isInitialized = false;
     int _frameNumber = 0;
@@ -57,6 +107,7 @@ private:
     VkPhysicalDevice _chosenGpu = nullptr;
     VkDevice _device = nullptr;
     VkSurfaceKHR _surface = nullptr;
+    DeviceExtensions _deviceExtensions = {};
 
     VkSwapchainKHR _swapchain = nullptr;
     VkFormat _swapchainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
@@ -68,37 +119,108 @@ private:
     FrameData _frames[FRAME_OVERLAP] = {};
     VkQueue _graphicsQueue = nullptr;
     uint32_t _graphicsQueueFamily = 0;
+    // the graphics queue when the device has no dedicated transfer queue
+    VkQueue _transferQueue = nullptr;
+    uint32_t _transferQueueFamily = 0;
 
     DeletionQueue _deletionQueue;
 
+    VkFence _immFence = nullptr;
+    VkCommandBuffer _immCommandBuffer = nullptr;
+    VkCommandPool _immCommandPool = nullptr;
+
     VmaAllocator _allocator = nullptr;
+    MemoryBudget _memoryBudget;
+    ResourcePool _resources;
+    TransientImageAllocator _transientImages;
+    DefragmentationService _defragmentation;
 
-    AllocatedImage _drawImage = {};
+    FrameRingBuffer _frameRing;
+
+    TransientImageId _drawImageId = 0;
+    ImageHandle _drawImage;
     VkExtent2D _drawExtent = {};
 
-    DescriptorAllocator _globalDescriptorAllocator = {};
-    VkDescriptorSet _drawImageDescriptorSet = nullptr;
+    DescriptorLayoutCache _descriptorLayoutCache;
     VkDescriptorSetLayout _drawImageDescriptorSetLayout = nullptr;
 
-    VkPipeline _gradientPipeline = nullptr;
+    BindlessHeap _bindlessHeap;
+    BindlessIndex _drawImageBindlessIndex = INVALID_BINDLESS_INDEX;
+    std::unordered_map<BufferHandle, BindlessIndex> _bindlessBuffers;
+
+    ThreadPool _threadPool;
+
+    UploadQueue _uploadQueue;
+    TextureLoader _textureLoader;
+    TextureStreamer _textureStreamer;
+    // initialized with the pipelines, it compiles the downsample shader
+    MipGenerator _mipGenerator;
+
+    ReadbackQueue _readbacks;
+    std::vector<ReadbackCallback> _frameCaptures;
+
+    GraphicsPipelineLibrary _pipelineLibrary;
+    PipelineManager _pipelineManager;
+
+    PipelineHandle _gradientPipeline = INVALID_PIPELINE_HANDLE;
     VkPipelineLayout _gradientPipelineLayout = nullptr;
+    ShaderObjects _gradientShaderObjects = {};
+
+    PipelineHandle _trianglePipeline = INVALID_PIPELINE_HANDLE;
+    ShaderObjects _triangleShaderObjects = {};
+
+    PipelineHandle _meshPipeline = INVALID_PIPELINE_HANDLE;
+    ShaderObjects _meshShaderObjects = {};
+
+    GPUMeshBuffers _rectangle = {};
+    std::optional<LoadedGltf> _scene;
+    StreamedTextureId _meshTexture = INVALID_STREAMED_TEXTURE;
+    SamplerHandle _linearSampler;
+    BindlessIndex _linearSamplerIndex = INVALID_BINDLESS_INDEX;
 
+#ifndef DIST
     Slang::ComPtr<slang::IGlobalSession> _slangGlobalSession;
-    Slang::ComPtr<slang::ISession> _slangSession;
+    ShaderCompiler _shaderCompiler;
+#else
+    ShaderArchive _shaderArchive;
+#endif
 
     void InitVulkan();
     void InitSwapchain();
     void InitCommands();
     void InitSyncStructures();
+    void InitBuffers();
     void InitDescriptors();
+    void InitUploads();
     void InitShaderCompiler();
     void InitPipelines();
     void InitBackgroundPipelines();
+    void InitTrianglePipeline();
+    void InitMeshPipeline();
+    void InitDefaultData();
+
+    void RunBenchmarks();
+
+    // Thread safe, the pipeline manager calls it from its workers.
+    std::optional<ShaderProgram> LoadShaderProgram(const char *moduleName,
+        std::span<const char *const> entryPoints);
+    std::optional<ShaderProgram> LoadShaderProgram(const char *moduleName,
+        std::initializer_list<const char *> entryPoints);
 
     void CreateSwapchain(uint32_t width, uint32_t height);
     void DestroySwapchain();
 
     FrameData& GetCurrentFrame() { return _frames[_frameNumber % FRAME_OVERLAP]; }
 
+    // DefragmentationService callback, points descriptors referencing the buffer at its new VkBuffer.
+    void OnBufferMoved(BufferHandle handle);
+
     void DrawBackground(VkCommandBuffer cmd);
+    void DrawGeometry(VkCommandBuffer cmd);
+    // The mesh pipeline must be bound. All surfaces share transform and sample _meshTexture once it
+    // has loaded, reporting the mip they need to the texture streamer.
+    void DrawMesh(VkCommandBuffer cmd,
+        const GPUMeshBuffers &meshBuffers,
+        std::span<const GeoSurface> surfaces,
+        const glm::mat4 &transform);
 };
@@ -0,0 +1,145 @@
+#include "vk_benchmarks.h"
+
+#include <chrono>
+
+#include "vk_descriptors.h"
+#include "vk_initializers.h"
+#include "vk_pipelines.h"
+
+using BenchmarkClock = std::chrono::high_resolution_clock;
+
+static double ElapsedMicroseconds(BenchmarkClock::time_point start) {
+    return std::chrono::duration<double, std::micro>(BenchmarkClock::now() - start).count();
+}
+
+void vk::BenchmarkShaderObjects(VkDevice device,
+    const ShaderProgram &program,
+    VkDescriptorSetLayout setLayout,
+    VkPipelineLayout pipelineLayout,
+    uint32_t iterations) {
+    const ShaderCode *computeCode = program.FindStage(VK_SHADER_STAGE_COMPUTE_BIT);
+    if (!computeCode || iterations == 0) {
+        return;
+    }
+
+    // module creation is part of the cost, shader objects consume the SPIR-V directly
+    double pipelineTime = 0.0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        const auto start = BenchmarkClock::now();
+
+        VkShaderModule shaderModule = CreateShaderModule(device, *computeCode).value();
+
+        VkComputePipelineCreateInfo computePipelineCreateInfo{};
+        computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        computePipelineCreateInfo.pNext = nullptr;
+        computePipelineCreateInfo.layout = pipelineLayout;
+        computePipelineCreateInfo.stage = PipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, shaderModule);
+
+        VkPipeline pipeline;
+        VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &pipeline));
+        vkDestroyShaderModule(device, shaderModule, nullptr);
+
+        pipelineTime += ElapsedMicroseconds(start);
+        vkDestroyPipeline(device, pipeline, nullptr);
+    }
+
+    double shaderObjectTime = 0.0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        const auto start = BenchmarkClock::now();
+
+        auto shaderObjects = CreateShaderObjects(device, program, std::span(&setLayout, 1));
+
+        shaderObjectTime += ElapsedMicroseconds(start);
+        if (shaderObjects.has_value()) {
+            DestroyShaderObjects(device, shaderObjects.value());
+        }
+    }
+
+    spdlog::info("[benchmark] compute pipeline: {:.1f} us, shader object: {:.1f} us (avg of {})",
+        pipelineTime / iterations,
+        shaderObjectTime / iterations,
+        iterations);
+}
+
+void vk::BenchmarkDescriptorBuffer(VkDevice device,
+    VkPhysicalDevice physicalDevice,
+    VmaAllocator allocator,
+    VkImageView imageView,
+    uint32_t iterations,
+    uint32_t setsPerIteration) {
+    if (iterations == 0 || setsPerIteration == 0) {
+        return;
+    }
+
+    DescriptorLayoutBuilder layoutBuilder;
+    layoutBuilder.AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    VkDescriptorSetLayout poolLayout = layoutBuilder.Build(device, VK_SHADER_STAGE_COMPUTE_BIT);
+    VkDescriptorSetLayout bufferLayout = layoutBuilder.Build(device,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT);
+
+    const DescriptorAllocatorGrowable::PoolSizeRatio poolSizeRatios[] = {
+        { .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .ratio = 1 }
+    };
+    DescriptorAllocatorGrowable poolAllocator;
+    poolAllocator.Init(device, setsPerIteration, poolSizeRatios);
+
+    // generous upper bound, storage image descriptors are well below 256 bytes everywhere
+    DescriptorAllocatorGrowable bufferAllocator;
+    bufferAllocator.InitDescriptorBuffer(device,
+        physicalDevice,
+        allocator,
+        static_cast<VkDeviceSize>(setsPerIteration) * 256);
+
+    double poolTime = 0.0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        const auto start = BenchmarkClock::now();
+
+        DescriptorWriter writer;
+        for (uint32_t s = 0; s < setsPerIteration; s++) {
+            writer.WriteImage(poolAllocator.Allocate(device, poolLayout),
+                0,
+                imageView,
+                VK_NULL_HANDLE,
+                VK_IMAGE_LAYOUT_GENERAL,
+                VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        }
+        writer.Flush(device);
+        poolAllocator.ClearPools(device);
+
+        poolTime += ElapsedMicroseconds(start);
+    }
+
+    double bufferTime = 0.0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        const auto start = BenchmarkClock::now();
+
+        // descriptor buffer sets are written one at a time, there is no batched update to amortize
+        DescriptorWriter writer;
+        for (uint32_t s = 0; s < setsPerIteration; s++) {
+            if (auto set = bufferAllocator.AllocateBufferSet(bufferLayout)) {
+                writer.WriteImage(VK_NULL_HANDLE,
+                    0,
+                    imageView,
+                    VK_NULL_HANDLE,
+                    VK_IMAGE_LAYOUT_GENERAL,
+                    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+                writer.Flush(bufferAllocator.descriptorBuffer, set.value());
+            }
+        }
+        bufferAllocator.ClearPools(device);
+
+        bufferTime += ElapsedMicroseconds(start);
+    }
+
+    spdlog::info("[benchmark] {} descriptor sets: pool {:.1f} us, descriptor buffer {:.1f} us (avg of {})",
+        setsPerIteration,
+        poolTime / iterations,
+        bufferTime / iterations,
+        iterations);
+
+    bufferAllocator.DestroyPools(device);
+    poolAllocator.DestroyPools(device);
+    vkDestroyDescriptorSetLayout(device, bufferLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, poolLayout, nullptr);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "vk_types.h"
+
+struct ShaderProgram;
+
+// Micro benchmarks comparing alternative Vulkan paths. They only log timings, run them through
+// Engine::RunBenchmarks with RUN_BENCHMARKS enabled.
+namespace vk {
+
+// Creation cost of the same compute program as a pipeline and as a shader object.
+void BenchmarkShaderObjects(VkDevice device,
+    const ShaderProgram &program,
+    VkDescriptorSetLayout setLayout,
+    VkPipelineLayout pipelineLayout,
+    uint32_t iterations);
+
+// CPU cost of allocating and writing setsPerIteration single storage image sets per iteration,
+// through descriptor pools and vkUpdateDescriptorSets versus VK_EXT_descriptor_buffer.
+void BenchmarkDescriptorBuffer(VkDevice device,
+    VkPhysicalDevice physicalDevice,
+    VmaAllocator allocator,
+    VkImageView imageView,
+    uint32_t iterations,
+    uint32_t setsPerIteration);
+
+}
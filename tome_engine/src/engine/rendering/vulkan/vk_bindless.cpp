@@ -0,0 +1,197 @@
+#include "vk_bindless.h"
+
+#include <algorithm>
+
+#include "vk_descriptors.h"
+
+// upper bounds, clamped to what the device allows for update-after-bind sets
+constexpr uint32_t MAX_SAMPLED_IMAGES = 16384;
+constexpr uint32_t MAX_STORAGE_IMAGES = 4096;
+constexpr uint32_t MAX_SAMPLERS = 256;
+constexpr uint32_t MAX_STORAGE_BUFFERS = 16384;
+
+static VkDescriptorType ToDescriptorType(BindlessResourceType type) {
+    switch (type) {
+        case BindlessResourceType::SampledImage: return VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        case BindlessResourceType::StorageImage: return VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        case BindlessResourceType::Sampler: return VK_DESCRIPTOR_TYPE_SAMPLER;
+        case BindlessResourceType::StorageBuffer: return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        default: return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    }
+}
+
+void BindlessHeap::Init(VkDevice device, VkPhysicalDevice physicalDevice) {
+    _device = device;
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties = {};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &indexingProperties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    auto arrayOf = [this](BindlessResourceType type) -> ResourceArray & {
+        return _arrays[static_cast<size_t>(type)];
+    };
+    // every binding is visible to all stages, so the per-stage limits bound each array as well as
+    // the per-set ones
+    arrayOf(BindlessResourceType::SampledImage).capacity = std::min({ MAX_SAMPLED_IMAGES,
+        indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages });
+    arrayOf(BindlessResourceType::StorageImage).capacity = std::min({ MAX_STORAGE_IMAGES,
+        indexingProperties.maxDescriptorSetUpdateAfterBindStorageImages,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageImages });
+    arrayOf(BindlessResourceType::Sampler).capacity = std::min({ MAX_SAMPLERS,
+        indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers });
+    arrayOf(BindlessResourceType::StorageBuffer).capacity = std::min({ MAX_STORAGE_BUFFERS,
+        indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+
+    // all arrays together also count against the stage's resource limit, shrink them evenly when
+    // they'd go over it
+    uint64_t totalCapacity = 0;
+    for (const ResourceArray &array : _arrays) {
+        totalCapacity += array.capacity;
+    }
+    const uint64_t maxResources = indexingProperties.maxPerStageUpdateAfterBindResources;
+    if (totalCapacity > maxResources) {
+        for (ResourceArray &array : _arrays) {
+            array.capacity = static_cast<uint32_t>(array.capacity * maxResources / totalCapacity);
+        }
+    }
+
+    DescriptorLayoutBuilder layoutBuilder;
+    std::array<VkDescriptorPoolSize, static_cast<size_t>(BindlessResourceType::Count)> poolSizes = {};
+    for (uint32_t i = 0; i < poolSizes.size(); i++) {
+        const VkDescriptorType descriptorType = ToDescriptorType(static_cast<BindlessResourceType>(i));
+
+        // slots are filled as resources register and may change while earlier frames are in flight
+        layoutBuilder.AddBinding(i,
+            descriptorType,
+            _arrays[i].capacity,
+            VK_SHADER_STAGE_ALL,
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT);
+
+        poolSizes[i].type = descriptorType;
+        poolSizes[i].descriptorCount = _arrays[i].capacity;
+    }
+    _setLayout = layoutBuilder.Build(_device, 0);
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    VK_CHECK(vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_pool));
+
+    VkDescriptorSetAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.descriptorPool = _pool;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts = &_setLayout;
+    VK_CHECK(vkAllocateDescriptorSets(_device, &allocateInfo, &_set));
+
+    const VkPushConstantRange pushConstantRange = GetPushConstantRange();
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &_setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    VK_CHECK(vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_pipelineLayout));
+}
+
+void BindlessHeap::Cleanup() {
+    vkDestroyPipelineLayout(_device, _pipelineLayout, nullptr);
+    vkDestroyDescriptorPool(_device, _pool, nullptr);
+    vkDestroyDescriptorSetLayout(_device, _setLayout, nullptr);
+    _arrays = {};
+}
+
+BindlessIndex BindlessHeap::RegisterSampledImage(VkImageView imageView, VkImageLayout layout) {
+    const BindlessIndex index = AllocateIndex(BindlessResourceType::SampledImage);
+    if (index != INVALID_BINDLESS_INDEX) {
+        const VkDescriptorImageInfo imageInfo = { .sampler = VK_NULL_HANDLE, .imageView = imageView, .imageLayout = layout };
+        Write(BindlessResourceType::SampledImage, index, &imageInfo, nullptr);
+    }
+    return index;
+}
+
+BindlessIndex BindlessHeap::RegisterStorageImage(VkImageView imageView) {
+    const BindlessIndex index = AllocateIndex(BindlessResourceType::StorageImage);
+    if (index != INVALID_BINDLESS_INDEX) {
+        const VkDescriptorImageInfo imageInfo = {
+            .sampler = VK_NULL_HANDLE,
+            .imageView = imageView,
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL };
+        Write(BindlessResourceType::StorageImage, index, &imageInfo, nullptr);
+    }
+    return index;
+}
+
+BindlessIndex BindlessHeap::RegisterSampler(VkSampler sampler) {
+    const BindlessIndex index = AllocateIndex(BindlessResourceType::Sampler);
+    if (index != INVALID_BINDLESS_INDEX) {
+        const VkDescriptorImageInfo imageInfo = { .sampler = sampler };
+        Write(BindlessResourceType::Sampler, index, &imageInfo, nullptr);
+    }
+    return index;
+}
+
+BindlessIndex BindlessHeap::RegisterStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    const BindlessIndex index = AllocateIndex(BindlessResourceType::StorageBuffer);
+    if (index != INVALID_BINDLESS_INDEX) {
+        const VkDescriptorBufferInfo bufferInfo = { .buffer = buffer, .offset = offset, .range = range };
+        Write(BindlessResourceType::StorageBuffer, index, nullptr, &bufferInfo);
+    }
+    return index;
+}
+
+void BindlessHeap::Release(BindlessResourceType type, BindlessIndex index) {
+    if (index == INVALID_BINDLESS_INDEX) {
+        return;
+    }
+    // the stale descriptor stays in place, partially bound arrays allow it as long as no shader reads it
+    _arrays[static_cast<size_t>(type)].freeIndices.push_back(index);
+}
+
+void BindlessHeap::Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint) const {
+    vkCmdBindDescriptorSets(cmd, bindPoint, _pipelineLayout, 0, 1, &_set, 0, nullptr);
+}
+
+BindlessIndex BindlessHeap::AllocateIndex(BindlessResourceType type) {
+    ResourceArray &array = _arrays[static_cast<size_t>(type)];
+
+    if (!array.freeIndices.empty()) {
+        const BindlessIndex index = array.freeIndices.back();
+        array.freeIndices.pop_back();
+        return index;
+    }
+
+    if (array.count == array.capacity) {
+        spdlog::error("bindless heap is out of {} slots", string_VkDescriptorType(ToDescriptorType(type)));
+        return INVALID_BINDLESS_INDEX;
+    }
+    return array.count++;
+}
+
+void BindlessHeap::Write(BindlessResourceType type,
+    BindlessIndex index,
+    const VkDescriptorImageInfo *imageInfo,
+    const VkDescriptorBufferInfo *bufferInfo) const {
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = _set;
+    write.dstBinding = static_cast<uint32_t>(type);
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = ToDescriptorType(type);
+    write.pImageInfo = imageInfo;
+    write.pBufferInfo = bufferInfo;
+
+    vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+}
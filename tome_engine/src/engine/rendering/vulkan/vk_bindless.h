@@ -0,0 +1,71 @@
+#pragma once
+
+#include "vk_types.h"
+
+using BindlessIndex = uint32_t;
+
+constexpr BindlessIndex INVALID_BINDLESS_INDEX = ~0u;
+
+// Binding of each resource array in the heap set, matches shaders/bindless.slang.
+enum class BindlessResourceType : uint32_t {
+    SampledImage = 0,
+    StorageImage = 1,
+    Sampler = 2,
+    StorageBuffer = 3,
+    Count,
+};
+
+// One global, update-after-bind descriptor set with a partially bound array per resource type.
+// Resources are registered once and keep their index until released, shaders reach them by
+// passing the index through push constants. The heap is bound once per command buffer, after
+// that draws and dispatches using GetPipelineLayout need no descriptor set binds at all.
+//
+// A released index is handed out again by the next Register call, so only release resources
+// once the frames that may still read them have retired (e.g. from a frame's deletion queue).
+class BindlessHeap {
+public:
+    static constexpr uint32_t PUSH_CONSTANT_SIZE = 128;
+
+    void Init(VkDevice device, VkPhysicalDevice physicalDevice);
+    void Cleanup();
+
+    BindlessIndex RegisterSampledImage(VkImageView imageView,
+        VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    BindlessIndex RegisterStorageImage(VkImageView imageView);
+    BindlessIndex RegisterSampler(VkSampler sampler);
+    BindlessIndex RegisterStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+    void Release(BindlessResourceType type, BindlessIndex index);
+
+    void Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint) const;
+
+    VkDescriptorSetLayout GetSetLayout() const { return _setLayout; }
+
+    // Heap set at set 0 plus PUSH_CONSTANT_SIZE bytes of push constants for every stage.
+    VkPipelineLayout GetPipelineLayout() const { return _pipelineLayout; }
+
+    static VkPushConstantRange GetPushConstantRange() {
+        return { .stageFlags = VK_SHADER_STAGE_ALL, .offset = 0, .size = PUSH_CONSTANT_SIZE };
+    }
+
+private:
+    struct ResourceArray {
+        uint32_t capacity = 0;
+        uint32_t count = 0;
+        std::vector<BindlessIndex> freeIndices;
+    };
+
+    VkDevice _device = VK_NULL_HANDLE;
+    VkDescriptorPool _pool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout _setLayout = VK_NULL_HANDLE;
+    VkDescriptorSet _set = VK_NULL_HANDLE;
+    VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
+
+    std::array<ResourceArray, static_cast<size_t>(BindlessResourceType::Count)> _arrays;
+
+    BindlessIndex AllocateIndex(BindlessResourceType type);
+    void Write(BindlessResourceType type,
+        BindlessIndex index,
+        const VkDescriptorImageInfo *imageInfo,
+        const VkDescriptorBufferInfo *bufferInfo) const;
+};
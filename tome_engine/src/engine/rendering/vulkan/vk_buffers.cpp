@@ -0,0 +1,102 @@
+#include "vk_buffers.h"
+
+#include <algorithm>
+#include <cstring>
+
+AllocatedBuffer vk::CreateBuffer(VkDevice device,
+    VmaAllocator allocator,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    VmaMemoryUsage memoryUsage,
+    VmaAllocationCreateFlags flags) {
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.pNext = nullptr;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+
+    VmaAllocationCreateInfo allocationCreateInfo = {};
+    allocationCreateInfo.usage = memoryUsage;
+    allocationCreateInfo.flags = flags;
+
+    AllocatedBuffer newBuffer = {};
+    VmaAllocationInfo allocationInfo;
+    VK_CHECK(vmaCreateBuffer(allocator,
+        &bufferInfo,
+        &allocationCreateInfo,
+        &newBuffer.buffer,
+        &newBuffer.allocation,
+        &allocationInfo));
+
+    newBuffer.mapped = allocationInfo.pMappedData;
+    newBuffer.size = size;
+    newBuffer.usage = usage;
+
+    if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
+        VkBufferDeviceAddressInfo addressInfo = {};
+        addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+        addressInfo.buffer = newBuffer.buffer;
+        newBuffer.deviceAddress = vkGetBufferDeviceAddress(device, &addressInfo);
+    }
+
+    return newBuffer;
+}
+
+void vk::DestroyBuffer(VmaAllocator allocator, const AllocatedBuffer &buffer) {
+    vmaDestroyBuffer(allocator, buffer.buffer, buffer.allocation);
+}
+
+void FrameRingBuffer::Init(VkDevice device,
+    VkPhysicalDevice physicalDevice,
+    VmaAllocator allocator,
+    VkDeviceSize frameSize,
+    uint32_t frameCount) {
+    _allocator = allocator;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    _alignment = std::max(properties.limits.minUniformBufferOffsetAlignment,
+        properties.limits.minStorageBufferOffsetAlignment);
+
+    _frameSize = vk::AlignUp(frameSize, _alignment);
+    _buffer = vk::CreateBuffer(device,
+        allocator,
+        _frameSize * frameCount,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+        VMA_MEMORY_USAGE_AUTO,
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+    BeginFrame(0);
+}
+
+void FrameRingBuffer::Cleanup() {
+    vk::DestroyBuffer(_allocator, _buffer);
+    _buffer = {};
+}
+
+void FrameRingBuffer::BeginFrame(uint32_t frameIndex) {
+    _frameBegin = _frameSize * frameIndex;
+    _cursor = _frameBegin;
+}
+
+void FrameRingBuffer::Flush() {
+    if (_cursor > _frameBegin) {
+        vmaFlushAllocation(_allocator, _buffer.allocation, _frameBegin, _cursor - _frameBegin);
+    }
+}
+
+std::optional<RingAllocation> FrameRingBuffer::Allocate(VkDeviceSize size) {
+    const VkDeviceSize offset = vk::AlignUp(_cursor, _alignment);
+    if (offset + size > _frameBegin + _frameSize) {
+        spdlog::error("frame ring buffer is full ({} bytes per frame)", _frameSize);
+        return {};
+    }
+    _cursor = offset + size;
+
+    return RingAllocation{
+        .data = static_cast<std::byte *>(_buffer.mapped) + offset,
+        .buffer = _buffer.buffer,
+        .offset = offset,
+        .deviceAddress = _buffer.deviceAddress + offset };
+}
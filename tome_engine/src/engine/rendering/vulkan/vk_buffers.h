@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstring>
+
+#include "vk_types.h"
+
+namespace vk {
+
+inline VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Buffers created with VMA_ALLOCATION_CREATE_MAPPED_BIT stay mapped for their whole lifetime.
+AllocatedBuffer CreateBuffer(VkDevice device,
+    VmaAllocator allocator,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    VmaMemoryUsage memoryUsage,
+    VmaAllocationCreateFlags flags = 0);
+
+void DestroyBuffer(VmaAllocator allocator, const AllocatedBuffer &buffer);
+
+}
+
+// Sub-allocation handed out by FrameRingBuffer, only valid for the frame it was made in.
+struct RingAllocation {
+    void *data;
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    VkDeviceAddress deviceAddress;
+};
+
+// One persistently mapped buffer split into a region per frame in flight. Allocations bump a
+// cursor through the current frame's region, so per-frame constants need no allocation and no
+// map/unmap. Regions are reused once their frame's fence has been waited on.
+class FrameRingBuffer {
+public:
+    void Init(VkDevice device,
+        VkPhysicalDevice physicalDevice,
+        VmaAllocator allocator,
+        VkDeviceSize frameSize,
+        uint32_t frameCount);
+    void Cleanup();
+
+    // Call after the fence of frameIndex has been waited on.
+    void BeginFrame(uint32_t frameIndex);
+
+    // Makes this frame's writes visible to the gpu, a no-op on host coherent memory.
+    void Flush();
+
+    // Returns std::nullopt when the frame's region is used up. Offsets are aligned for use as
+    // uniform and storage buffer descriptors.
+    std::optional<RingAllocation> Allocate(VkDeviceSize size);
+
+    template<typename T>
+    std::optional<RingAllocation> Push(const T &value) {
+        auto allocation = Allocate(sizeof(T));
+        if (allocation.has_value()) {
+            memcpy(allocation->data, &value, sizeof(T));
+        }
+        return allocation;
+    }
+
+    VkBuffer GetBuffer() const { return _buffer.buffer; }
+
+private:
+    VmaAllocator _allocator = nullptr;
+    AllocatedBuffer _buffer = {};
+    VkDeviceSize _frameSize = 0;
+    VkDeviceSize _alignment = 1;
+    VkDeviceSize _frameBegin = 0;
+    VkDeviceSize _cursor = 0;
+};
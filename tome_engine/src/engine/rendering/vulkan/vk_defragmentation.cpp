@@ -0,0 +1,193 @@
+#include "vk_defragmentation.h"
+
+void DefragmentationService::Init(VkDevice device,
+    VmaAllocator allocator,
+    ResourcePool &resources,
+    uint32_t framesInFlight) {
+    _device = device;
+    _allocator = allocator;
+    _resources = &resources;
+    _framesInFlight = framesInFlight;
+}
+
+void DefragmentationService::Cleanup() {
+    if (_passPending) {
+        EndPass();
+    }
+    if (_context) {
+        vmaEndDefragmentation(_allocator, _context, nullptr);
+        _context = nullptr;
+    }
+}
+
+void DefragmentationService::Update(VkCommandBuffer cmd, uint64_t frameNumber) {
+    if (_passPending) {
+        // the copies were recorded framesInFlight frames ago, the fence wait just before guarantees they finished
+        if (frameNumber < _passFrame + _framesInFlight) {
+            return;
+        }
+        EndPass();
+    }
+
+    if (!_context) {
+        if (frameNumber % CHECK_INTERVAL != 0 || !IsFragmented()) {
+            return;
+        }
+        Start();
+    }
+
+    if (_context) {
+        BeginPass(cmd);
+        _passFrame = frameNumber;
+    }
+}
+
+void DefragmentationService::Start() {
+    if (_context) {
+        return;
+    }
+
+    VmaDefragmentationInfo defragmentationInfo = {};
+    defragmentationInfo.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+    defragmentationInfo.maxBytesPerPass = MAX_BYTES_PER_PASS;
+    defragmentationInfo.maxAllocationsPerPass = MAX_MOVES_PER_PASS;
+    VK_CHECK(vmaBeginDefragmentation(_allocator, &defragmentationInfo, &_context));
+    spdlog::info("Defragmentation started");
+}
+
+bool DefragmentationService::IsFragmented() const {
+    VkPhysicalDeviceMemoryProperties const *memoryProperties;
+    vmaGetMemoryProperties(_allocator, &memoryProperties);
+
+    VmaTotalStatistics statistics;
+    vmaCalculateStatistics(_allocator, &statistics);
+
+    for (uint32_t heapIndex = 0; heapIndex < memoryProperties->memoryHeapCount; heapIndex++) {
+        if (!(memoryProperties->memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) {
+            continue;
+        }
+        const VmaDetailedStatistics &heap = statistics.memoryHeap[heapIndex];
+        // a single block with free space at its end is not fragmented, it has just not been filled yet
+        if (heap.statistics.blockCount > 1 && heap.unusedRangeCount > heap.statistics.blockCount &&
+            heap.statistics.blockBytes - heap.statistics.allocationBytes >
+            static_cast<VkDeviceSize>(heap.statistics.blockBytes * FRAGMENTATION_THRESHOLD)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void DefragmentationService::BeginPass(VkCommandBuffer cmd) {
+    const VkResult result = vmaBeginDefragmentationPass(_allocator, _context, &_pass);
+    if (result == VK_SUCCESS) {
+        // nothing left to move
+        Finish();
+        return;
+    }
+    if (result != VK_INCOMPLETE) {
+        VK_CHECK(result);
+    }
+
+    // earlier frames may still write the buffers about to be copied
+    VkMemoryBarrier2 memoryBarrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+    memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    memoryBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+    memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+
+    VkDependencyInfo copyDepInfo = {};
+    copyDepInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    copyDepInfo.memoryBarrierCount = 1;
+    copyDepInfo.pMemoryBarriers = &memoryBarrier;
+    vkCmdPipelineBarrier2(cmd, &copyDepInfo);
+
+    std::vector<VkBufferMemoryBarrier2> barriers;
+    for (uint32_t i = 0; i < _pass.moveCount; i++) {
+        VmaDefragmentationMove &move = _pass.pMoves[i];
+
+        const BufferHandle handle = _resources->FindBuffer(move.srcAllocation);
+        if (handle.IsNull() || _resources->GetBufferMapped(handle)) {
+            move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+            continue;
+        }
+
+        const VkBuffer oldBuffer = _resources->GetBuffer(handle);
+        const VkDeviceSize size = _resources->GetBufferSize(handle);
+        const VkBufferUsageFlags usage = _resources->GetBufferUsage(handle);
+
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = usage;
+
+        VkBuffer newBuffer;
+        VK_CHECK(vkCreateBuffer(_device, &bufferInfo, nullptr, &newBuffer));
+        VK_CHECK(vmaBindBufferMemory(_allocator, move.dstTmpAllocation, newBuffer));
+
+        VkDeviceAddress deviceAddress = 0;
+        if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
+            VkBufferDeviceAddressInfo addressInfo = {};
+            addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+            addressInfo.buffer = newBuffer;
+            deviceAddress = vkGetBufferDeviceAddress(_device, &addressInfo);
+        }
+
+        const VkBufferCopy copy = { .srcOffset = 0, .dstOffset = 0, .size = size };
+        vkCmdCopyBuffer(cmd, oldBuffer, newBuffer, 1, &copy);
+
+        VkBufferMemoryBarrier2 barrier = { .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = newBuffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        barriers.push_back(barrier);
+
+        _resources->ReplaceBuffer(handle, newBuffer, deviceAddress);
+        _oldBuffers.push_back(oldBuffer);
+
+        if (_bufferMoved) {
+            _bufferMoved(handle);
+        }
+    }
+
+    if (!barriers.empty()) {
+        VkDependencyInfo depInfo = {};
+        depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        depInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(barriers.size());
+        depInfo.pBufferMemoryBarriers = barriers.data();
+        vkCmdPipelineBarrier2(cmd, &depInfo);
+    }
+
+    _passPending = true;
+}
+
+void DefragmentationService::EndPass() {
+    for (VkBuffer buffer : _oldBuffers) {
+        vkDestroyBuffer(_device, buffer, nullptr);
+    }
+    _oldBuffers.clear();
+    _passPending = false;
+
+    // VK_SUCCESS means nothing is left to move
+    const VkResult result = vmaEndDefragmentationPass(_allocator, _context, &_pass);
+    if (result == VK_SUCCESS) {
+        Finish();
+    } else if (result != VK_INCOMPLETE) {
+        VK_CHECK(result);
+    }
+}
+
+void DefragmentationService::Finish() {
+    VmaDefragmentationStats stats;
+    vmaEndDefragmentation(_allocator, _context, &stats);
+    _context = nullptr;
+    spdlog::info("Defragmentation finished: {} KiB moved, {} KiB freed in {} allocations",
+        stats.bytesMoved / 1024,
+        stats.bytesFreed / 1024,
+        stats.allocationsMoved);
+}
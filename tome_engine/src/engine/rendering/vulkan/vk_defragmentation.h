@@ -0,0 +1,58 @@
+#pragma once
+
+#include "vk_resources.h"
+#include "vk_types.h"
+
+// Called after a pool buffer moved, for owners of descriptors that reference the buffer directly.
+using BufferMovedCallback = std::function<void(BufferHandle handle)>;
+
+// Runs VMA's incremental defragmentation a little every frame. A pass moves at most
+// MAX_BYTES_PER_PASS: new buffers are bound to the destination memory, the copies are recorded
+// into the frame's command buffer and the pool handles switch to the new buffers right away, so
+// everything recorded afterwards already uses them. The pass is ended, and the old buffers
+// destroyed, once that frame has retired.
+//
+// Only device local ResourcePool buffers move. Mapped buffers, images and memory not owned by the
+// pool are left in place, images can only be copied once their layout is known.
+class DefragmentationService {
+public:
+    static constexpr VkDeviceSize MAX_BYTES_PER_PASS = 8 * 1024 * 1024;
+    static constexpr uint32_t MAX_MOVES_PER_PASS = 64;
+
+    // frames between fragmentation checks while idle
+    static constexpr uint32_t CHECK_INTERVAL = 600;
+    // defragment once this fraction of the reserved device local memory is unused
+    static constexpr float FRAGMENTATION_THRESHOLD = 0.25f;
+
+    void Init(VkDevice device, VmaAllocator allocator, ResourcePool &resources, uint32_t framesInFlight);
+
+    // Finishes the pass in flight, the device must be idle.
+    void Cleanup();
+
+    // Call after the frame's fence wait with its command buffer recording, before any other command.
+    void Update(VkCommandBuffer cmd, uint64_t frameNumber);
+
+    // Starts defragmenting right away instead of waiting for the next fragmentation check.
+    void Start();
+
+    void SetBufferMovedCallback(BufferMovedCallback &&callback) { _bufferMoved = std::move(callback); }
+
+private:
+    VkDevice _device = VK_NULL_HANDLE;
+    VmaAllocator _allocator = nullptr;
+    ResourcePool *_resources = nullptr;
+    uint32_t _framesInFlight = 0;
+    BufferMovedCallback _bufferMoved;
+
+    VmaDefragmentationContext _context = nullptr;
+    VmaDefragmentationPassMoveInfo _pass = {};
+    bool _passPending = false;
+    uint64_t _passFrame = 0;
+    // buffers still bound to the source memory of the pending pass
+    std::vector<VkBuffer> _oldBuffers;
+
+    bool IsFragmented() const;
+    void BeginPass(VkCommandBuffer cmd);
+    void EndPass();
+    void Finish();
+};
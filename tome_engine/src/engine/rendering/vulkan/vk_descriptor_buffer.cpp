@@ -0,0 +1,173 @@
+#include "vk_descriptor_buffer.h"
+
+#include "vk_buffers.h"
+#include "vk_extensions.h"
+
+void DescriptorBufferAllocator::Init(VkDevice device,
+    VkPhysicalDevice physicalDevice,
+    VmaAllocator allocator,
+    VkDeviceSize size) {
+    _device = device;
+    _allocator = allocator;
+    _used = 0;
+
+    _properties = {};
+    _properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT;
+
+    VkPhysicalDeviceProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &_properties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    // written by the cpu every frame and read by the gpu directly, ideally from rebar memory
+    _buffer = vk::CreateBuffer(_device,
+        _allocator,
+        size,
+        VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT |
+        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+        VMA_MEMORY_USAGE_AUTO,
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+}
+
+void DescriptorBufferAllocator::Destroy() {
+    vk::DestroyBuffer(_allocator, _buffer);
+    _buffer = {};
+    _layoutSizes.clear();
+}
+
+std::optional<DescriptorBufferSet> DescriptorBufferAllocator::Allocate(VkDescriptorSetLayout layout) {
+    auto [it, inserted] = _layoutSizes.try_emplace(layout, 0);
+    if (inserted) {
+        vk::GetDescriptorSetLayoutSizeEXT(_device, layout, &it->second);
+        it->second = vk::AlignUp(it->second, _properties.descriptorBufferOffsetAlignment);
+    }
+
+    const VkDeviceSize offset = vk::AlignUp(_used, _properties.descriptorBufferOffsetAlignment);
+    if (offset + it->second > _buffer.size) {
+        spdlog::error("descriptor buffer is full ({} bytes)", _buffer.size);
+        return {};
+    }
+
+    _used = offset + it->second;
+    return DescriptorBufferSet{ .layout = layout, .offset = offset };
+}
+
+void DescriptorBufferAllocator::Clear() {
+    _used = 0;
+}
+
+void DescriptorBufferAllocator::WriteImage(const DescriptorBufferSet &set,
+    uint32_t binding,
+    VkImageView imageView,
+    VkSampler sampler,
+    VkImageLayout layout,
+    VkDescriptorType type,
+    uint32_t arrayElement) {
+    const VkDescriptorImageInfo imageInfo = { .sampler = sampler, .imageView = imageView, .imageLayout = layout };
+
+    VkDescriptorGetInfoEXT getInfo = {};
+    getInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT;
+    getInfo.type = type;
+    switch (type) {
+        case VK_DESCRIPTOR_TYPE_SAMPLER: getInfo.data.pSampler = &sampler; break;
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: getInfo.data.pCombinedImageSampler = &imageInfo; break;
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE: getInfo.data.pSampledImage = &imageInfo; break;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE: getInfo.data.pStorageImage = &imageInfo; break;
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT: getInfo.data.pInputAttachmentImage = &imageInfo; break;
+        default:
+            spdlog::error("{} is not an image descriptor", string_VkDescriptorType(type));
+            return;
+    }
+
+    WriteDescriptor(set, binding, arrayElement, getInfo);
+}
+
+void DescriptorBufferAllocator::WriteBuffer(const DescriptorBufferSet &set,
+    uint32_t binding,
+    VkBuffer buffer,
+    VkDeviceSize size,
+    VkDeviceSize offset,
+    VkDescriptorType type,
+    uint32_t arrayElement) {
+    // address descriptors carry an explicit range, the buffer's size is not known here
+    if (size == VK_WHOLE_SIZE) {
+        spdlog::error("descriptor buffer writes need an explicit buffer range");
+        return;
+    }
+
+    VkBufferDeviceAddressInfo bufferAddressInfo = {};
+    bufferAddressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+    bufferAddressInfo.buffer = buffer;
+
+    VkDescriptorAddressInfoEXT addressInfo = {};
+    addressInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT;
+    addressInfo.address = vkGetBufferDeviceAddress(_device, &bufferAddressInfo) + offset;
+    addressInfo.range = size;
+    addressInfo.format = VK_FORMAT_UNDEFINED;
+
+    VkDescriptorGetInfoEXT getInfo = {};
+    getInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT;
+    getInfo.type = type;
+    switch (type) {
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER: getInfo.data.pUniformBuffer = &addressInfo; break;
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: getInfo.data.pStorageBuffer = &addressInfo; break;
+        default:
+            spdlog::error("{} is not a buffer descriptor", string_VkDescriptorType(type));
+            return;
+    }
+
+    WriteDescriptor(set, binding, arrayElement, getInfo);
+}
+
+void DescriptorBufferAllocator::Bind(VkCommandBuffer cmd,
+    VkPipelineBindPoint bindPoint,
+    VkPipelineLayout pipelineLayout,
+    uint32_t firstSet,
+    std::span<const DescriptorBufferSet> sets) const {
+    VkDescriptorBufferBindingInfoEXT bindingInfo = {};
+    bindingInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT;
+    bindingInfo.address = _buffer.deviceAddress;
+    bindingInfo.usage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT;
+    vk::CmdBindDescriptorBuffersEXT(cmd, 1, &bindingInfo);
+
+    std::vector<uint32_t> bufferIndices(sets.size(), 0);
+    std::vector<VkDeviceSize> offsets;
+    offsets.reserve(sets.size());
+    for (const DescriptorBufferSet &set : sets) {
+        offsets.push_back(set.offset);
+    }
+
+    vk::CmdSetDescriptorBufferOffsetsEXT(cmd,
+        bindPoint,
+        pipelineLayout,
+        firstSet,
+        static_cast<uint32_t>(sets.size()),
+        bufferIndices.data(),
+        offsets.data());
+}
+
+size_t DescriptorBufferAllocator::GetDescriptorSize(VkDescriptorType type) const {
+    switch (type) {
+        case VK_DESCRIPTOR_TYPE_SAMPLER: return _properties.samplerDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: return _properties.combinedImageSamplerDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE: return _properties.sampledImageDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE: return _properties.storageImageDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT: return _properties.inputAttachmentDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER: return _properties.uniformBufferDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: return _properties.storageBufferDescriptorSize;
+        default: return 0;
+    }
+}
+
+void DescriptorBufferAllocator::WriteDescriptor(const DescriptorBufferSet &set,
+    uint32_t binding,
+    uint32_t arrayElement,
+    const VkDescriptorGetInfoEXT &getInfo) {
+    VkDeviceSize bindingOffset;
+    vk::GetDescriptorSetLayoutBindingOffsetEXT(_device, set.layout, binding, &bindingOffset);
+
+    // the elements of an array binding are packed tightly, one descriptor size apart
+    const size_t descriptorSize = GetDescriptorSize(getInfo.type);
+    vk::GetDescriptorEXT(_device, &getInfo, descriptorSize,
+        static_cast<std::byte *>(_buffer.mapped) + set.offset + bindingOffset + arrayElement * descriptorSize);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "vk_types.h"
+
+// Location of one descriptor set inside a DescriptorBufferAllocator.
+struct DescriptorBufferSet {
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+};
+
+// VK_EXT_descriptor_buffer backend. Sets are bump allocated from one persistently mapped buffer
+// and written with vkGetDescriptorEXT straight into it, with no pools and no vkUpdateDescriptorSets.
+// Binding a set only sets an offset. Allocation follows DescriptorAllocatorGrowable: Allocate,
+// Clear in bulk once the frames using the sets have retired, then Destroy. The writes take
+// DescriptorWriter's arguments but land in the buffer immediately, buffers are resolved to their
+// device address. Usually reached through DescriptorAllocatorGrowable::InitDescriptorBuffer and
+// DescriptorWriter::Flush rather than used directly.
+//
+// Layouts must be built with VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT and the
+// pipelines using them with VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT.
+class DescriptorBufferAllocator {
+public:
+    void Init(VkDevice device, VkPhysicalDevice physicalDevice, VmaAllocator allocator, VkDeviceSize size);
+    void Destroy();
+    bool IsInitialized() const { return _buffer.buffer != VK_NULL_HANDLE; }
+
+    std::optional<DescriptorBufferSet> Allocate(VkDescriptorSetLayout layout);
+    void Clear();
+
+    void WriteImage(const DescriptorBufferSet &set,
+        uint32_t binding,
+        VkImageView imageView,
+        VkSampler sampler,
+        VkImageLayout layout,
+        VkDescriptorType type,
+        uint32_t arrayElement = 0);
+    // buffer needs SHADER_DEVICE_ADDRESS usage, and size cannot be VK_WHOLE_SIZE.
+    void WriteBuffer(const DescriptorBufferSet &set,
+        uint32_t binding,
+        VkBuffer buffer,
+        VkDeviceSize size,
+        VkDeviceSize offset,
+        VkDescriptorType type,
+        uint32_t arrayElement = 0);
+
+    void Bind(VkCommandBuffer cmd,
+        VkPipelineBindPoint bindPoint,
+        VkPipelineLayout pipelineLayout,
+        uint32_t firstSet,
+        std::span<const DescriptorBufferSet> sets) const;
+
+    VkDeviceSize GetUsedSize() const { return _used; }
+
+private:
+    VkDevice _device = VK_NULL_HANDLE;
+    VmaAllocator _allocator = nullptr;
+    VkPhysicalDeviceDescriptorBufferPropertiesEXT _properties = {};
+
+    AllocatedBuffer _buffer = {};
+    VkDeviceSize _used = 0;
+
+    std::unordered_map<VkDescriptorSetLayout, VkDeviceSize> _layoutSizes;
+
+    size_t GetDescriptorSize(VkDescriptorType type) const;
+    void WriteDescriptor(const DescriptorBufferSet &set,
+        uint32_t binding,
+        uint32_t arrayElement,
+        const VkDescriptorGetInfoEXT &getInfo);
+};
@@ -1,17 +1,28 @@
 ﻿#include "vk_descriptors.h"
 
-DescriptorLayoutBuilder &DescriptorLayoutBuilder::AddBinding(uint32_t binding, VkDescriptorType type) {
+#include <algorithm>
+
+#include "vk_extensions.h"
+
+DescriptorLayoutBuilder &DescriptorLayoutBuilder::AddBinding(uint32_t binding,
+    VkDescriptorType type,
+    uint32_t count,
+    VkShaderStageFlags stages,
+    VkDescriptorBindingFlags flags) {
     VkDescriptorSetLayoutBinding newBind = {};
     newBind.binding = binding;
-    newBind.descriptorCount = 1;
+    newBind.descriptorCount = count;
     newBind.descriptorType = type;
+    newBind.stageFlags = stages;
 
     bindings.push_back(newBind);
+    bindingFlags.push_back(flags);
     return *this;
 }
 
 void DescriptorLayoutBuilder::Clear() {
     bindings.clear();
+    bindingFlags.clear();
 }
 
 VkDescriptorSetLayout DescriptorLayoutBuilder::Build(
@@ -23,6 +34,36 @@ VkDescriptorSetLayout DescriptorLayoutBuilder::Build(
         binding.stageFlags |= shaderStages;
     }
 
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo = {};
+    bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+
+    const bool hasBindingFlags = std::any_of(bindingFlags.begin(), bindingFlags.end(), [](VkDescriptorBindingFlags f) {
+        return f != 0;
+    });
+    if (hasBindingFlags) {
+        bindingFlagsCreateInfo.pNext = pNext;
+        bindingFlagsCreateInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+        bindingFlagsCreateInfo.pBindingFlags = bindingFlags.data();
+        pNext = &bindingFlagsCreateInfo;
+
+        uint32_t highestBinding = 0;
+        for (const auto &binding : bindings) {
+            highestBinding = std::max(highestBinding, binding.binding);
+        }
+
+        for (size_t i = 0; i < bindings.size(); i++) {
+            if (bindingFlags[i] & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) {
+                flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+            }
+            if ((bindingFlags[i] & VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT) &&
+                bindings[i].binding != highestBinding) {
+                spdlog::error("binding {} has a variable descriptor count but is not the last binding",
+                    bindings[i].binding);
+                return VK_NULL_HANDLE;
+            }
+        }
+    }
+
     VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {};
     descriptorSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     descriptorSetLayoutCreateInfo.pNext = pNext;
@@ -36,6 +77,135 @@ VkDescriptorSetLayout DescriptorLayoutBuilder::Build(
     return descriptorSetLayout;
 }
 
+DescriptorWriter &DescriptorWriter::WriteImage(VkDescriptorSet set,
+    uint32_t binding,
+    VkImageView imageView,
+    VkSampler sampler,
+    VkImageLayout layout,
+    VkDescriptorType type,
+    uint32_t arrayElement) {
+    const VkDescriptorImageInfo &imageInfo = imageInfos.emplace_back(
+        VkDescriptorImageInfo{ .sampler = sampler, .imageView = imageView, .imageLayout = layout });
+
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.pNext = nullptr;
+    write.dstSet = set;
+    write.dstBinding = binding;
+    write.dstArrayElement = arrayElement;
+    write.descriptorCount = 1;
+    write.descriptorType = type;
+    write.pImageInfo = &imageInfo;
+
+    writes.push_back(write);
+    return *this;
+}
+
+DescriptorWriter &DescriptorWriter::WriteBuffer(VkDescriptorSet set,
+    uint32_t binding,
+    VkBuffer buffer,
+    VkDeviceSize size,
+    VkDeviceSize offset,
+    VkDescriptorType type,
+    uint32_t arrayElement) {
+    const VkDescriptorBufferInfo &bufferInfo = bufferInfos.emplace_back(
+        VkDescriptorBufferInfo{ .buffer = buffer, .offset = offset, .range = size });
+
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.pNext = nullptr;
+    write.dstSet = set;
+    write.dstBinding = binding;
+    write.dstArrayElement = arrayElement;
+    write.descriptorCount = 1;
+    write.descriptorType = type;
+    write.pBufferInfo = &bufferInfo;
+
+    writes.push_back(write);
+    return *this;
+}
+
+DescriptorWriter &DescriptorWriter::WriteTexelBuffer(VkDescriptorSet set,
+    uint32_t binding,
+    VkBufferView bufferView,
+    VkDescriptorType type,
+    uint32_t arrayElement) {
+    const VkBufferView &texelBufferView = texelBufferViews.emplace_back(bufferView);
+
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.pNext = nullptr;
+    write.dstSet = set;
+    write.dstBinding = binding;
+    write.dstArrayElement = arrayElement;
+    write.descriptorCount = 1;
+    write.descriptorType = type;
+    write.pTexelBufferView = &texelBufferView;
+
+    writes.push_back(write);
+    return *this;
+}
+
+void DescriptorWriter::Clear() {
+    imageInfos.clear();
+    bufferInfos.clear();
+    texelBufferViews.clear();
+    writes.clear();
+}
+
+void DescriptorWriter::Flush(VkDevice device) {
+    if (!writes.empty()) {
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+    Clear();
+}
+
+void DescriptorWriter::Flush(DescriptorBufferAllocator &allocator, const DescriptorBufferSet &set) {
+    for (const VkWriteDescriptorSet &write : writes) {
+        for (uint32_t i = 0; i < write.descriptorCount; i++) {
+            const uint32_t arrayElement = write.dstArrayElement + i;
+            if (write.pImageInfo) {
+                const VkDescriptorImageInfo &imageInfo = write.pImageInfo[i];
+                allocator.WriteImage(set,
+                    write.dstBinding,
+                    imageInfo.imageView,
+                    imageInfo.sampler,
+                    imageInfo.imageLayout,
+                    write.descriptorType,
+                    arrayElement);
+            } else if (write.pBufferInfo) {
+                const VkDescriptorBufferInfo &bufferInfo = write.pBufferInfo[i];
+                allocator.WriteBuffer(set,
+                    write.dstBinding,
+                    bufferInfo.buffer,
+                    bufferInfo.range,
+                    bufferInfo.offset,
+                    write.descriptorType,
+                    arrayElement);
+            } else {
+                spdlog::error("{} is not supported in descriptor buffers",
+                    string_VkDescriptorType(write.descriptorType));
+            }
+        }
+    }
+    Clear();
+}
+
+void DescriptorWriter::Push(VkCommandBuffer cmd,
+    VkPipelineBindPoint bindPoint,
+    VkPipelineLayout pipelineLayout,
+    uint32_t set) {
+    if (!writes.empty()) {
+        vk::CmdPushDescriptorSetKHR(cmd,
+            bindPoint,
+            pipelineLayout,
+            set,
+            static_cast<uint32_t>(writes.size()),
+            writes.data());
+    }
+    Clear();
+}
+
 void DescriptorAllocator::InitPool(VkDevice device, uint32_t maxSets, std::span<PoolSizeRatio> poolSizeRatios) {
     std::vector<VkDescriptorPoolSize> descriptorPoolSizes;
     for (auto [descriptorType, ratio] : poolSizeRatios) {
@@ -75,4 +245,254 @@ VkDescriptorSet DescriptorAllocator::Allocate(VkDevice device, VkDescriptorSetLa
     VK_CHECK(vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &descriptorSet));
 
     return descriptorSet;
-}
\ No newline at end of file
+}
+void DescriptorAllocatorGrowable::Init(VkDevice device,
+    uint32_t initialSets,
+    std::span<const PoolSizeRatio> poolSizeRatios,
+    VkDescriptorPoolCreateFlags flags) {
+    ratios.assign(poolSizeRatios.begin(), poolSizeRatios.end());
+    poolFlags = flags;
+
+    readyPools.push_back(CreatePool(device, initialSets));
+    setsPerPool = std::min(initialSets * 2, MAX_SETS_PER_POOL);
+}
+
+void DescriptorAllocatorGrowable::InitDescriptorBuffer(VkDevice device,
+    VkPhysicalDevice physicalDevice,
+    VmaAllocator allocator,
+    VkDeviceSize size) {
+    descriptorBuffer.Init(device, physicalDevice, allocator, size);
+}
+
+void DescriptorAllocatorGrowable::ClearPools(VkDevice device) {
+    descriptorBuffer.Clear();
+    for (VkDescriptorPool pool : readyPools) {
+        vkResetDescriptorPool(device, pool, 0);
+    }
+    for (VkDescriptorPool pool : fullPools) {
+        vkResetDescriptorPool(device, pool, 0);
+        readyPools.push_back(pool);
+    }
+    fullPools.clear();
+}
+
+void DescriptorAllocatorGrowable::DestroyPools(VkDevice device) {
+    for (VkDescriptorPool pool : readyPools) {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+    for (VkDescriptorPool pool : fullPools) {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+    readyPools.clear();
+    fullPools.clear();
+
+    if (descriptorBuffer.IsInitialized()) {
+        descriptorBuffer.Destroy();
+    }
+}
+
+VkDescriptorSet DescriptorAllocatorGrowable::Allocate(VkDevice device,
+    VkDescriptorSetLayout descriptorSetLayout,
+    void *pNext) {
+    VkDescriptorPool pool = GetPool(device);
+
+    VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+    descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptorSetAllocateInfo.pNext = pNext;
+    descriptorSetAllocateInfo.descriptorPool = pool;
+    descriptorSetAllocateInfo.descriptorSetCount = 1;
+    descriptorSetAllocateInfo.pSetLayouts = &descriptorSetLayout;
+
+    VkDescriptorSet descriptorSet;
+    VkResult result = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &descriptorSet);
+
+    // the pool is exhausted, retire it and retry once on a fresh one
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+        fullPools.push_back(pool);
+
+        pool = GetPool(device);
+        descriptorSetAllocateInfo.descriptorPool = pool;
+        result = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &descriptorSet);
+    }
+    VK_CHECK(result);
+
+    readyPools.push_back(pool);
+    return descriptorSet;
+}
+
+VkDescriptorPool DescriptorAllocatorGrowable::GetPool(VkDevice device) {
+    if (!readyPools.empty()) {
+        VkDescriptorPool pool = readyPools.back();
+        readyPools.pop_back();
+        return pool;
+    }
+
+    VkDescriptorPool pool = CreatePool(device, setsPerPool);
+    setsPerPool = std::min(setsPerPool * 2, MAX_SETS_PER_POOL);
+    return pool;
+}
+
+VkDescriptorPool DescriptorAllocatorGrowable::CreatePool(VkDevice device, uint32_t setCount) const {
+    std::vector<VkDescriptorPoolSize> descriptorPoolSizes;
+    for (auto [descriptorType, ratio] : ratios) {
+        descriptorPoolSizes.push_back(
+            VkDescriptorPoolSize{
+                .type = descriptorType,
+                .descriptorCount = std::max(1u, static_cast<uint32_t>(ratio * static_cast<float>(setCount))) });
+    }
+
+    VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+    descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolCreateInfo.pNext = nullptr;
+    descriptorPoolCreateInfo.flags = poolFlags;
+    descriptorPoolCreateInfo.maxSets = setCount;
+    descriptorPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());
+    descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
+
+    VkDescriptorPool pool;
+    VK_CHECK(vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr, &pool));
+    return pool;
+}
+
+void DescriptorLayoutCache::Init(VkDevice device) {
+    _device = device;
+}
+
+void DescriptorLayoutCache::Cleanup() {
+    for (auto &[key, layout] : _layouts) {
+        vkDestroyDescriptorSetLayout(_device, layout, nullptr);
+    }
+    _layouts.clear();
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::Get(const DescriptorLayoutBuilder &builder,
+    VkShaderStageFlags shaderStages,
+    VkDescriptorSetLayoutCreateFlags flags) {
+    LayoutKey key = { .bindings = {}, .flags = flags };
+    for (size_t i = 0; i < builder.bindings.size(); i++) {
+        const VkDescriptorSetLayoutBinding &binding = builder.bindings[i];
+        key.bindings.push_back({
+            .binding = binding.binding,
+            .type = binding.descriptorType,
+            .count = binding.descriptorCount,
+            .stages = binding.stageFlags | shaderStages,
+            .flags = builder.bindingFlags[i] });
+    }
+    // binding order does not change the layout
+    std::sort(key.bindings.begin(), key.bindings.end(), [](const BindingKey &a, const BindingKey &b) {
+        return a.binding < b.binding;
+    });
+
+    if (auto it = _layouts.find(key); it != _layouts.end()) {
+        return it->second;
+    }
+
+    DescriptorLayoutBuilder layoutBuilder = builder;
+    VkDescriptorSetLayout layout = layoutBuilder.Build(_device, shaderStages, flags);
+    if (layout == VK_NULL_HANDLE) {
+        return VK_NULL_HANDLE;
+    }
+    _layouts.emplace(std::move(key), layout);
+    return layout;
+}
+
+size_t DescriptorLayoutCache::LayoutKeyHash::operator()(const LayoutKey &key) const {
+    size_t seed = 0;
+    vk::HashCombine(seed, key.flags);
+    for (const BindingKey &binding : key.bindings) {
+        vk::HashCombine(seed, binding.binding);
+        vk::HashCombine(seed, binding.type);
+        vk::HashCombine(seed, binding.count);
+        vk::HashCombine(seed, binding.stages);
+        vk::HashCombine(seed, binding.flags);
+    }
+    return seed;
+}
+
+VkDescriptorSet DescriptorSetCache::Get(VkDevice device,
+    DescriptorAllocatorGrowable &allocator,
+    VkDescriptorSetLayout layout,
+    DescriptorWriter &writer) {
+    SetKey key = MakeKey(layout, writer);
+    if (auto it = _sets.find(key); it != _sets.end()) {
+        writer.Clear();
+        return it->second;
+    }
+
+    VkDescriptorSet set = allocator.Allocate(device, layout);
+    for (VkWriteDescriptorSet &write : writer.writes) {
+        write.dstSet = set;
+    }
+    writer.Flush(device);
+
+    _sets.emplace(std::move(key), set);
+    return set;
+}
+
+std::optional<DescriptorBufferSet> DescriptorSetCache::GetBufferSet(DescriptorAllocatorGrowable &allocator,
+    VkDescriptorSetLayout layout,
+    DescriptorWriter &writer) {
+    SetKey key = MakeKey(layout, writer);
+    if (auto it = _bufferSets.find(key); it != _bufferSets.end()) {
+        writer.Clear();
+        return it->second;
+    }
+
+    std::optional<DescriptorBufferSet> set = allocator.AllocateBufferSet(layout);
+    if (!set.has_value()) {
+        writer.Clear();
+        return {};
+    }
+    writer.Flush(allocator.descriptorBuffer, set.value());
+
+    _bufferSets.emplace(std::move(key), set.value());
+    return set;
+}
+
+DescriptorSetCache::SetKey DescriptorSetCache::MakeKey(VkDescriptorSetLayout layout, const DescriptorWriter &writer) {
+    SetKey key = { .layout = layout, .resources = {} };
+    key.resources.reserve(writer.writes.size());
+    for (const VkWriteDescriptorSet &write : writer.writes) {
+        // one key per array element, an array write keyed on its first element alone would alias
+        // every set sharing it
+        for (uint32_t i = 0; i < write.descriptorCount; i++) {
+            ResourceKey resource = {};
+            resource.binding = write.dstBinding;
+            resource.arrayElement = write.dstArrayElement + i;
+            resource.type = write.descriptorType;
+            if (write.pImageInfo) {
+                resource.imageView = write.pImageInfo[i].imageView;
+                resource.sampler = write.pImageInfo[i].sampler;
+                resource.imageLayout = write.pImageInfo[i].imageLayout;
+            }
+            if (write.pBufferInfo) {
+                resource.buffer = write.pBufferInfo[i].buffer;
+                resource.offset = write.pBufferInfo[i].offset;
+                resource.range = write.pBufferInfo[i].range;
+            }
+            if (write.pTexelBufferView) {
+                resource.texelBufferView = write.pTexelBufferView[i];
+            }
+            key.resources.push_back(resource);
+        }
+    }
+    return key;
+}
+
+size_t DescriptorSetCache::SetKeyHash::operator()(const SetKey &key) const {
+    size_t seed = 0;
+    vk::HashCombine(seed, key.layout);
+    for (const ResourceKey &resource : key.resources) {
+        vk::HashCombine(seed, resource.binding);
+        vk::HashCombine(seed, resource.arrayElement);
+        vk::HashCombine(seed, resource.type);
+        vk::HashCombine(seed, resource.imageView);
+        vk::HashCombine(seed, resource.sampler);
+        vk::HashCombine(seed, resource.imageLayout);
+        vk::HashCombine(seed, resource.buffer);
+        vk::HashCombine(seed, resource.offset);
+        vk::HashCombine(seed, resource.range);
+        vk::HashCombine(seed, resource.texelBufferView);
+    }
+    return seed;
+}
@@ -1,17 +1,81 @@
 ﻿#pragma once
 
+#include <unordered_map>
+
+#include "vk_descriptor_buffer.h"
 #include "vk_types.h"
 
 struct DescriptorLayoutBuilder {
     std::vector<VkDescriptorSetLayoutBinding> bindings;
+    // parallel to bindings
+    std::vector<VkDescriptorBindingFlags> bindingFlags;
 
-    DescriptorLayoutBuilder &AddBinding(uint32_t binding, VkDescriptorType type);
+    // count > 1 declares an array. stages are added to the ones passed to Build.
+    // With VARIABLE_DESCRIPTOR_COUNT count is the upper bound, and it must be the highest binding.
+    DescriptorLayoutBuilder &AddBinding(uint32_t binding,
+        VkDescriptorType type,
+        uint32_t count = 1,
+        VkShaderStageFlags stages = 0,
+        VkDescriptorBindingFlags flags = 0);
     void Clear();
 
+    // VK_NULL_HANDLE and an error log when a variable count binding isn't the highest one.
     VkDescriptorSetLayout Build(VkDevice device,
         VkShaderStageFlags shaderStages,
         VkDescriptorSetLayoutCreateFlags flags = 0,
         void *pNext = nullptr);
+
+    // Layout whose set is never allocated, its descriptors are pushed with DescriptorWriter::Push.
+    // Requires VK_KHR_push_descriptor.
+    VkDescriptorSetLayout BuildPushDescriptor(VkDevice device,
+        VkShaderStageFlags shaderStages,
+        VkDescriptorSetLayoutCreateFlags flags = 0) {
+        return Build(device, shaderStages, flags | VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR);
+    }
+};
+
+// Collects descriptor writes for any number of sets and applies them with a single
+// vkUpdateDescriptorSets call, as push descriptors, or into a descriptor buffer set. The info
+// structs live in deques so the pointers the pending writes hold stay valid while more writes are
+// added.
+struct DescriptorWriter {
+    std::deque<VkDescriptorImageInfo> imageInfos;
+    std::deque<VkDescriptorBufferInfo> bufferInfos;
+    std::deque<VkBufferView> texelBufferViews;
+    std::vector<VkWriteDescriptorSet> writes;
+
+    DescriptorWriter &WriteImage(VkDescriptorSet set,
+        uint32_t binding,
+        VkImageView imageView,
+        VkSampler sampler,
+        VkImageLayout layout,
+        VkDescriptorType type,
+        uint32_t arrayElement = 0);
+    DescriptorWriter &WriteBuffer(VkDescriptorSet set,
+        uint32_t binding,
+        VkBuffer buffer,
+        VkDeviceSize size,
+        VkDeviceSize offset,
+        VkDescriptorType type,
+        uint32_t arrayElement = 0);
+    DescriptorWriter &WriteTexelBuffer(VkDescriptorSet set,
+        uint32_t binding,
+        VkBufferView bufferView,
+        VkDescriptorType type,
+        uint32_t arrayElement = 0);
+
+    void Clear();
+
+    // Applies every pending write in one driver call and clears the writer.
+    void Flush(VkDevice device);
+
+    // Writes the pending writes into set of a descriptor buffer, ignoring their dstSet, and clears
+    // the writer. Buffers are resolved to device addresses, texel buffers are not supported.
+    void Flush(DescriptorBufferAllocator &allocator, const DescriptorBufferSet &set);
+
+    // Records the pending writes into cmd as push descriptors for set, ignoring their dstSet, and
+    // clears the writer. The set must use a push descriptor layout. Requires VK_KHR_push_descriptor.
+    void Push(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set);
 };
 
 struct DescriptorAllocator {
@@ -28,4 +92,138 @@ struct DescriptorAllocator {
     void DestroyPool(VkDevice device) const;
 
     VkDescriptorSet Allocate(VkDevice device, VkDescriptorSetLayout descriptorSetLayout) const;
+};
+
+// Allocator that never runs out: when a pool is exhausted it moves to fullPools and allocation
+// retries on a ready or newly created pool, each new pool holding more sets than the last up to
+// MAX_SETS_PER_POOL. ClearPools resets every pool in bulk, which makes it a good fit for
+// per-frame descriptor sets that all die together.
+//
+// After InitDescriptorBuffer it also hands out VK_EXT_descriptor_buffer sets through
+// AllocateBufferSet. Those come from one fixed size buffer, cleared and destroyed with the pools.
+struct DescriptorAllocatorGrowable {
+    using PoolSizeRatio = DescriptorAllocator::PoolSizeRatio;
+
+    static constexpr uint32_t MAX_SETS_PER_POOL = 4092;
+
+    std::vector<PoolSizeRatio> ratios;
+    std::vector<VkDescriptorPool> fullPools;
+    std::vector<VkDescriptorPool> readyPools;
+    uint32_t setsPerPool = 0;
+    VkDescriptorPoolCreateFlags poolFlags = 0;
+    DescriptorBufferAllocator descriptorBuffer;
+
+    // Pass VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT to allocate sets with update-after-bind layouts.
+    void Init(VkDevice device,
+        uint32_t initialSets,
+        std::span<const PoolSizeRatio> poolSizeRatios,
+        VkDescriptorPoolCreateFlags flags = 0);
+    // Requires VK_EXT_descriptor_buffer.
+    void InitDescriptorBuffer(VkDevice device,
+        VkPhysicalDevice physicalDevice,
+        VmaAllocator allocator,
+        VkDeviceSize size);
+    void ClearPools(VkDevice device);
+    void DestroyPools(VkDevice device);
+
+    VkDescriptorSet Allocate(VkDevice device, VkDescriptorSetLayout descriptorSetLayout, void *pNext = nullptr);
+    // The layout must be built with VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT.
+    std::optional<DescriptorBufferSet> AllocateBufferSet(VkDescriptorSetLayout descriptorSetLayout) {
+        return descriptorBuffer.Allocate(descriptorSetLayout);
+    }
+
+private:
+    VkDescriptorPool GetPool(VkDevice device);
+    VkDescriptorPool CreatePool(VkDevice device, uint32_t setCount) const;
+};
+
+// Returns the same VkDescriptorSetLayout for identical binding lists instead of creating a new
+// one on every Build. Keyed by binding, type, count, stages and binding flags of every binding plus
+// the create flags.
+class DescriptorLayoutCache {
+public:
+    void Init(VkDevice device);
+    void Cleanup();
+
+    VkDescriptorSetLayout Get(const DescriptorLayoutBuilder &builder,
+        VkShaderStageFlags shaderStages,
+        VkDescriptorSetLayoutCreateFlags flags = 0);
+
+private:
+    struct BindingKey {
+        uint32_t binding;
+        VkDescriptorType type;
+        uint32_t count;
+        VkShaderStageFlags stages;
+        VkDescriptorBindingFlags flags;
+
+        bool operator==(const BindingKey &) const = default;
+    };
+
+    struct LayoutKey {
+        std::vector<BindingKey> bindings;
+        VkDescriptorSetLayoutCreateFlags flags;
+
+        bool operator==(const LayoutKey &) const = default;
+    };
+
+    struct LayoutKeyHash {
+        size_t operator()(const LayoutKey &key) const;
+    };
+
+    VkDevice _device = VK_NULL_HANDLE;
+    std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> _layouts;
+};
+
+// Per-frame cache of written descriptor sets keyed by layout plus the resources in a writer, so a
+// set with the same contents is allocated and written once per frame and reused after that.
+// Clear it whenever the allocator it draws from is reset.
+class DescriptorSetCache {
+public:
+    // The writer's writes are for the returned set, their dstSet is ignored. The writer is cleared.
+    VkDescriptorSet Get(VkDevice device,
+        DescriptorAllocatorGrowable &allocator,
+        VkDescriptorSetLayout layout,
+        DescriptorWriter &writer);
+    // Same for the allocator's descriptor buffer backend, nullopt once its buffer is full.
+    std::optional<DescriptorBufferSet> GetBufferSet(DescriptorAllocatorGrowable &allocator,
+        VkDescriptorSetLayout layout,
+        DescriptorWriter &writer);
+
+    void Clear() {
+        _sets.clear();
+        _bufferSets.clear();
+    }
+
+private:
+    struct ResourceKey {
+        uint32_t binding;
+        uint32_t arrayElement;
+        VkDescriptorType type;
+        VkImageView imageView;
+        VkSampler sampler;
+        VkImageLayout imageLayout;
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        VkDeviceSize range;
+        VkBufferView texelBufferView;
+
+        bool operator==(const ResourceKey &) const = default;
+    };
+
+    struct SetKey {
+        VkDescriptorSetLayout layout;
+        std::vector<ResourceKey> resources;
+
+        bool operator==(const SetKey &) const = default;
+    };
+
+    struct SetKeyHash {
+        size_t operator()(const SetKey &key) const;
+    };
+
+    std::unordered_map<SetKey, VkDescriptorSet, SetKeyHash> _sets;
+    std::unordered_map<SetKey, DescriptorBufferSet, SetKeyHash> _bufferSets;
+
+    static SetKey MakeKey(VkDescriptorSetLayout layout, const DescriptorWriter &writer);
 };
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "vk_extensions.h"
+
+PFN_vkCreateShadersEXT vk::CreateShadersEXT = nullptr;
+PFN_vkDestroyShaderEXT vk::DestroyShaderEXT = nullptr;
+PFN_vkCmdBindShadersEXT vk::CmdBindShadersEXT = nullptr;
+PFN_vkCmdSetPolygonModeEXT vk::CmdSetPolygonModeEXT = nullptr;
+PFN_vkCmdSetRasterizationSamplesEXT vk::CmdSetRasterizationSamplesEXT = nullptr;
+PFN_vkCmdSetSampleMaskEXT vk::CmdSetSampleMaskEXT = nullptr;
+PFN_vkCmdSetAlphaToCoverageEnableEXT vk::CmdSetAlphaToCoverageEnableEXT = nullptr;
+PFN_vkCmdSetColorBlendEnableEXT vk::CmdSetColorBlendEnableEXT = nullptr;
+PFN_vkCmdSetColorBlendEquationEXT vk::CmdSetColorBlendEquationEXT = nullptr;
+PFN_vkCmdSetColorWriteMaskEXT vk::CmdSetColorWriteMaskEXT = nullptr;
+PFN_vkCmdSetVertexInputEXT vk::CmdSetVertexInputEXT = nullptr;
+PFN_vkGetDescriptorSetLayoutSizeEXT vk::GetDescriptorSetLayoutSizeEXT = nullptr;
+PFN_vkGetDescriptorSetLayoutBindingOffsetEXT vk::GetDescriptorSetLayoutBindingOffsetEXT = nullptr;
+PFN_vkGetDescriptorEXT vk::GetDescriptorEXT = nullptr;
+PFN_vkCmdBindDescriptorBuffersEXT vk::CmdBindDescriptorBuffersEXT = nullptr;
+PFN_vkCmdSetDescriptorBufferOffsetsEXT vk::CmdSetDescriptorBufferOffsetsEXT = nullptr;
+PFN_vkCmdPushDescriptorSetKHR vk::CmdPushDescriptorSetKHR = nullptr;
+
+template<typename T>
+static void LoadDeviceFunction(VkDevice device, T &function, const char *name) {
+    function = reinterpret_cast<T>(vkGetDeviceProcAddr(device, name));
+    if (!function) {
+        spdlog::error("failed to load {}", name);
+    }
+}
+
+void vk::LoadDeviceExtensions(VkDevice device, const DeviceExtensions &extensions) {
+    if (extensions.shaderObject) {
+        LoadDeviceFunction(device, CreateShadersEXT, "vkCreateShadersEXT");
+        LoadDeviceFunction(device, DestroyShaderEXT, "vkDestroyShaderEXT");
+        LoadDeviceFunction(device, CmdBindShadersEXT, "vkCmdBindShadersEXT");
+        LoadDeviceFunction(device, CmdSetRasterizationSamplesEXT, "vkCmdSetRasterizationSamplesEXT");
+        LoadDeviceFunction(device, CmdSetSampleMaskEXT, "vkCmdSetSampleMaskEXT");
+        LoadDeviceFunction(device, CmdSetAlphaToCoverageEnableEXT, "vkCmdSetAlphaToCoverageEnableEXT");
+        LoadDeviceFunction(device, CmdSetVertexInputEXT, "vkCmdSetVertexInputEXT");
+    }
+
+    // shader objects expose the extended dynamic state 3 commands as well
+    if (extensions.shaderObject || extensions.extendedDynamicState3) {
+        LoadDeviceFunction(device, CmdSetPolygonModeEXT, "vkCmdSetPolygonModeEXT");
+        LoadDeviceFunction(device, CmdSetColorBlendEnableEXT, "vkCmdSetColorBlendEnableEXT");
+        LoadDeviceFunction(device, CmdSetColorBlendEquationEXT, "vkCmdSetColorBlendEquationEXT");
+        LoadDeviceFunction(device, CmdSetColorWriteMaskEXT, "vkCmdSetColorWriteMaskEXT");
+    }
+
+    if (extensions.descriptorBuffer) {
+        LoadDeviceFunction(device, GetDescriptorSetLayoutSizeEXT, "vkGetDescriptorSetLayoutSizeEXT");
+        LoadDeviceFunction(device, GetDescriptorSetLayoutBindingOffsetEXT, "vkGetDescriptorSetLayoutBindingOffsetEXT");
+        LoadDeviceFunction(device, GetDescriptorEXT, "vkGetDescriptorEXT");
+        LoadDeviceFunction(device, CmdBindDescriptorBuffersEXT, "vkCmdBindDescriptorBuffersEXT");
+        LoadDeviceFunction(device, CmdSetDescriptorBufferOffsetsEXT, "vkCmdSetDescriptorBufferOffsetsEXT");
+    }
+
+    if (extensions.pushDescriptor) {
+        LoadDeviceFunction(device, CmdPushDescriptorSetKHR, "vkCmdPushDescriptorSetKHR");
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "vk_types.h"
+
+// Optional device extensions the engine takes advantage of when the selected GPU has them.
+struct DeviceExtensions {
+    bool shaderObject = false;
+    bool extendedDynamicState3 = false;
+    bool graphicsPipelineLibrary = false;
+    bool descriptorBuffer = false;
+    bool pushDescriptor = false;
+    bool memoryBudget = false;
+};
+
+// Entry points of optional device extensions. The loader does not export these, so they are
+// fetched from the device once it is created and stay null when the extension is missing.
+namespace vk {
+
+extern PFN_vkCreateShadersEXT CreateShadersEXT;
+extern PFN_vkDestroyShaderEXT DestroyShaderEXT;
+extern PFN_vkCmdBindShadersEXT CmdBindShadersEXT;
+extern PFN_vkCmdSetPolygonModeEXT CmdSetPolygonModeEXT;
+extern PFN_vkCmdSetRasterizationSamplesEXT CmdSetRasterizationSamplesEXT;
+extern PFN_vkCmdSetSampleMaskEXT CmdSetSampleMaskEXT;
+extern PFN_vkCmdSetAlphaToCoverageEnableEXT CmdSetAlphaToCoverageEnableEXT;
+extern PFN_vkCmdSetColorBlendEnableEXT CmdSetColorBlendEnableEXT;
+extern PFN_vkCmdSetColorBlendEquationEXT CmdSetColorBlendEquationEXT;
+extern PFN_vkCmdSetColorWriteMaskEXT CmdSetColorWriteMaskEXT;
+extern PFN_vkCmdSetVertexInputEXT CmdSetVertexInputEXT;
+extern PFN_vkGetDescriptorSetLayoutSizeEXT GetDescriptorSetLayoutSizeEXT;
+extern PFN_vkGetDescriptorSetLayoutBindingOffsetEXT GetDescriptorSetLayoutBindingOffsetEXT;
+extern PFN_vkGetDescriptorEXT GetDescriptorEXT;
+extern PFN_vkCmdBindDescriptorBuffersEXT CmdBindDescriptorBuffersEXT;
+extern PFN_vkCmdSetDescriptorBufferOffsetsEXT CmdSetDescriptorBufferOffsetsEXT;
+extern PFN_vkCmdPushDescriptorSetKHR CmdPushDescriptorSetKHR;
+
+void LoadDeviceExtensions(VkDevice device, const DeviceExtensions &extensions);
+
+}
@@ -1,5 +1,8 @@
 #include "vk_images.h"
 
+#include <algorithm>
+#include <bit>
+
 #include "vk_initializers.h"
 
 void vk::TransitionImage(const VkCommandBuffer cmd,
@@ -68,4 +71,167 @@ void vk::CopyImageToImage(VkCommandBuffer cmd,
     blitInfo.pRegions = &blitRegion;
 
     vkCmdBlitImage2(cmd, &blitInfo);
-}
\ No newline at end of file
+}
+
+uint32_t vk::FormatTexelSize(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_UINT:
+        return 1;
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R16_SFLOAT:
+    case VK_FORMAT_R16_UINT:
+        return 2;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+    case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_R32_UINT:
+        return 4;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_R16G16B16A16_UNORM:
+    case VK_FORMAT_R32G32_SFLOAT:
+        return 8;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+vk::FormatBlock vk::GetFormatBlock(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+    case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+    case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+        return { 4, 4, 8 };
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+    case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+    case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+        return { 4, 4, 16 };
+    default:
+        return { 1, 1, FormatTexelSize(format) };
+    }
+}
+
+VkDeviceSize vk::ImageByteSize(VkFormat format, VkExtent2D extent) {
+    const FormatBlock block = GetFormatBlock(format);
+    const VkDeviceSize blocksX = (extent.width + block.width - 1) / block.width;
+    const VkDeviceSize blocksY = (extent.height + block.height - 1) / block.height;
+    return blocksX * blocksY * block.size;
+}
+
+uint32_t vk::MipLevelCount(VkExtent2D extent) {
+    return static_cast<uint32_t>(std::bit_width(std::max({ extent.width, extent.height, 1u })));
+}
+
+static VkImageMemoryBarrier2 MipBarrier(VkImage image, uint32_t baseMipLevel, uint32_t levelCount) {
+    VkImageMemoryBarrier2 barrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+    barrier.image = image;
+    barrier.subresourceRange = vk::ImageSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
+    barrier.subresourceRange.baseMipLevel = baseMipLevel;
+    barrier.subresourceRange.levelCount = levelCount;
+    return barrier;
+}
+
+static void MipPipelineBarrier(VkCommandBuffer cmd, const VkImageMemoryBarrier2 *barriers, uint32_t count) {
+    VkDependencyInfo depInfo{};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.imageMemoryBarrierCount = count;
+    depInfo.pImageMemoryBarriers = barriers;
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+}
+
+void vk::GenerateMipmaps(VkCommandBuffer cmd,
+    VkImage image,
+    VkExtent2D extent,
+    uint32_t mipLevels,
+    VkImageLayout level0Layout) {
+    VkImageMemoryBarrier2 barriers[2];
+    barriers[0] = MipBarrier(image, 0, 1);
+    barriers[0].srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    barriers[0].srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+    barriers[0].dstStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+    barriers[0].oldLayout = level0Layout;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    uint32_t barrierCount = 1;
+    if (mipLevels > 1) {
+        barriers[1] = MipBarrier(image, 1, mipLevels - 1);
+        barriers[1].srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+        barriers[1].srcAccessMask = VK_ACCESS_2_NONE;
+        barriers[1].dstStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT;
+        barriers[1].dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrierCount = 2;
+    }
+    MipPipelineBarrier(cmd, barriers, barrierCount);
+
+    for (uint32_t mip = 1; mip < mipLevels; mip++) {
+        VkImageBlit2 blitRegion{ .sType = VK_STRUCTURE_TYPE_IMAGE_BLIT_2, .pNext = nullptr };
+        blitRegion.srcOffsets[1].x = static_cast<int32_t>(std::max(1u, extent.width >> (mip - 1)));
+        blitRegion.srcOffsets[1].y = static_cast<int32_t>(std::max(1u, extent.height >> (mip - 1)));
+        blitRegion.srcOffsets[1].z = 1;
+        blitRegion.dstOffsets[1].x = static_cast<int32_t>(std::max(1u, extent.width >> mip));
+        blitRegion.dstOffsets[1].y = static_cast<int32_t>(std::max(1u, extent.height >> mip));
+        blitRegion.dstOffsets[1].z = 1;
+        blitRegion.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - 1, 0, 1 };
+        blitRegion.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, 1 };
+
+        VkBlitImageInfo2 blitInfo{ .sType = VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2, .pNext = nullptr };
+        blitInfo.srcImage = image;
+        blitInfo.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        blitInfo.dstImage = image;
+        blitInfo.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        blitInfo.filter = VK_FILTER_LINEAR;
+        blitInfo.regionCount = 1;
+        blitInfo.pRegions = &blitRegion;
+        vkCmdBlitImage2(cmd, &blitInfo);
+
+        // the level just written is the source of the next blit
+        barriers[0] = MipBarrier(image, mip, 1);
+        barriers[0].srcStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT;
+        barriers[0].srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barriers[0].dstStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT;
+        barriers[0].dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        MipPipelineBarrier(cmd, barriers, 1);
+    }
+
+    barriers[0] = MipBarrier(image, 0, mipLevels);
+    barriers[0].srcStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT;
+    barriers[0].srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barriers[0].dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    MipPipelineBarrier(cmd, barriers, 1);
+}
@@ -9,4 +9,32 @@ void TransitionImage(VkCommandBuffer cmd, VkImage image, VkImageLayout currentLa
 
 void CopyImageToImage(VkCommandBuffer cmd, VkImage source, VkImage destination, VkExtent2D srcSize, VkExtent2D dstSize);
 
+// Bytes per texel of uncompressed color formats, 0 for block compressed and unhandled formats.
+uint32_t FormatTexelSize(VkFormat format);
+
+struct FormatBlock {
+    uint32_t width;
+    uint32_t height;
+    uint32_t size;
+};
+
+// Texel block extent and bytes of BC, ETC2/EAC and ASTC 4x4 formats, 1x1 blocks of
+// FormatTexelSize for uncompressed ones. size is 0 for unhandled formats.
+FormatBlock GetFormatBlock(VkFormat format);
+
+// Bytes of one tightly packed image of extent in format, 0 for unhandled formats.
+VkDeviceSize ImageByteSize(VkFormat format, VkExtent2D extent);
+
+// Levels of a full mip chain down to 1x1.
+uint32_t MipLevelCount(VkExtent2D extent);
+
+// Fills levels 1 to mipLevels - 1 by blitting each level from the one above it. Level 0 is in
+// level0Layout, the others are discarded, afterwards every level is in SHADER_READ_ONLY_OPTIMAL.
+// The format needs BLIT_SRC, BLIT_DST and SAMPLED_IMAGE_FILTER_LINEAR support.
+void GenerateMipmaps(VkCommandBuffer cmd,
+    VkImage image,
+    VkExtent2D extent,
+    uint32_t mipLevels,
+    VkImageLayout level0Layout);
+
 };
\ No newline at end of file
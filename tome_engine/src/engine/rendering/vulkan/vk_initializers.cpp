@@ -239,7 +239,10 @@ VkDescriptorBufferInfo vk::BufferInfo(VkBuffer buffer, VkDeviceSize offset, VkDe
     return binfo;
 }
 
-VkImageCreateInfo vk::ImageCreateInfo(VkFormat format, VkImageUsageFlags usageFlags, VkExtent3D extent) {
+VkImageCreateInfo vk::ImageCreateInfo(VkFormat format,
+    VkImageUsageFlags usageFlags,
+    VkExtent3D extent,
+    uint32_t mipLevels) {
     VkImageCreateInfo info = {};
     info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     info.pNext = nullptr;
@@ -249,7 +252,7 @@ VkImageCreateInfo vk::ImageCreateInfo(VkFormat format, VkImageUsageFlags usageFl
     info.format = format;
     info.extent = extent;
 
-    info.mipLevels = 1;
+    info.mipLevels = mipLevels;
     info.arrayLayers = 1;
 
     //for MSAA. we will not be using it by default, so default it to 1 sample per pixel.
@@ -262,7 +265,10 @@ VkImageCreateInfo vk::ImageCreateInfo(VkFormat format, VkImageUsageFlags usageFl
     return info;
 }
 
-VkImageViewCreateInfo vk::ImageviewCreateInfo(VkFormat format, VkImage image, VkImageAspectFlags aspectFlags) {
+VkImageViewCreateInfo vk::ImageviewCreateInfo(VkFormat format,
+    VkImage image,
+    VkImageAspectFlags aspectFlags,
+    uint32_t mipLevels) {
     // build a image-view for the depth image to use for rendering
     VkImageViewCreateInfo info = {};
     info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -272,7 +278,7 @@ VkImageViewCreateInfo vk::ImageviewCreateInfo(VkFormat format, VkImage image, Vk
     info.image = image;
     info.format = format;
     info.subresourceRange.baseMipLevel = 0;
-    info.subresourceRange.levelCount = 1;
+    info.subresourceRange.levelCount = mipLevels;
     info.subresourceRange.baseArrayLayer = 0;
     info.subresourceRange.layerCount = 1;
     info.subresourceRange.aspectMask = aspectFlags;
@@ -57,8 +57,14 @@ VkWriteDescriptorSet WriteDescriptorBuffer(VkDescriptorType type,
 
 VkDescriptorBufferInfo BufferInfo(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
 
-VkImageCreateInfo ImageCreateInfo(VkFormat format, VkImageUsageFlags usageFlags, VkExtent3D extent);
-VkImageViewCreateInfo ImageviewCreateInfo(VkFormat format, VkImage image, VkImageAspectFlags aspectFlags);
+VkImageCreateInfo ImageCreateInfo(VkFormat format,
+    VkImageUsageFlags usageFlags,
+    VkExtent3D extent,
+    uint32_t mipLevels = 1);
+VkImageViewCreateInfo ImageviewCreateInfo(VkFormat format,
+    VkImage image,
+    VkImageAspectFlags aspectFlags,
+    uint32_t mipLevels = 1);
 VkPipelineLayoutCreateInfo PipelineLayoutCreateInfo();
 VkPipelineShaderStageCreateInfo PipelineShaderStageCreateInfo(VkShaderStageFlagBits stage,
     VkShaderModule shaderModule,
@@ -1,2 +1,661 @@
-﻿
-#include "vk_loader.h"
\ No newline at end of file
+﻿#include "vk_loader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "engine/core/json.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include "glm/gtc/type_ptr.hpp"
+#include "vk_mesh_optimizer.h"
+
+// https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html
+static constexpr uint32_t GLB_MAGIC = 0x46546C67;
+static constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+static constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+static constexpr uint32_t GLTF_BYTE = 5120;
+static constexpr uint32_t GLTF_UNSIGNED_BYTE = 5121;
+static constexpr uint32_t GLTF_SHORT = 5122;
+static constexpr uint32_t GLTF_UNSIGNED_SHORT = 5123;
+static constexpr uint32_t GLTF_UNSIGNED_INT = 5125;
+static constexpr uint32_t GLTF_FLOAT = 5126;
+
+static constexpr uint32_t GLTF_TRIANGLES = 4;
+
+struct GlbHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t length;
+};
+
+struct GlbChunkHeader {
+    uint32_t length;
+    uint32_t type;
+};
+
+struct GltfFile {
+    std::string path;
+    JsonValue json;
+    std::vector<std::vector<std::byte>> buffers;
+};
+
+// Elements of an accessor, validated to lie within their buffer.
+struct AccessorView {
+    const std::byte *data;
+    uint32_t count;
+    uint32_t stride;
+    uint32_t componentType;
+    uint32_t componentCount;
+    bool normalized;
+};
+
+static std::optional<std::vector<std::byte>> ReadFile(const std::filesystem::path &path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return std::nullopt;
+    }
+
+    std::vector<std::byte> contents(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char *>(contents.data()), static_cast<std::streamsize>(contents.size()))) {
+        return std::nullopt;
+    }
+    return contents;
+}
+
+static bool DecodeBase64(std::string_view text, std::vector<std::byte> &bytes) {
+    uint32_t bits = 0;
+    uint32_t bitCount = 0;
+    for (const char c : text) {
+        uint32_t value;
+        if (c >= 'A' && c <= 'Z') {
+            value = c - 'A';
+        } else if (c >= 'a' && c <= 'z') {
+            value = c - 'a' + 26;
+        } else if (c >= '0' && c <= '9') {
+            value = c - '0' + 52;
+        } else if (c == '+') {
+            value = 62;
+        } else if (c == '/') {
+            value = 63;
+        } else if (c == '=') {
+            break;
+        } else {
+            return false;
+        }
+
+        bits = (bits << 6) | value;
+        bitCount += 6;
+        if (bitCount >= 8) {
+            bitCount -= 8;
+            bytes.push_back(static_cast<std::byte>((bits >> bitCount) & 0xFF));
+        }
+    }
+    return true;
+}
+
+// URIs of external files are percent encoded.
+static std::string DecodeUri(std::string_view uri) {
+    std::string decoded;
+    for (size_t i = 0; i < uri.size(); i++) {
+        if (uri[i] == '%' && i + 2 < uri.size() && isxdigit(static_cast<unsigned char>(uri[i + 1])) &&
+            isxdigit(static_cast<unsigned char>(uri[i + 2]))) {
+            decoded += static_cast<char>(std::stoi(std::string(uri.substr(i + 1, 2)), nullptr, 16));
+            i += 2;
+        } else {
+            decoded += uri[i];
+        }
+    }
+    return decoded;
+}
+
+static bool LoadBuffers(GltfFile &gltf, std::vector<std::byte> &&glbBinary) {
+    const JsonValue &buffers = gltf.json["buffers"];
+    gltf.buffers.resize(buffers.Size());
+
+    for (size_t i = 0; i < buffers.Size(); i++) {
+        const JsonValue &buffer = buffers[i];
+        const std::string &uri = buffer["uri"].AsString();
+        std::vector<std::byte> &data = gltf.buffers[i];
+
+        if (!buffer.Contains("uri")) {
+            // the first buffer of a .glb may refer to the binary chunk
+            if (i != 0) {
+                spdlog::error("{}: buffer {} has no uri", gltf.path, i);
+                return false;
+            }
+            data = std::move(glbBinary);
+        } else if (uri.starts_with("data:")) {
+            const size_t base64 = uri.find(";base64,");
+            if (base64 == std::string::npos || !DecodeBase64(std::string_view(uri).substr(base64 + 8), data)) {
+                spdlog::error("{}: buffer {} is not a base64 data uri", gltf.path, i);
+                return false;
+            }
+        } else {
+            const std::filesystem::path bufferPath = std::filesystem::path(gltf.path).parent_path() / DecodeUri(uri);
+            std::optional<std::vector<std::byte>> contents = ReadFile(bufferPath);
+            if (!contents) {
+                spdlog::error("{}: failed to read buffer {}", gltf.path, bufferPath.string());
+                return false;
+            }
+            data = std::move(*contents);
+        }
+
+        if (data.size() < buffer["byteLength"].AsUint()) {
+            spdlog::error("{}: buffer {} is shorter than its byteLength", gltf.path, i);
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::optional<GltfFile> ReadGltf(const std::string &path) {
+    std::optional<std::vector<std::byte>> contents = ReadFile(path);
+    if (!contents) {
+        spdlog::error("Failed to open glTF file {}", path);
+        return std::nullopt;
+    }
+
+    std::string_view jsonText(reinterpret_cast<const char *>(contents->data()), contents->size());
+    std::vector<std::byte> glbBinary;
+
+    GlbHeader header = {};
+    if (contents->size() >= sizeof(header)) {
+        memcpy(&header, contents->data(), sizeof(header));
+    }
+    if (header.magic == GLB_MAGIC) {
+        // a JSON chunk followed by an optional binary chunk
+        const size_t length = std::min<size_t>(header.length, contents->size());
+        size_t offset = sizeof(header);
+        jsonText = {};
+        while (offset + sizeof(GlbChunkHeader) <= length) {
+            GlbChunkHeader chunk;
+            memcpy(&chunk, contents->data() + offset, sizeof(chunk));
+            offset += sizeof(chunk);
+            if (chunk.length > length - offset) {
+                break;
+            }
+
+            const std::byte *chunkData = contents->data() + offset;
+            if (chunk.type == GLB_CHUNK_JSON && jsonText.empty()) {
+                jsonText = { reinterpret_cast<const char *>(chunkData), chunk.length };
+            } else if (chunk.type == GLB_CHUNK_BIN && glbBinary.empty()) {
+                glbBinary.assign(chunkData, chunkData + chunk.length);
+            }
+            // chunks are padded to 4 bytes
+            offset += (chunk.length + 3) & ~3u;
+        }
+
+        if (header.version != 2 || jsonText.empty()) {
+            spdlog::error("{} is not a glTF 2.0 binary", path);
+            return std::nullopt;
+        }
+    }
+
+    std::optional<JsonValue> json = JsonValue::Parse(jsonText);
+    if (!json) {
+        spdlog::error("{} is not a glTF file", path);
+        return std::nullopt;
+    }
+
+    GltfFile gltf;
+    gltf.path = path;
+    gltf.json = std::move(*json);
+    if (!gltf.json["asset"]["version"].AsString().starts_with("2.")) {
+        spdlog::error("{} is not glTF 2.0", path);
+        return std::nullopt;
+    }
+    if (!LoadBuffers(gltf, std::move(glbBinary))) {
+        return std::nullopt;
+    }
+    return gltf;
+}
+
+static uint32_t ComponentSize(uint32_t componentType) {
+    switch (componentType) {
+    case GLTF_BYTE:
+    case GLTF_UNSIGNED_BYTE:
+        return 1;
+    case GLTF_SHORT:
+    case GLTF_UNSIGNED_SHORT:
+        return 2;
+    case GLTF_UNSIGNED_INT:
+    case GLTF_FLOAT:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+static uint32_t ComponentCount(const std::string &type) {
+    if (type == "SCALAR") {
+        return 1;
+    }
+    if (type == "VEC2") {
+        return 2;
+    }
+    if (type == "VEC3") {
+        return 3;
+    }
+    if (type == "VEC4") {
+        return 4;
+    }
+    return 0;
+}
+
+static std::optional<AccessorView> GetAccessor(const GltfFile &gltf, uint32_t accessorIndex) {
+    const JsonValue &accessor = gltf.json["accessors"][accessorIndex];
+    if (accessor.IsNull()) {
+        spdlog::error("{}: accessor {} does not exist", gltf.path, accessorIndex);
+        return std::nullopt;
+    }
+    if (accessor.Contains("sparse")) {
+        spdlog::error("{}: accessor {} is sparse, which is not supported", gltf.path, accessorIndex);
+        return std::nullopt;
+    }
+
+    AccessorView view = {};
+    view.count = accessor["count"].AsUint();
+    view.componentType = accessor["componentType"].AsUint();
+    view.componentCount = ComponentCount(accessor["type"].AsString());
+    view.normalized = accessor["normalized"].AsBool();
+
+    const uint32_t elementSize = ComponentSize(view.componentType) * view.componentCount;
+    if (!accessor.Contains("bufferView")) {
+        if (elementSize == 0) {
+            spdlog::error("{}: accessor {} is invalid", gltf.path, accessorIndex);
+            return std::nullopt;
+        }
+        // no buffer view means all zeros, every element reads the same zeroed one
+        static constexpr std::byte ZERO_ELEMENT[16] = {};
+        view.data = ZERO_ELEMENT;
+        view.stride = 0;
+        return view;
+    }
+
+    const JsonValue &bufferView = gltf.json["bufferViews"][accessor["bufferView"].AsUint(UINT32_MAX)];
+    const uint32_t bufferIndex = bufferView["buffer"].AsUint(UINT32_MAX);
+    if (elementSize == 0 || bufferView.IsNull() || bufferIndex >= gltf.buffers.size()) {
+        spdlog::error("{}: accessor {} is invalid", gltf.path, accessorIndex);
+        return std::nullopt;
+    }
+
+    view.stride = bufferView["byteStride"].AsUint(elementSize);
+    const uint64_t viewOffset = bufferView["byteOffset"].AsUint();
+    const uint64_t viewLength = bufferView["byteLength"].AsUint();
+    const uint64_t accessorOffset = accessor["byteOffset"].AsUint();
+    const uint64_t accessorLength = view.count == 0 ? 0 : uint64_t(view.count - 1) * view.stride + elementSize;
+    const std::vector<std::byte> &buffer = gltf.buffers[bufferIndex];
+    if (viewOffset + viewLength > buffer.size() || accessorOffset + accessorLength > viewLength) {
+        spdlog::error("{}: accessor {} is out of bounds", gltf.path, accessorIndex);
+        return std::nullopt;
+    }
+
+    view.data = buffer.data() + viewOffset + accessorOffset;
+    return view;
+}
+
+static float ReadComponent(const std::byte *data, uint32_t componentType, bool normalized) {
+    switch (componentType) {
+    case GLTF_FLOAT: {
+        float value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+    case GLTF_UNSIGNED_BYTE: {
+        const auto value = static_cast<float>(std::to_integer<uint8_t>(*data));
+        return normalized ? value / 255.f : value;
+    }
+    case GLTF_BYTE: {
+        const auto value = static_cast<float>(static_cast<int8_t>(std::to_integer<uint8_t>(*data)));
+        return normalized ? std::max(value / 127.f, -1.f) : value;
+    }
+    case GLTF_UNSIGNED_SHORT: {
+        uint16_t value;
+        memcpy(&value, data, sizeof(value));
+        return normalized ? float(value) / 65535.f : float(value);
+    }
+    case GLTF_SHORT: {
+        int16_t value;
+        memcpy(&value, data, sizeof(value));
+        return normalized ? std::max(float(value) / 32767.f, -1.f) : float(value);
+    }
+    default:
+        return 0.f;
+    }
+}
+
+// Calls function with each element of an attribute as floats, up to four components.
+template<typename Function>
+static bool ReadAttribute(const GltfFile &gltf,
+    const JsonValue &attributes,
+    const char *name,
+    uint32_t vertexCount,
+    uint32_t minComponents,
+    Function &&function) {
+    if (!attributes.Contains(name)) {
+        return true;
+    }
+
+    std::optional<AccessorView> view = GetAccessor(gltf, attributes[name].AsUint(UINT32_MAX));
+    if (!view) {
+        return false;
+    }
+    if (view->count != vertexCount || view->componentCount < minComponents) {
+        spdlog::error("{}: attribute {} does not match the primitive's vertices", gltf.path, name);
+        return false;
+    }
+
+    const uint32_t componentSize = ComponentSize(view->componentType);
+    for (uint32_t i = 0; i < view->count; i++) {
+        float values[4] = { 0.f, 0.f, 0.f, 1.f };
+        const std::byte *element = view->data + size_t(i) * view->stride;
+        for (uint32_t c = 0; c < view->componentCount; c++) {
+            values[c] = ReadComponent(element + c * componentSize, view->componentType, view->normalized);
+        }
+        function(i, values);
+    }
+    return true;
+}
+
+static bool ReadIndices(const GltfFile &gltf, uint32_t accessorIndex, std::vector<uint32_t> &indices) {
+    std::optional<AccessorView> view = GetAccessor(gltf, accessorIndex);
+    if (!view) {
+        return false;
+    }
+    if (view->componentCount != 1 || view->componentType == GLTF_FLOAT || view->componentType == GLTF_BYTE ||
+        view->componentType == GLTF_SHORT) {
+        spdlog::error("{}: index accessor {} is not an unsigned integer", gltf.path, accessorIndex);
+        return false;
+    }
+
+    indices.resize(view->count);
+    for (uint32_t i = 0; i < view->count; i++) {
+        const std::byte *element = view->data + size_t(i) * view->stride;
+        if (view->componentType == GLTF_UNSIGNED_BYTE) {
+            indices[i] = std::to_integer<uint32_t>(*element);
+        } else if (view->componentType == GLTF_UNSIGNED_SHORT) {
+            uint16_t index;
+            memcpy(&index, element, sizeof(index));
+            indices[i] = index;
+        } else {
+            memcpy(&indices[i], element, sizeof(uint32_t));
+        }
+    }
+    return true;
+}
+
+// Primitives of a mesh sharing a material, gathered before they are optimized together.
+struct MaterialBatch {
+    uint32_t materialIndex;
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+static bool LoadPrimitive(const GltfFile &gltf, const JsonValue &primitive, MaterialBatch &batch) {
+    const JsonValue &attributes = primitive["attributes"];
+    std::optional<AccessorView> positions = GetAccessor(gltf, attributes["POSITION"].AsUint(UINT32_MAX));
+    if (!positions) {
+        return false;
+    }
+
+    const uint32_t vertexCount = positions->count;
+    std::vector<Vertex> vertices(vertexCount);
+    for (Vertex &vertex : vertices) {
+        vertex.uvX = 0.f;
+        vertex.uvY = 0.f;
+        vertex.normal = glm::vec3(0.f);
+        vertex.color = glm::vec4(1.f);
+    }
+
+    const bool attributesRead =
+        ReadAttribute(gltf, attributes, "POSITION", vertexCount, 3, [&](uint32_t i, const float *values) {
+            vertices[i].position = glm::vec3(values[0], values[1], values[2]);
+        }) &&
+        ReadAttribute(gltf, attributes, "NORMAL", vertexCount, 3, [&](uint32_t i, const float *values) {
+            vertices[i].normal = glm::vec3(values[0], values[1], values[2]);
+        }) &&
+        ReadAttribute(gltf, attributes, "TEXCOORD_0", vertexCount, 2, [&](uint32_t i, const float *values) {
+            vertices[i].uvX = values[0];
+            vertices[i].uvY = values[1];
+        }) &&
+        ReadAttribute(gltf, attributes, "COLOR_0", vertexCount, 3, [&](uint32_t i, const float *values) {
+            vertices[i].color = glm::vec4(values[0], values[1], values[2], values[3]);
+        });
+    if (!attributesRead) {
+        return false;
+    }
+
+    std::vector<uint32_t> indices;
+    if (primitive.Contains("indices")) {
+        if (!ReadIndices(gltf, primitive["indices"].AsUint(UINT32_MAX), indices)) {
+            return false;
+        }
+    } else {
+        indices.resize(vertexCount);
+        for (uint32_t i = 0; i < vertexCount; i++) {
+            indices[i] = i;
+        }
+    }
+
+    // degenerate triangles draw nothing and only confuse the cache optimization
+    size_t kept = 0;
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        const uint32_t a = indices[t];
+        const uint32_t b = indices[t + 1];
+        const uint32_t c = indices[t + 2];
+        if (a >= vertexCount || b >= vertexCount || c >= vertexCount) {
+            spdlog::error("{}: primitive index out of range", gltf.path);
+            return false;
+        }
+        if (a != b && b != c && a != c) {
+            indices[kept++] = a;
+            indices[kept++] = b;
+            indices[kept++] = c;
+        }
+    }
+    indices.resize(kept);
+
+    // without normals the spec asks for flat shading, smooth area weighted ones are close enough
+    // until there is a tangent space pass
+    if (!attributes.Contains("NORMAL")) {
+        for (size_t t = 0; t < indices.size(); t += 3) {
+            const glm::vec3 &p0 = vertices[indices[t]].position;
+            const glm::vec3 &p1 = vertices[indices[t + 1]].position;
+            const glm::vec3 &p2 = vertices[indices[t + 2]].position;
+            const glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+            for (size_t i = 0; i < 3; i++) {
+                vertices[indices[t + i]].normal += faceNormal;
+            }
+        }
+        for (Vertex &vertex : vertices) {
+            const float length = glm::length(vertex.normal);
+            vertex.normal = length > 0.f ? vertex.normal / length : glm::vec3(0.f, 0.f, 1.f);
+        }
+    }
+
+    const auto baseVertex = static_cast<uint32_t>(batch.vertices.size());
+    batch.vertices.insert(batch.vertices.end(), vertices.begin(), vertices.end());
+    for (uint32_t index : indices) {
+        batch.indices.push_back(baseVertex + index);
+    }
+    return true;
+}
+
+static bool LoadMesh(const GltfFile &gltf, const JsonValue &mesh, MeshGeometry &geometry, float &missesBefore) {
+    geometry.name = mesh["name"].AsString();
+
+    std::vector<MaterialBatch> batches;
+    const JsonValue &primitives = mesh["primitives"];
+    for (size_t p = 0; p < primitives.Size(); p++) {
+        const JsonValue &primitive = primitives[p];
+        if (primitive["mode"].AsUint(GLTF_TRIANGLES) != GLTF_TRIANGLES) {
+            spdlog::warn("{}: skipped primitive of mesh {}, only triangle lists are supported",
+                gltf.path,
+                geometry.name);
+            continue;
+        }
+
+        const uint32_t materialIndex = primitive["material"].AsUint(INVALID_MATERIAL_INDEX);
+        auto batch = std::find_if(batches.begin(), batches.end(), [&](const MaterialBatch &candidate) {
+            return candidate.materialIndex == materialIndex;
+        });
+        if (batch == batches.end()) {
+            batches.emplace_back().materialIndex = materialIndex;
+            batch = batches.end() - 1;
+        }
+        if (!LoadPrimitive(gltf, primitive, *batch)) {
+            return false;
+        }
+    }
+
+    for (MaterialBatch &batch : batches) {
+        if (batch.indices.empty()) {
+            continue;
+        }
+
+        const float triangles = float(batch.indices.size() / 3);
+        missesBefore += vk::AverageCacheMissRatio(batch.indices, batch.vertices.size()) * triangles;
+        vk::OptimizeVertexCache(batch.indices, batch.vertices.size());
+        vk::OptimizeOverdraw(batch.indices, batch.vertices);
+        vk::OptimizeVertexFetch(batch.indices, batch.vertices);
+
+        const auto baseVertex = static_cast<uint32_t>(geometry.vertices.size());
+        geometry.surfaces.push_back({
+            .startIndex = static_cast<uint32_t>(geometry.indices.size()),
+            .count = static_cast<uint32_t>(batch.indices.size()),
+            .materialIndex = batch.materialIndex,
+        });
+        geometry.vertices.insert(geometry.vertices.end(), batch.vertices.begin(), batch.vertices.end());
+        for (uint32_t index : batch.indices) {
+            geometry.indices.push_back(baseVertex + index);
+        }
+    }
+    return true;
+}
+
+static glm::mat4 NodeTransform(const JsonValue &node) {
+    const JsonValue &matrix = node["matrix"];
+    if (matrix.Size() == 16) {
+        // column major, as glm stores it
+        float values[16];
+        for (size_t i = 0; i < 16; i++) {
+            values[i] = matrix[i].AsFloat();
+        }
+        return glm::make_mat4(values);
+    }
+
+    const JsonValue &translation = node["translation"];
+    const JsonValue &rotation = node["rotation"];
+    const JsonValue &scale = node["scale"];
+    const glm::vec3 t(translation[0].AsFloat(), translation[1].AsFloat(), translation[2].AsFloat());
+    const glm::quat r(rotation[3].AsFloat(1.f), rotation[0].AsFloat(), rotation[1].AsFloat(), rotation[2].AsFloat());
+    const glm::vec3 s(scale[0].AsFloat(1.f), scale[1].AsFloat(1.f), scale[2].AsFloat(1.f));
+    return glm::translate(glm::mat4(1.f), t) * glm::mat4_cast(r) * glm::scale(glm::mat4(1.f), s);
+}
+
+static bool LoadNodes(const GltfFile &gltf, GltfScene &scene) {
+    const JsonValue &nodes = gltf.json["nodes"];
+    scene.nodes.resize(nodes.Size());
+
+    for (uint32_t n = 0; n < nodes.Size(); n++) {
+        const JsonValue &node = nodes[n];
+        SceneNode &sceneNode = scene.nodes[n];
+        sceneNode.name = node["name"].AsString();
+        sceneNode.meshIndex = node["mesh"].AsUint(INVALID_MESH_INDEX);
+        sceneNode.localTransform = NodeTransform(node);
+        if (sceneNode.meshIndex != INVALID_MESH_INDEX && sceneNode.meshIndex >= scene.meshes.size()) {
+            spdlog::error("{}: node {} refers to a missing mesh", gltf.path, n);
+            return false;
+        }
+
+        // a child with a second parent would make the hierarchy a graph, or a cycle
+        const JsonValue &children = node["children"];
+        for (size_t c = 0; c < children.Size(); c++) {
+            const uint32_t child = children[c].AsUint(INVALID_NODE_INDEX);
+            if (child >= nodes.Size() || child == n || scene.nodes[child].parent != INVALID_NODE_INDEX) {
+                spdlog::error("{}: node {} has an invalid child", gltf.path, n);
+                return false;
+            }
+            scene.nodes[child].parent = n;
+            sceneNode.children.push_back(child);
+        }
+    }
+
+    // the default scene, or every node without a parent when the file has no scenes
+    const JsonValue &scenes = gltf.json["scenes"];
+    if (scenes.Size() > 0) {
+        const JsonValue &rootNodes = scenes[gltf.json["scene"].AsUint(0)]["nodes"];
+        for (size_t r = 0; r < rootNodes.Size(); r++) {
+            const uint32_t root = rootNodes[r].AsUint(INVALID_NODE_INDEX);
+            if (root >= scene.nodes.size() || scene.nodes[root].parent != INVALID_NODE_INDEX) {
+                spdlog::error("{}: scene root {} is not a root node", gltf.path, root);
+                return false;
+            }
+            scene.rootNodes.push_back(root);
+        }
+    } else {
+        for (uint32_t n = 0; n < scene.nodes.size(); n++) {
+            if (scene.nodes[n].parent == INVALID_NODE_INDEX) {
+                scene.rootNodes.push_back(n);
+            }
+        }
+    }
+
+    std::vector<uint32_t> stack(scene.rootNodes.rbegin(), scene.rootNodes.rend());
+    while (!stack.empty()) {
+        SceneNode &node = scene.nodes[stack.back()];
+        stack.pop_back();
+
+        node.worldTransform = node.parent == INVALID_NODE_INDEX ?
+                                  node.localTransform :
+                                  scene.nodes[node.parent].worldTransform * node.localTransform;
+        stack.insert(stack.end(), node.children.rbegin(), node.children.rend());
+    }
+    return true;
+}
+
+std::optional<GltfScene> vk::LoadGltf(const std::string &path) {
+    std::optional<GltfFile> gltf = ReadGltf(path);
+    if (!gltf) {
+        return std::nullopt;
+    }
+
+    GltfScene scene;
+    const JsonValue &meshes = gltf->json["meshes"];
+    scene.meshes.resize(meshes.Size());
+
+    float missesBefore = 0.f;
+    float missesAfter = 0.f;
+    size_t triangleCount = 0;
+    for (size_t m = 0; m < meshes.Size(); m++) {
+        MeshGeometry &geometry = scene.meshes[m];
+        if (!LoadMesh(*gltf, meshes[m], geometry, missesBefore)) {
+            return std::nullopt;
+        }
+
+        for (const GeoSurface &surface : geometry.surfaces) {
+            const std::span<const uint32_t> indices(&geometry.indices[surface.startIndex], surface.count);
+            missesAfter += vk::AverageCacheMissRatio(indices, geometry.vertices.size()) * float(surface.count / 3);
+            triangleCount += surface.count / 3;
+        }
+    }
+
+    if (!LoadNodes(*gltf, scene)) {
+        return std::nullopt;
+    }
+
+    if (triangleCount > 0) {
+        spdlog::info("Loaded {}: {} meshes, {} triangles, vertex cache miss ratio {:.3f} -> {:.3f}",
+            path,
+            scene.meshes.size(),
+            triangleCount,
+            missesBefore / float(triangleCount),
+            missesAfter / float(triangleCount));
+    }
+    return scene;
+}
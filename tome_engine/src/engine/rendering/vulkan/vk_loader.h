@@ -1 +1,64 @@
 ﻿#pragma once
+
+#include <optional>
+
+#include "vk_resources.h"
+
+constexpr uint32_t INVALID_MESH_INDEX = ~0u;
+constexpr uint32_t INVALID_NODE_INDEX = ~0u;
+constexpr uint32_t INVALID_MATERIAL_INDEX = ~0u;
+
+// Range of a mesh's index buffer drawn with one material.
+struct GeoSurface {
+    uint32_t startIndex;
+    uint32_t count;
+    // into the file's materials, INVALID_MATERIAL_INDEX for primitives without one
+    uint32_t materialIndex;
+};
+
+// One glTF mesh, its primitives merged into a surface per material and optimized for the post
+// transform cache, overdraw and vertex fetch (see vk_mesh_optimizer.h).
+struct MeshGeometry {
+    std::string name;
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<GeoSurface> surfaces;
+};
+
+// Mesh whose geometry lives in gpu buffers.
+struct MeshAsset {
+    std::string name;
+    std::vector<GeoSurface> surfaces;
+    GPUMeshBuffers meshBuffers;
+};
+
+struct SceneNode {
+    std::string name;
+    uint32_t meshIndex = INVALID_MESH_INDEX;
+    uint32_t parent = INVALID_NODE_INDEX;
+    std::vector<uint32_t> children;
+    glm::mat4 localTransform = glm::mat4(1.f);
+    // localTransform under all of the node's parents
+    glm::mat4 worldTransform = glm::mat4(1.f);
+};
+
+// Node hierarchy of the default scene of a glTF file, nodes index into meshes.
+template<typename Mesh>
+struct Scene {
+    std::vector<Mesh> meshes;
+    std::vector<SceneNode> nodes;
+    std::vector<uint32_t> rootNodes;
+};
+
+using GltfScene = Scene<MeshGeometry>;
+using LoadedGltf = Scene<MeshAsset>;
+
+namespace vk {
+
+// Reads a glTF 2.0 file, .gltf with external or embedded base64 buffers or binary .glb. Takes
+// positions, normals, the first UV set, the first vertex color and the node hierarchy, and
+// optimizes every mesh. Only triangle lists are loaded, and sparse accessors are not supported.
+// Blocks on file io and optimization, call it at load time or from a worker.
+std::optional<GltfScene> LoadGltf(const std::string &path);
+
+};
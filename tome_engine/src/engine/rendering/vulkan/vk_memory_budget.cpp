@@ -0,0 +1,93 @@
+#include "vk_memory_budget.h"
+
+#include <algorithm>
+
+static VkDeviceSize GetThreshold(const HeapBudget &heap) {
+    return static_cast<VkDeviceSize>(static_cast<double>(heap.budget) * MemoryBudget::EVICTION_THRESHOLD);
+}
+
+void MemoryBudget::Init(VmaAllocator allocator, bool hasBudgetExtension) {
+    _allocator = allocator;
+    _hasBudgetExtension = hasBudgetExtension;
+
+    vmaGetMemoryProperties(_allocator, &_memoryProperties);
+    _heaps.resize(_memoryProperties->memoryHeapCount);
+    _budgets.resize(_memoryProperties->memoryHeapCount);
+    _overBudget.assign(_memoryProperties->memoryHeapCount, false);
+
+    Update(0);
+    LogStats();
+}
+
+void MemoryBudget::Update(uint32_t frameIndex) {
+    // without the extension VMA estimates usage from its own allocations and budget as 80% of the heap
+    vmaSetCurrentFrameIndex(_allocator, frameIndex);
+    vmaGetHeapBudgets(_allocator, _budgets.data());
+
+    for (uint32_t heapIndex = 0; heapIndex < _heaps.size(); heapIndex++) {
+        const VmaBudget &budget = _budgets[heapIndex];
+        HeapBudget &heap = _heaps[heapIndex];
+        heap.usage = budget.usage;
+        heap.budget = budget.budget;
+        heap.allocatedBytes = budget.statistics.allocationBytes;
+        heap.reservedBytes = budget.statistics.blockBytes;
+        heap.allocationCount = budget.statistics.allocationCount;
+        heap.deviceLocal = _memoryProperties->memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+
+        const VkDeviceSize threshold = GetThreshold(heap);
+        const bool overBudget = heap.usage > threshold;
+        if (overBudget != _overBudget[heapIndex]) {
+            _overBudget[heapIndex] = overBudget;
+            if (overBudget) {
+                spdlog::warn("Memory heap {} at {} of {} MiB budget, evicting",
+                    heapIndex,
+                    heap.usage / (1024 * 1024),
+                    heap.budget / (1024 * 1024));
+            }
+        }
+        if (!overBudget) {
+            continue;
+        }
+
+        VkDeviceSize bytesToFree = heap.usage - threshold;
+        for (const Evictor &evictor : _evictors) {
+            const VkDeviceSize freed = evictor.callback(heapIndex, bytesToFree);
+            bytesToFree -= std::min(freed, bytesToFree);
+            if (bytesToFree == 0) {
+                break;
+            }
+        }
+    }
+}
+
+void MemoryBudget::AddEvictionCallback(uint32_t priority, EvictionCallback &&callback) {
+    auto position = std::ranges::upper_bound(_evictors, priority, {}, &Evictor::priority);
+    _evictors.insert(position, { .priority = priority, .callback = std::move(callback) });
+}
+
+VkDeviceSize MemoryBudget::GetAvailable(uint32_t heapIndex) const {
+    if (heapIndex >= _heaps.size()) {
+        return 0;
+    }
+    const VkDeviceSize threshold = GetThreshold(_heaps[heapIndex]);
+    return threshold > _heaps[heapIndex].usage ? threshold - _heaps[heapIndex].usage : 0;
+}
+
+uint32_t MemoryBudget::GetHeapIndex(uint32_t memoryTypeIndex) const {
+    return _memoryProperties->memoryTypes[memoryTypeIndex].heapIndex;
+}
+
+void MemoryBudget::LogStats() const {
+    spdlog::info("Memory budget: {}", _hasBudgetExtension ? "VK_EXT_memory_budget" : "estimated");
+    for (uint32_t heapIndex = 0; heapIndex < _heaps.size(); heapIndex++) {
+        const HeapBudget &heap = _heaps[heapIndex];
+        spdlog::info("  heap {}{}: {} / {} MiB used, {} MiB in {} allocations, {} MiB reserved",
+            heapIndex,
+            heap.deviceLocal ? " (device local)" : "",
+            heap.usage / (1024 * 1024),
+            heap.budget / (1024 * 1024),
+            heap.allocatedBytes / (1024 * 1024),
+            heap.allocationCount,
+            heap.reservedBytes / (1024 * 1024));
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "vk_types.h"
+
+// Usage of one memory heap as of the last MemoryBudget::Update. usage and budget come from
+// VK_EXT_memory_budget when available and include other processes, allocated and reserved only
+// count what this allocator holds.
+struct HeapBudget {
+    VkDeviceSize usage;
+    VkDeviceSize budget;
+    VkDeviceSize allocatedBytes;
+    VkDeviceSize reservedBytes;
+    uint32_t allocationCount;
+    bool deviceLocal;
+};
+
+// Asked to free memory from a heap, returns how many bytes it actually released.
+using EvictionCallback = std::function<VkDeviceSize(uint32_t heapIndex, VkDeviceSize bytesToFree)>;
+
+// Polls VMA's heap budgets once per frame and keeps usage under a fraction of the budget by
+// asking registered systems (texture streaming, caches) to evict, lowest priority first, before
+// the driver starts paging or allocations fail.
+class MemoryBudget {
+public:
+    // Evictions start above this fraction of a heap's budget and aim back below it.
+    static constexpr float EVICTION_THRESHOLD = 0.9f;
+
+    void Init(VmaAllocator allocator, bool hasBudgetExtension);
+
+    // Call once per frame, after the frame's fence wait.
+    void Update(uint32_t frameIndex);
+
+    void AddEvictionCallback(uint32_t priority, EvictionCallback &&callback);
+
+    std::span<const HeapBudget> GetHeaps() const { return _heaps; }
+
+    // Bytes that can still be allocated from heapIndex before reaching the eviction threshold.
+    VkDeviceSize GetAvailable(uint32_t heapIndex) const;
+
+    // Heap that memory of memoryTypeIndex is allocated from.
+    uint32_t GetHeapIndex(uint32_t memoryTypeIndex) const;
+
+    void LogStats() const;
+
+private:
+    struct Evictor {
+        uint32_t priority;
+        EvictionCallback callback;
+    };
+
+    VmaAllocator _allocator = nullptr;
+    bool _hasBudgetExtension = false;
+    const VkPhysicalDeviceMemoryProperties *_memoryProperties = nullptr;
+
+    std::vector<HeapBudget> _heaps;
+    std::vector<VmaBudget> _budgets;
+    std::vector<bool> _overBudget;
+    std::vector<Evictor> _evictors;
+};
@@ -0,0 +1,305 @@
+#include "vk_mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "glm/geometric.hpp"
+
+// Scoring of Forsyth's "Linear-Speed Vertex Cache Optimisation". The simulated LRU cache is larger
+// than the FIFO the result is measured with, its scores only rank candidates.
+static constexpr uint32_t SCORING_CACHE_SIZE = 32;
+static constexpr float CACHE_DECAY_POWER = 1.5f;
+static constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+static constexpr float VALENCE_BOOST_SCALE = 2.0f;
+static constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+static constexpr uint32_t NO_TRIANGLE = UINT32_MAX;
+
+static float VertexScore(int32_t cachePosition, uint32_t remainingTriangles) {
+    if (remainingTriangles == 0) {
+        return -1.f;
+    }
+
+    float score = 0.f;
+    if (cachePosition >= 0) {
+        // the vertices of the triangle just emitted score the same whatever their order
+        if (cachePosition < 3) {
+            score = LAST_TRIANGLE_SCORE;
+        } else {
+            const float scale = 1.f / (SCORING_CACHE_SIZE - 3);
+            score = std::pow(1.f - float(cachePosition - 3) * scale, CACHE_DECAY_POWER);
+        }
+    }
+
+    // vertices with few triangles left are finished first, so they don't linger as dead ends
+    return score + VALENCE_BOOST_SCALE * std::pow(float(remainingTriangles), -VALENCE_BOOST_POWER);
+}
+
+// Post transform cache as the gpu's is usually modeled, a vertex stays cached while fewer than
+// VERTEX_CACHE_SIZE other vertices missed after it.
+class FifoCache {
+public:
+    explicit FifoCache(size_t vertexCount) : _timestamps(vertexCount, 0) {}
+
+    // Misses of the three vertices.
+    uint32_t Access(const uint32_t *triangle) {
+        return Access(triangle[0]) + Access(triangle[1]) + Access(triangle[2]);
+    }
+
+    void Flush() { _time += vk::VERTEX_CACHE_SIZE + 1; }
+
+private:
+    std::vector<uint32_t> _timestamps;
+    uint32_t _time = vk::VERTEX_CACHE_SIZE + 1;
+
+    uint32_t Access(uint32_t index) {
+        if (_time - _timestamps[index] <= vk::VERTEX_CACHE_SIZE) {
+            return 0;
+        }
+        _timestamps[index] = _time++;
+        return 1;
+    }
+};
+
+float vk::AverageCacheMissRatio(std::span<const uint32_t> indices, size_t vertexCount) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return 0.f;
+    }
+
+    FifoCache cache(vertexCount);
+    uint32_t misses = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        misses += cache.Access(&indices[t * 3]);
+    }
+    return float(misses) / float(triangleCount);
+}
+
+void vk::OptimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // triangles of each vertex, the first remainingTriangles[v] entries are the ones not emitted
+    std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        remainingTriangles[indices[i]]++;
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    std::inclusive_scan(remainingTriangles.begin(), remainingTriangles.end(), adjacencyOffsets.begin() + 1);
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> filled(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++) {
+            adjacency[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<int32_t> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        vertexScores[v] = VertexScore(-1, remainingTriangles[v]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; t++) {
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] +
+                            vertexScores[indices[t * 3 + 2]];
+    }
+
+    std::vector<uint32_t> result(triangleCount * 3);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(SCORING_CACHE_SIZE + 3);
+    nextCache.reserve(SCORING_CACHE_SIZE + 3);
+
+    uint32_t bestTriangle = static_cast<uint32_t>(
+        std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+    // restart point when no cached vertex has triangles left
+    size_t inputCursor = 0;
+
+    for (size_t output = 0; output < triangleCount; output++) {
+        if (bestTriangle == NO_TRIANGLE) {
+            while (emitted[inputCursor]) {
+                inputCursor++;
+            }
+            bestTriangle = static_cast<uint32_t>(inputCursor);
+        }
+
+        const uint32_t *triangle = &indices[bestTriangle * 3];
+        std::copy(triangle, triangle + 3, &result[output * 3]);
+        emitted[bestTriangle] = true;
+
+        // emitted vertices move to the front of the cache, everything else shifts back
+        nextCache.assign(triangle, triangle + 3);
+        for (uint32_t v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                nextCache.push_back(v);
+            }
+        }
+
+        for (uint32_t i = 0; i < 3; i++) {
+            const uint32_t v = triangle[i];
+            uint32_t *begin = &adjacency[adjacencyOffsets[v]];
+            uint32_t *end = begin + remainingTriangles[v];
+            std::iter_swap(std::find(begin, end, bestTriangle), end - 1);
+            remainingTriangles[v]--;
+        }
+
+        for (size_t i = 0; i < nextCache.size(); i++) {
+            const uint32_t v = nextCache[i];
+            cachePositions[v] = i < SCORING_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+            vertexScores[v] = VertexScore(cachePositions[v], remainingTriangles[v]);
+        }
+        if (nextCache.size() > SCORING_CACHE_SIZE) {
+            nextCache.resize(SCORING_CACHE_SIZE);
+        }
+
+        // only triangles touching a vertex whose score changed can change, the best of those
+        // around the cache is next
+        bestTriangle = NO_TRIANGLE;
+        float bestScore = 0.f;
+        for (size_t i = 0; i < cache.size() + 3; i++) {
+            const uint32_t v = i < 3 ? triangle[i] : cache[i - 3];
+            for (uint32_t a = 0; a < remainingTriangles[v]; a++) {
+                const uint32_t t = adjacency[adjacencyOffsets[v] + a];
+                triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] +
+                                    vertexScores[indices[t * 3 + 2]];
+                if (cachePositions[v] >= 0 && triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+        cache.swap(nextCache);
+    }
+
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+void vk::OptimizeOverdraw(std::span<uint32_t> indices, std::span<const Vertex> vertices, float threshold) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    FifoCache cache(vertices.size());
+
+    // a triangle missing on all three vertices starts over, reordering around it costs nothing
+    std::vector<uint32_t> hardClusters = { 0 };
+    cache.Access(&indices[0]);
+    for (uint32_t t = 1; t < triangleCount; t++) {
+        if (cache.Access(&indices[t * 3]) == 3) {
+            hardClusters.push_back(t);
+        }
+    }
+    hardClusters.push_back(static_cast<uint32_t>(triangleCount));
+
+    // Long clusters are cut again wherever the miss ratio so far is within threshold of the whole
+    // cluster's. Finer clusters sort better, and since every cluster is measured from a cold
+    // cache the ratio holds in whatever order they end up.
+    std::vector<uint32_t> clusters;
+    for (size_t c = 0; c + 1 < hardClusters.size(); c++) {
+        const uint32_t begin = hardClusters[c];
+        const uint32_t end = hardClusters[c + 1];
+
+        cache.Flush();
+        uint32_t clusterMisses = 0;
+        for (uint32_t t = begin; t < end; t++) {
+            clusterMisses += cache.Access(&indices[t * 3]);
+        }
+        const float limit = threshold * float(clusterMisses) / float(end - begin);
+
+        clusters.push_back(begin);
+        cache.Flush();
+        uint32_t softBegin = begin;
+        uint32_t softMisses = 0;
+        for (uint32_t t = begin; t + 1 < end; t++) {
+            softMisses += cache.Access(&indices[t * 3]);
+            if (float(softMisses) <= limit * float(t + 1 - softBegin)) {
+                clusters.push_back(t + 1);
+                cache.Flush();
+                softBegin = t + 1;
+                softMisses = 0;
+            }
+        }
+    }
+    clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+    const size_t clusterCount = clusters.size() - 1;
+    if (clusterCount < 2) {
+        return;
+    }
+
+    // area weighted centroid and normal of each cluster, the cross product length being twice
+    // the triangle area
+    std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.f));
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.f));
+    glm::vec3 meshCentroid(0.f);
+    float meshArea = 0.f;
+    for (size_t c = 0; c < clusterCount; c++) {
+        float clusterArea = 0.f;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            const glm::vec3 &p0 = vertices[indices[t * 3]].position;
+            const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].position;
+            const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            const float area = glm::length(normal);
+
+            clusterCentroids[c] += (p0 + p1 + p2) * (area / 3.f);
+            clusterNormals[c] += normal;
+            clusterArea += area;
+        }
+
+        meshCentroid += clusterCentroids[c];
+        meshArea += clusterArea;
+        if (clusterArea > 0.f) {
+            clusterCentroids[c] /= clusterArea;
+        }
+        const float normalLength = glm::length(clusterNormals[c]);
+        if (normalLength > 0.f) {
+            clusterNormals[c] /= normalLength;
+        }
+    }
+    if (meshArea > 0.f) {
+        meshCentroid /= meshArea;
+    }
+
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) {
+        sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c]);
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    for (uint32_t c : order) {
+        result.insert(result.end(), indices.data() + clusters[c] * 3, indices.data() + clusters[c + 1] * 3);
+    }
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+size_t vk::OptimizeVertexFetch(std::span<uint32_t> indices, std::vector<Vertex> &vertices) {
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<Vertex> fetchOrdered;
+    fetchOrdered.reserve(vertices.size());
+
+    for (uint32_t &index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = static_cast<uint32_t>(fetchOrdered.size());
+            fetchOrdered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(fetchOrdered);
+    return vertices.size();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "vk_types.h"
+
+// Import time reordering of triangle lists so the gpu transforms fewer vertices and reads them
+// with better locality. Run in the order declared: vertex cache, then overdraw on the result,
+// then vertex fetch, which renumbers vertices and has to come last.
+namespace vk {
+
+// Post transform cache size the orderings are tuned for and measured against.
+constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+// Vertex shader invocations per triangle with a FIFO post transform cache, between 0.5 and 3.
+float AverageCacheMissRatio(std::span<const uint32_t> indices, size_t vertexCount);
+
+// Reorders triangles with Forsyth's linear speed vertex cache optimization: triangles whose
+// vertices are in the simulated cache, or have few triangles left, are emitted first.
+void OptimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount);
+
+// Splits a cache optimized list into clusters where the ordering restarts, then sorts the
+// clusters so outward facing ones come first and occlude the rest (Sander, Nehab and Barczak,
+// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"). threshold is how much the
+// cache miss ratio may grow for smaller, better sortable clusters.
+void OptimizeOverdraw(std::span<uint32_t> indices, std::span<const Vertex> vertices, float threshold = 1.05f);
+
+// Renumbers vertices in the order indices first reference them and drops unreferenced ones, so
+// vertex fetches walk the buffer forward. Returns the new vertex count.
+size_t OptimizeVertexFetch(std::span<uint32_t> indices, std::vector<Vertex> &vertices);
+
+};
@@ -0,0 +1,281 @@
+#include "vk_mipmaps.h"
+
+#include <algorithm>
+
+#include "vk_images.h"
+#include "vk_initializers.h"
+
+static VkImageMemoryBarrier2 LevelBarrier(VkImage image, uint32_t baseMipLevel, uint32_t levelCount) {
+    VkImageMemoryBarrier2 barrier = { .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = vk::ImageSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
+    barrier.subresourceRange.baseMipLevel = baseMipLevel;
+    barrier.subresourceRange.levelCount = levelCount;
+    return barrier;
+}
+
+static void PipelineBarrier(VkCommandBuffer cmd, std::span<const VkImageMemoryBarrier2> barriers) {
+    VkDependencyInfo depInfo = {};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size());
+    depInfo.pImageMemoryBarriers = barriers.data();
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+}
+
+// Formats the downsample shader can average and store through RWTexture2D<float4>. Integer formats
+// would need a typed RWTexture2D<uint4>, sRGB formats cannot be storage images.
+static bool IsFloatStorageFormat(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SNORM:
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R8G8_SNORM:
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SNORM:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+    case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+    case VK_FORMAT_R16_UNORM:
+    case VK_FORMAT_R16_SNORM:
+    case VK_FORMAT_R16_SFLOAT:
+    case VK_FORMAT_R16G16_UNORM:
+    case VK_FORMAT_R16G16_SNORM:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R16G16B16A16_UNORM:
+    case VK_FORMAT_R16G16B16A16_SNORM:
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_R32G32_SFLOAT:
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+MipGenerationMethod MipGenerator::GetMethod(VkPhysicalDevice physicalDevice, VkFormat format) {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+    const VkFormatFeatureFlags features = formatProperties.optimalTilingFeatures;
+
+    constexpr VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                                  VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if ((features & blitFeatures) == blitFeatures) {
+        return MipGenerationMethod::Blit;
+    }
+
+    if (!IsFloatStorageFormat(format)) {
+        return MipGenerationMethod::None;
+    }
+
+    // the output levels have no declared format, InitVulkan enables the feature whenever it is supported
+    VkPhysicalDeviceFeatures deviceFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &deviceFeatures);
+    if (!deviceFeatures.shaderStorageImageWriteWithoutFormat) {
+        return MipGenerationMethod::None;
+    }
+
+    // the shader loads texels and averages them itself, so linear filtering is not needed
+    constexpr VkFormatFeatureFlags computeFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                                     VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT;
+    if ((features & computeFeatures) == computeFeatures) {
+        return MipGenerationMethod::Compute;
+    }
+    return MipGenerationMethod::None;
+}
+
+VkImageUsageFlags MipGenerator::GetRequiredUsage(MipGenerationMethod method) {
+    switch (method) {
+        case MipGenerationMethod::Blit:
+            return VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        case MipGenerationMethod::Compute:
+            return VK_IMAGE_USAGE_STORAGE_BIT;
+        default:
+            return 0;
+    }
+}
+
+void MipGenerator::Init(VkDevice device,
+    VkPhysicalDevice physicalDevice,
+    PipelineManager &pipelineManager,
+    uint32_t framesInFlight) {
+    _device = device;
+    _physicalDevice = physicalDevice;
+    _pipelineManager = &pipelineManager;
+
+    DescriptorLayoutBuilder layoutBuilder;
+    layoutBuilder.AddBinding(0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE)
+                 .AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, LEVELS_PER_DISPATCH);
+    _setLayout = layoutBuilder.Build(_device, VK_SHADER_STAGE_COMPUTE_BIT);
+
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PushConstants);
+
+    VkPipelineLayoutCreateInfo layoutInfo = vk::PipelineLayoutCreateInfo();
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &_setLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushConstantRange;
+    VK_CHECK(vkCreatePipelineLayout(_device, &layoutInfo, nullptr, &_pipelineLayout));
+
+    _pipeline = _pipelineManager->CreateComputePipeline("downsample", "computeMain", _pipelineLayout);
+
+    const DescriptorAllocatorGrowable::PoolSizeRatio ratios[] = {
+        { .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, .ratio = 1 },
+        { .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .ratio = LEVELS_PER_DISPATCH },
+    };
+    _frames.resize(framesInFlight);
+    for (FrameResources &frame : _frames) {
+        frame.descriptors.Init(_device, 16, ratios);
+    }
+}
+
+void MipGenerator::Cleanup() {
+    for (FrameResources &frame : _frames) {
+        for (VkImageView view : frame.views) {
+            vkDestroyImageView(_device, view, nullptr);
+        }
+        frame.descriptors.DestroyPools(_device);
+    }
+    _frames.clear();
+
+    vkDestroyPipelineLayout(_device, _pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(_device, _setLayout, nullptr);
+}
+
+void MipGenerator::BeginFrame(uint32_t frameIndex) {
+    _frameIndex = frameIndex;
+
+    FrameResources &frame = _frames[_frameIndex];
+    for (VkImageView view : frame.views) {
+        vkDestroyImageView(_device, view, nullptr);
+    }
+    frame.views.clear();
+    frame.descriptors.ClearPools(_device);
+}
+
+bool MipGenerator::IsReady(VkFormat format) const {
+    if (GetMethod(_physicalDevice, format) != MipGenerationMethod::Compute) {
+        return true;
+    }
+    return _pipelineManager->GetStatus(_pipeline) != PipelineStatus::Pending;
+}
+
+void MipGenerator::Generate(VkCommandBuffer cmd, const AllocatedImage &image, VkImageLayout level0Layout) {
+    const uint32_t mipLevels = image.mipLevels;
+    const MipGenerationMethod method = GetMethod(_physicalDevice, image.imageFormat);
+    if (method == MipGenerationMethod::Blit) {
+        vk::GenerateMipmaps(cmd,
+            image.image,
+            { image.imageExtent.width, image.imageExtent.height },
+            mipLevels,
+            level0Layout);
+        return;
+    }
+    if (method == MipGenerationMethod::Compute && _pipelineManager->Get(_pipeline) != VK_NULL_HANDLE) {
+        GenerateCompute(cmd, image, level0Layout);
+        return;
+    }
+
+    spdlog::error("Cannot generate mips for {}, only the base level is valid", string_VkFormat(image.imageFormat));
+    VkImageMemoryBarrier2 barrier = LevelBarrier(image.image, 0, mipLevels);
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+    barrier.oldLayout = level0Layout;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    PipelineBarrier(cmd, std::span(&barrier, 1));
+}
+
+void MipGenerator::GenerateCompute(VkCommandBuffer cmd, const AllocatedImage &image, VkImageLayout level0Layout) {
+    FrameResources &frame = _frames[_frameIndex];
+    const uint32_t mipLevels = image.mipLevels;
+
+    // each dispatch reads its source level and writes the levels below it
+    VkImageMemoryBarrier2 barriers[2];
+    barriers[0] = LevelBarrier(image.image, 0, 1);
+    barriers[0].srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    barriers[0].srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+    barriers[0].dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+    barriers[0].oldLayout = level0Layout;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1] = LevelBarrier(image.image, 1, mipLevels - 1);
+    barriers[1].srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+    barriers[1].srcAccessMask = VK_ACCESS_2_NONE;
+    barriers[1].dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    PipelineBarrier(cmd, std::span(barriers, mipLevels > 1 ? 2 : 1));
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineManager->Get(_pipeline));
+
+    for (uint32_t sourceLevel = 0; sourceLevel + 1 < mipLevels; sourceLevel += LEVELS_PER_DISPATCH) {
+        const uint32_t levelCount = std::min(LEVELS_PER_DISPATCH, mipLevels - 1 - sourceLevel);
+
+        const VkDescriptorSet set = frame.descriptors.Allocate(_device, _setLayout);
+        DescriptorWriter writer;
+        writer.WriteImage(set,
+            0,
+            CreateLevelView(image, sourceLevel),
+            VK_NULL_HANDLE,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE);
+        // every array element needs a valid view, the ones past levelCount repeat the last level and
+        // are never written
+        VkImageView outputView = VK_NULL_HANDLE;
+        for (uint32_t i = 0; i < LEVELS_PER_DISPATCH; i++) {
+            if (i < levelCount) {
+                outputView = CreateLevelView(image, sourceLevel + 1 + i);
+            }
+            writer.WriteImage(set,
+                1,
+                outputView,
+                VK_NULL_HANDLE,
+                VK_IMAGE_LAYOUT_GENERAL,
+                VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                i);
+        }
+        writer.Flush(_device);
+
+        PushConstants pushConstants = {};
+        pushConstants.outputSize[0] = std::max(1u, image.imageExtent.width >> (sourceLevel + 1));
+        pushConstants.outputSize[1] = std::max(1u, image.imageExtent.height >> (sourceLevel + 1));
+        pushConstants.levelCount = levelCount;
+
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &set, 0, nullptr);
+        vkCmdPushConstants(cmd,
+            _pipelineLayout,
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            0,
+            sizeof(PushConstants),
+            &pushConstants);
+        vkCmdDispatch(cmd, (pushConstants.outputSize[0] + 7) / 8, (pushConstants.outputSize[1] + 7) / 8, 1);
+
+        // the last level written is the source of the next dispatch
+        barriers[0] = LevelBarrier(image.image, sourceLevel + 1, levelCount);
+        barriers[0].srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        barriers[0].srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+        barriers[0].dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        barriers[0].dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        PipelineBarrier(cmd, std::span(barriers, 1));
+    }
+}
+
+VkImageView MipGenerator::CreateLevelView(const AllocatedImage &image, uint32_t mipLevel) {
+    VkImageViewCreateInfo viewInfo = vk::ImageviewCreateInfo(image.imageFormat, image.image, VK_IMAGE_ASPECT_COLOR_BIT);
+    viewInfo.subresourceRange.baseMipLevel = mipLevel;
+
+    VkImageView view;
+    VK_CHECK(vkCreateImageView(_device, &viewInfo, nullptr, &view));
+    _frames[_frameIndex].views.push_back(view);
+    return view;
+}
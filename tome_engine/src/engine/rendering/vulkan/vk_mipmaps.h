@@ -0,0 +1,71 @@
+#pragma once
+
+#include "vk_descriptors.h"
+#include "vk_pipeline_manager.h"
+#include "vk_types.h"
+
+enum class MipGenerationMethod : uint8_t {
+    // block compressed, integer and other formats that can neither be blitted nor stored to
+    None,
+    Blit,
+    Compute,
+};
+
+// Fills the mip chain of an image from its base level on the gpu, for textures loaded without
+// precomputed mips and for images rendered at runtime. Formats that support linear blits use
+// the vkCmdBlitImage2 chain from vk::GenerateMipmaps. Float and normalized formats without blit
+// support fall back to the downsample compute shader, which writes four levels per dispatch from
+// one read of the level above. It needs shaderStorageImageWriteWithoutFormat.
+//
+// The compute path needs one view per level and a descriptor set per dispatch. Both belong to
+// the frame that recorded them and are released by BeginFrame once that frame has retired.
+class MipGenerator {
+public:
+    static MipGenerationMethod GetMethod(VkPhysicalDevice physicalDevice, VkFormat format);
+
+    // Usage an image needs besides SAMPLED for mips to be generated with method.
+    static VkImageUsageFlags GetRequiredUsage(MipGenerationMethod method);
+
+    void Init(VkDevice device,
+        VkPhysicalDevice physicalDevice,
+        PipelineManager &pipelineManager,
+        uint32_t framesInFlight);
+    void Cleanup();
+
+    // After the wait on the fence of frameIndex.
+    void BeginFrame(uint32_t frameIndex);
+
+    // False while the compute pipeline a format needs is still compiling.
+    bool IsReady(VkFormat format) const;
+
+    // Level 0 of image is in level0Layout, afterwards all its levels are in SHADER_READ_ONLY_OPTIMAL.
+    void Generate(VkCommandBuffer cmd, const AllocatedImage &image, VkImageLayout level0Layout);
+
+private:
+    struct FrameResources {
+        DescriptorAllocatorGrowable descriptors;
+        std::vector<VkImageView> views;
+    };
+
+    // outputSize is the extent of the first level written by the dispatch
+    struct PushConstants {
+        uint32_t outputSize[2];
+        uint32_t levelCount;
+    };
+
+    static constexpr uint32_t LEVELS_PER_DISPATCH = 4;
+
+    VkDevice _device = VK_NULL_HANDLE;
+    VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+    PipelineManager *_pipelineManager = nullptr;
+
+    VkDescriptorSetLayout _setLayout = VK_NULL_HANDLE;
+    VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
+    PipelineHandle _pipeline = INVALID_PIPELINE_HANDLE;
+
+    std::vector<FrameResources> _frames;
+    uint32_t _frameIndex = 0;
+
+    void GenerateCompute(VkCommandBuffer cmd, const AllocatedImage &image, VkImageLayout level0Layout);
+    VkImageView CreateLevelView(const AllocatedImage &image, uint32_t mipLevel);
+};
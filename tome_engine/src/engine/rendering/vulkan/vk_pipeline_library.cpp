@@ -0,0 +1,371 @@
+#include "vk_pipeline_library.h"
+
+#include <bit>
+
+template<typename T>
+void GraphicsPipelineLibrary::LibraryKey::Add(const T &value) {
+    if constexpr (std::is_pointer_v<T>) {
+        state.push_back(reinterpret_cast<uintptr_t>(value));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        state.push_back(std::bit_cast<uint32_t>(value));
+    } else {
+        state.push_back(static_cast<uint64_t>(value));
+    }
+}
+
+GraphicsPipelineLibrary::LibraryKey GraphicsPipelineLibrary::LibraryKey::FromDynamicStates(
+    const PipelineBuilder &builder) {
+    // prefixed with their count so the states can't run into the fixed state added after them
+    LibraryKey key;
+    key.Add(builder.dynamicStates.size());
+    for (VkDynamicState state : builder.dynamicStates) {
+        key.Add(state);
+    }
+    return key;
+}
+
+size_t GraphicsPipelineLibrary::LibraryKeyHash::operator()(const LibraryKey &key) const {
+    size_t seed = std::hash<std::string_view>{}(
+        { reinterpret_cast<const char *>(key.spirv.data()), key.spirv.size() * sizeof(uint32_t) });
+    for (uint64_t value : key.state) {
+        vk::HashCombine(seed, value);
+    }
+    return seed;
+}
+
+static VkPipelineShaderStageCreateInfo LibraryShaderStage(const ShaderCode &code,
+    VkShaderModuleCreateInfo &moduleCreateInfo) {
+    moduleCreateInfo = {};
+    moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleCreateInfo.codeSize = code.spirv.size_bytes();
+    moduleCreateInfo.pCode = code.spirv.data();
+
+    // with graphicsPipelineLibrary enabled the code can be chained in directly, no VkShaderModule needed
+    VkPipelineShaderStageCreateInfo stageInfo = {};
+    stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stageInfo.pNext = &moduleCreateInfo;
+    stageInfo.stage = code.stage;
+    stageInfo.module = VK_NULL_HANDLE;
+    stageInfo.pName = "main";
+    return stageInfo;
+}
+
+void GraphicsPipelineLibrary::Init(VkDevice device, bool supported) {
+    _device = device;
+    _supported = supported;
+}
+
+void GraphicsPipelineLibrary::Cleanup() {
+    for (LinkedPipeline &linked : _pipelines) {
+        if (linked.optimizedPipeline.valid()) {
+            vkDestroyPipeline(_device, linked.optimizedPipeline.get(), nullptr);
+        }
+        vkDestroyPipeline(_device, linked.pipeline, nullptr);
+    }
+    _pipelines.clear();
+
+    for (auto *libraries : { &_vertexInputLibraries,
+                             &_preRasterizationLibraries,
+                             &_fragmentShaderLibraries,
+                             &_fragmentOutputLibraries }) {
+        for (auto &[key, library] : *libraries) {
+            vkDestroyPipeline(_device, library, nullptr);
+        }
+        libraries->clear();
+    }
+}
+
+LinkedPipelineId GraphicsPipelineLibrary::Link(const PipelineBuilder &builder, const ShaderProgram &program) {
+    if (!_supported) {
+        return AddPipeline(BuildMonolithic(builder, program));
+    }
+
+    const ShaderCode *vertexCode = program.FindStage(VK_SHADER_STAGE_VERTEX_BIT);
+    const ShaderCode *fragmentCode = program.FindStage(VK_SHADER_STAGE_FRAGMENT_BIT);
+    if (!vertexCode || !fragmentCode) {
+        spdlog::error("graphics pipelines need a vertex and a fragment stage");
+        return AddPipeline(VK_NULL_HANDLE);
+    }
+
+    std::array<VkPipeline, 4> libraries;
+    {
+        std::lock_guard lock(_librariesMutex);
+        libraries = {
+            GetVertexInputLibrary(builder),
+            GetPreRasterizationLibrary(builder, *vertexCode),
+            GetFragmentShaderLibrary(builder, *fragmentCode),
+            GetFragmentOutputLibrary(builder),
+        };
+    }
+    for (VkPipeline library : libraries) {
+        if (library == VK_NULL_HANDLE) {
+            return AddPipeline(VK_NULL_HANDLE);
+        }
+    }
+
+    VkPipeline pipeline = LinkLibraries(libraries, builder.pipelineLayout, false);
+    return AddPipeline(pipeline,
+        std::async(std::launch::async,
+            [this, libraries, layout = builder.pipelineLayout]() {
+                return LinkLibraries(libraries, layout, true);
+            }));
+}
+
+VkPipeline GraphicsPipelineLibrary::GetPipeline(LinkedPipelineId id) const {
+    std::lock_guard lock(_pipelinesMutex);
+    return id < _pipelines.size() ? _pipelines[id].pipeline : VK_NULL_HANDLE;
+}
+
+LinkedPipelineId GraphicsPipelineLibrary::AddPipeline(VkPipeline pipeline, std::future<VkPipeline> optimizedPipeline) {
+    std::lock_guard lock(_pipelinesMutex);
+    const auto id = static_cast<LinkedPipelineId>(_pipelines.size());
+    _pipelines.push_back({ .pipeline = pipeline, .optimizedPipeline = std::move(optimizedPipeline) });
+    return id;
+}
+
+void GraphicsPipelineLibrary::Update(DeletionQueue &retireQueue) {
+    std::lock_guard lock(_pipelinesMutex);
+    for (LinkedPipeline &linked : _pipelines) {
+        if (!linked.optimizedPipeline.valid() ||
+            linked.optimizedPipeline.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            continue;
+        }
+
+        VkPipeline optimizedPipeline = linked.optimizedPipeline.get();
+        if (optimizedPipeline == VK_NULL_HANDLE) {
+            // keep using the fast-linked one
+            continue;
+        }
+
+        VkPipeline fastLinkedPipeline = linked.pipeline;
+        linked.pipeline = optimizedPipeline;
+
+        retireQueue.PushFunction([device = _device, fastLinkedPipeline]() {
+            vkDestroyPipeline(device, fastLinkedPipeline, nullptr);
+        });
+    }
+}
+
+VkPipeline GraphicsPipelineLibrary::GetVertexInputLibrary(const PipelineBuilder &builder) {
+    LibraryKey key = LibraryKey::FromDynamicStates(builder);
+    key.Add(builder.inputAssembly.topology);
+    key.Add(builder.inputAssembly.primitiveRestartEnable);
+
+    if (auto it = _vertexInputLibraries.find(key); it != _vertexInputLibraries.end()) {
+        return it->second;
+    }
+
+    // vertices are pulled from buffers in the shaders, so every pipeline shares the empty input state
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &builder.inputAssembly;
+
+    VkPipeline library = CreateLibrary(VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+        builder,
+        pipelineInfo);
+    if (library != VK_NULL_HANDLE) {
+        _vertexInputLibraries.emplace(std::move(key), library);
+    }
+    return library;
+}
+
+VkPipeline GraphicsPipelineLibrary::GetPreRasterizationLibrary(const PipelineBuilder &builder,
+    const ShaderCode &vertexCode) {
+    LibraryKey key = LibraryKey::FromDynamicStates(builder);
+    key.spirv.assign(vertexCode.spirv.begin(), vertexCode.spirv.end());
+    key.Add(builder.pipelineLayout);
+    key.Add(builder.rasterizer.polygonMode);
+    key.Add(builder.rasterizer.cullMode);
+    key.Add(builder.rasterizer.frontFace);
+    key.Add(builder.rasterizer.depthBiasEnable);
+    key.Add(builder.rasterizer.rasterizerDiscardEnable);
+    key.Add(builder.rasterizer.lineWidth);
+    key.Add(builder.renderInfo.viewMask);
+
+    if (auto it = _preRasterizationLibraries.find(key); it != _preRasterizationLibraries.end()) {
+        return it->second;
+    }
+
+    VkShaderModuleCreateInfo moduleCreateInfo;
+    const VkPipelineShaderStageCreateInfo stageInfo = LibraryShaderStage(vertexCode, moduleCreateInfo);
+
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.stageCount = 1;
+    pipelineInfo.pStages = &stageInfo;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &builder.rasterizer;
+    pipelineInfo.layout = builder.pipelineLayout;
+
+    VkPipeline library = CreateLibrary(VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+        builder,
+        pipelineInfo);
+    if (library != VK_NULL_HANDLE) {
+        _preRasterizationLibraries.emplace(std::move(key), library);
+    }
+    return library;
+}
+
+VkPipeline GraphicsPipelineLibrary::GetFragmentShaderLibrary(const PipelineBuilder &builder,
+    const ShaderCode &fragmentCode) {
+    LibraryKey key = LibraryKey::FromDynamicStates(builder);
+    key.spirv.assign(fragmentCode.spirv.begin(), fragmentCode.spirv.end());
+    key.Add(builder.pipelineLayout);
+    key.Add(builder.depthStencil.depthTestEnable);
+    key.Add(builder.depthStencil.depthWriteEnable);
+    key.Add(builder.depthStencil.depthCompareOp);
+    key.Add(builder.depthStencil.stencilTestEnable);
+    key.Add(builder.multisampling.rasterizationSamples);
+    key.Add(builder.multisampling.sampleShadingEnable);
+    key.Add(builder.renderInfo.viewMask);
+
+    if (auto it = _fragmentShaderLibraries.find(key); it != _fragmentShaderLibraries.end()) {
+        return it->second;
+    }
+
+    VkShaderModuleCreateInfo moduleCreateInfo;
+    const VkPipelineShaderStageCreateInfo stageInfo = LibraryShaderStage(fragmentCode, moduleCreateInfo);
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.stageCount = 1;
+    pipelineInfo.pStages = &stageInfo;
+    pipelineInfo.pDepthStencilState = &builder.depthStencil;
+    pipelineInfo.pMultisampleState = &builder.multisampling;
+    pipelineInfo.layout = builder.pipelineLayout;
+
+    VkPipeline library = CreateLibrary(VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+        builder,
+        pipelineInfo);
+    if (library != VK_NULL_HANDLE) {
+        _fragmentShaderLibraries.emplace(std::move(key), library);
+    }
+    return library;
+}
+
+VkPipeline GraphicsPipelineLibrary::GetFragmentOutputLibrary(const PipelineBuilder &builder) {
+    const VkPipelineColorBlendAttachmentState &blend = builder.colorBlendAttachment;
+
+    LibraryKey key = LibraryKey::FromDynamicStates(builder);
+    key.Add(builder.colorAttachmentFormat);
+    key.Add(builder.renderInfo.depthAttachmentFormat);
+    key.Add(builder.renderInfo.stencilAttachmentFormat);
+    key.Add(builder.renderInfo.viewMask);
+    key.Add(blend.blendEnable);
+    key.Add(blend.srcColorBlendFactor);
+    key.Add(blend.dstColorBlendFactor);
+    key.Add(blend.colorBlendOp);
+    key.Add(blend.srcAlphaBlendFactor);
+    key.Add(blend.dstAlphaBlendFactor);
+    key.Add(blend.alphaBlendOp);
+    key.Add(blend.colorWriteMask);
+    key.Add(builder.multisampling.rasterizationSamples);
+    key.Add(builder.multisampling.alphaToCoverageEnable);
+
+    if (auto it = _fragmentOutputLibraries.find(key); it != _fragmentOutputLibraries.end()) {
+        return it->second;
+    }
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.logicOp = VK_LOGIC_OP_COPY;
+    colorBlending.attachmentCount = builder.renderInfo.colorAttachmentCount;
+    colorBlending.pAttachments = &builder.colorBlendAttachment;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pMultisampleState = &builder.multisampling;
+
+    VkPipeline library = CreateLibrary(VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT,
+        builder,
+        pipelineInfo);
+    if (library != VK_NULL_HANDLE) {
+        _fragmentOutputLibraries.emplace(std::move(key), library);
+    }
+    return library;
+}
+
+VkPipeline GraphicsPipelineLibrary::CreateLibrary(VkGraphicsPipelineLibraryFlagsEXT parts,
+    const PipelineBuilder &builder,
+    VkGraphicsPipelineCreateInfo &pipelineInfo) const {
+    VkPipelineRenderingCreateInfo renderInfo = builder.renderInfo;
+    renderInfo.pNext = nullptr;
+    renderInfo.pColorAttachmentFormats = renderInfo.colorAttachmentCount > 0 ? &builder.colorAttachmentFormat : nullptr;
+
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo = {};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+    libraryInfo.pNext = &renderInfo;
+    libraryInfo.flags = parts;
+
+    VkPipelineDynamicStateCreateInfo dynamicInfo = {};
+    dynamicInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicInfo.pDynamicStates = builder.dynamicStates.data();
+    dynamicInfo.dynamicStateCount = static_cast<uint32_t>(builder.dynamicStates.size());
+
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = &libraryInfo;
+    // keep what the optimized link needs to run link time optimization later
+    pipelineInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+    pipelineInfo.pDynamicState = &dynamicInfo;
+
+    VkPipeline library;
+    if (vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &library) != VK_SUCCESS) {
+        spdlog::error("failed to create graphics pipeline library");
+        return VK_NULL_HANDLE;
+    }
+    return library;
+}
+
+VkPipeline GraphicsPipelineLibrary::LinkLibraries(std::span<const VkPipeline> libraries,
+    VkPipelineLayout layout,
+    bool optimize) const {
+    VkPipelineLibraryCreateInfoKHR linkingInfo = {};
+    linkingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    linkingInfo.libraryCount = static_cast<uint32_t>(libraries.size());
+    linkingInfo.pLibraries = libraries.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = &linkingInfo;
+    pipelineInfo.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+    pipelineInfo.layout = layout;
+
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        spdlog::error("failed to link graphics pipeline libraries");
+        return VK_NULL_HANDLE;
+    }
+    return pipeline;
+}
+
+VkPipeline GraphicsPipelineLibrary::BuildMonolithic(const PipelineBuilder &builder, const ShaderProgram &program) const {
+    const ShaderCode *vertexCode = program.FindStage(VK_SHADER_STAGE_VERTEX_BIT);
+    const ShaderCode *fragmentCode = program.FindStage(VK_SHADER_STAGE_FRAGMENT_BIT);
+    if (!vertexCode || !fragmentCode) {
+        spdlog::error("graphics pipelines need a vertex and a fragment stage");
+        return VK_NULL_HANDLE;
+    }
+
+    auto vertexShader = vk::CreateShaderModule(_device, *vertexCode);
+    auto fragmentShader = vk::CreateShaderModule(_device, *fragmentCode);
+
+    if (!vertexShader.has_value() || !fragmentShader.has_value()) {
+        if (vertexShader.has_value()) vkDestroyShaderModule(_device, vertexShader.value(), nullptr);
+        if (fragmentShader.has_value()) vkDestroyShaderModule(_device, fragmentShader.value(), nullptr);
+        return VK_NULL_HANDLE;
+    }
+
+    PipelineBuilder monolithicBuilder = builder;
+    monolithicBuilder.SetShaders(vertexShader.value(), fragmentShader.value());
+    VkPipeline pipeline = monolithicBuilder.Build(_device);
+
+    vkDestroyShaderModule(_device, vertexShader.value(), nullptr);
+    vkDestroyShaderModule(_device, fragmentShader.value(), nullptr);
+
+    return pipeline;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+#include "vk_pipelines.h"
+
+using LinkedPipelineId = uint32_t;
+
+constexpr LinkedPipelineId INVALID_LINKED_PIPELINE = ~0u;
+
+// VK_EXT_graphics_pipeline_library support. The four parts of a graphics pipeline (vertex input,
+// pre-rasterization, fragment shader and fragment output) are compiled once as libraries and shared
+// by every pipeline that uses the same part. New pipelines are fast-linked from the libraries so
+// they are usable right away, while an optimized link runs in the background and replaces the
+// fast-linked pipeline once it finishes.
+// Without the extension Link falls back to building a monolithic pipeline.
+// Link may be called from worker threads while the render thread reads pipelines.
+class GraphicsPipelineLibrary {
+public:
+    void Init(VkDevice device, bool supported);
+    void Cleanup();
+
+    // Shader stages of builder are ignored, they come from program instead.
+    LinkedPipelineId Link(const PipelineBuilder &builder, const ShaderProgram &program);
+
+    VkPipeline GetPipeline(LinkedPipelineId id) const;
+
+    // Swaps in optimized pipelines that finished linking. The fast-linked pipelines they replace
+    // may still be in flight, so they are released through retireQueue.
+    void Update(DeletionQueue &retireQueue);
+
+private:
+    // Everything a library was created from, the shader's whole SPIR-V included. The maps compare
+    // keys in full, so a hash collision can't hand out a library built from other state.
+    struct LibraryKey {
+        std::vector<uint64_t> state;
+        std::vector<uint32_t> spirv;
+
+        // Starts a key with the builder's dynamic states, which every library part depends on.
+        static LibraryKey FromDynamicStates(const PipelineBuilder &builder);
+
+        bool operator==(const LibraryKey &other) const = default;
+
+        template<typename T>
+        void Add(const T &value);
+    };
+
+    struct LibraryKeyHash {
+        size_t operator()(const LibraryKey &key) const;
+    };
+
+    using LibraryMap = std::unordered_map<LibraryKey, VkPipeline, LibraryKeyHash>;
+
+    struct LinkedPipeline {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        std::future<VkPipeline> optimizedPipeline;
+    };
+
+    VkDevice _device = VK_NULL_HANDLE;
+    bool _supported = false;
+
+    // _pipelinesMutex is only held for short lookups so the render thread never waits on a
+    // worker that is compiling libraries under _librariesMutex
+    mutable std::mutex _pipelinesMutex;
+    std::mutex _librariesMutex;
+
+    std::vector<LinkedPipeline> _pipelines;
+
+    LibraryMap _vertexInputLibraries;
+    LibraryMap _preRasterizationLibraries;
+    LibraryMap _fragmentShaderLibraries;
+    LibraryMap _fragmentOutputLibraries;
+
+    LinkedPipelineId AddPipeline(VkPipeline pipeline, std::future<VkPipeline> optimizedPipeline = {});
+
+    VkPipeline GetVertexInputLibrary(const PipelineBuilder &builder);
+    VkPipeline GetPreRasterizationLibrary(const PipelineBuilder &builder, const ShaderCode &vertexCode);
+    VkPipeline GetFragmentShaderLibrary(const PipelineBuilder &builder, const ShaderCode &fragmentCode);
+    VkPipeline GetFragmentOutputLibrary(const PipelineBuilder &builder);
+
+    VkPipeline CreateLibrary(VkGraphicsPipelineLibraryFlagsEXT parts,
+        const PipelineBuilder &builder,
+        VkGraphicsPipelineCreateInfo &pipelineInfo) const;
+    VkPipeline LinkLibraries(std::span<const VkPipeline> libraries, VkPipelineLayout layout, bool optimize) const;
+    VkPipeline BuildMonolithic(const PipelineBuilder &builder, const ShaderProgram &program) const;
+};
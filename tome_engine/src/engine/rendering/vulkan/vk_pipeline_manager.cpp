@@ -0,0 +1,128 @@
+#include "vk_pipeline_manager.h"
+
+#include <cassert>
+
+void PipelineManager::Init(VkDevice device,
+    ThreadPool &threadPool,
+    GraphicsPipelineLibrary &pipelineLibrary,
+    ShaderProgramLoader &&shaderLoader) {
+    _device = device;
+    _threadPool = &threadPool;
+    _pipelineLibrary = &pipelineLibrary;
+    _shaderLoader = std::move(shaderLoader);
+}
+
+void PipelineManager::Cleanup() {
+    while (uint32_t pendingCount = _pendingCount.load()) {
+        _pendingCount.wait(pendingCount);
+    }
+
+    for (PipelineEntry &entry : _entries) {
+        if (entry.pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(_device, entry.pipeline, nullptr);
+        }
+    }
+    _entries.clear();
+}
+
+PipelineHandle PipelineManager::CreateComputePipeline(const char *moduleName,
+    const char *entryPoint,
+    VkPipelineLayout layout,
+    VkPipelineCreateFlags flags,
+    PipelineHandle fallback) {
+    const PipelineHandle handle = AddEntry(fallback);
+    PipelineEntry *entry = &_entries[handle.Index()];
+
+    Submit([this,
+            entry,
+            moduleName = std::string(moduleName),
+            entryPoint = std::string(entryPoint),
+            layout,
+            flags]() {
+        const char *entryPoints[] = { entryPoint.c_str() };
+        auto program = _shaderLoader(moduleName.c_str(), entryPoints);
+        if (!program.has_value()) {
+            spdlog::error("compute pipeline {}:{} failed to compile", moduleName, entryPoint);
+            entry->status.store(PipelineStatus::Failed, std::memory_order_release);
+            return;
+        }
+
+        entry->pipeline = vk::CreateComputePipeline(_device, program->stages[0], layout, flags);
+        entry->status.store(entry->pipeline != VK_NULL_HANDLE ? PipelineStatus::Ready : PipelineStatus::Failed,
+            std::memory_order_release);
+    });
+
+    return handle;
+}
+
+PipelineHandle PipelineManager::CreateGraphicsPipeline(const char *moduleName,
+    const char *vertexEntryPoint,
+    const char *fragmentEntryPoint,
+    const PipelineBuilder &builder,
+    PipelineHandle fallback) {
+    const PipelineHandle handle = AddEntry(fallback);
+    PipelineEntry *entry = &_entries[handle.Index()];
+
+    Submit([this,
+            entry,
+            moduleName = std::string(moduleName),
+            vertexEntryPoint = std::string(vertexEntryPoint),
+            fragmentEntryPoint = std::string(fragmentEntryPoint),
+            builder]() {
+        const char *entryPoints[] = { vertexEntryPoint.c_str(), fragmentEntryPoint.c_str() };
+        auto program = _shaderLoader(moduleName.c_str(), entryPoints);
+        if (!program.has_value()) {
+            spdlog::error("graphics pipeline {} failed to compile", moduleName);
+            entry->status.store(PipelineStatus::Failed, std::memory_order_release);
+            return;
+        }
+
+        entry->linkedPipeline = _pipelineLibrary->Link(builder, program.value());
+        const bool linked = _pipelineLibrary->GetPipeline(entry->linkedPipeline) != VK_NULL_HANDLE;
+        entry->status.store(linked ? PipelineStatus::Ready : PipelineStatus::Failed, std::memory_order_release);
+    });
+
+    return handle;
+}
+
+PipelineStatus PipelineManager::GetStatus(PipelineHandle handle) const {
+    const PipelineEntry *entry = FindEntry(handle);
+    return entry ? entry->status.load(std::memory_order_acquire) : PipelineStatus::Failed;
+}
+
+VkPipeline PipelineManager::Get(PipelineHandle handle) const {
+    // fallbacks are always created before the handles using them, so this cannot cycle
+    while (const PipelineEntry *entry = FindEntry(handle)) {
+        if (entry->status.load(std::memory_order_acquire) == PipelineStatus::Ready) {
+            return entry->linkedPipeline != INVALID_LINKED_PIPELINE
+                       ? _pipelineLibrary->GetPipeline(entry->linkedPipeline)
+                       : entry->pipeline;
+        }
+        handle = entry->fallback;
+    }
+    return VK_NULL_HANDLE;
+}
+
+PipelineHandle PipelineManager::AddEntry(PipelineHandle fallback) {
+    assert(fallback == INVALID_PIPELINE_HANDLE || FindEntry(fallback));
+
+    const PipelineHandle handle(static_cast<uint32_t>(_entries.size()), 1);
+    _entries.emplace_back().fallback = fallback;
+    return handle;
+}
+
+const PipelineManager::PipelineEntry *PipelineManager::FindEntry(PipelineHandle handle) const {
+    if (handle.Generation() != 1 || handle.Index() >= _entries.size()) {
+        return nullptr;
+    }
+    return &_entries[handle.Index()];
+}
+
+void PipelineManager::Submit(std::function<void()> &&compile) {
+    _pendingCount.fetch_add(1);
+    _threadPool->Submit([this, compile = std::move(compile)]() {
+        compile();
+        _pendingCount.fetch_sub(1);
+        _pendingCount.notify_all();
+    });
+}
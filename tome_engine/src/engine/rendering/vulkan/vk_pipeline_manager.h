@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+
+#include "engine/core/handle_pool.h"
+#include "engine/core/thread_pool.h"
+#include "vk_pipeline_library.h"
+#include "vk_pipelines.h"
+
+// Pipelines are never destroyed before Cleanup, so every handle keeps generation 1.
+using PipelineHandle = Handle<struct PipelineTag>;
+
+constexpr PipelineHandle INVALID_PIPELINE_HANDLE = {};
+
+enum class PipelineStatus : uint8_t {
+    Pending,
+    Ready,
+    Failed,
+};
+
+// Loads the code of a shader module's entry points. Called from worker threads.
+using ShaderProgramLoader = std::function<std::optional<ShaderProgram>(const char *moduleName,
+    std::span<const char *const> entryPoints)>;
+
+// Hands out pipeline handles right away and compiles the shaders and pipelines behind them on the
+// thread pool, so that loading new materials mid-session never blocks Draw.
+// Until a pipeline is ready Get returns the pipeline of its fallback handle instead, or
+// VK_NULL_HANDLE when there is none, in which case the draw using it is skipped.
+class PipelineManager {
+public:
+    void Init(VkDevice device,
+        ThreadPool &threadPool,
+        GraphicsPipelineLibrary &pipelineLibrary,
+        ShaderProgramLoader &&shaderLoader);
+
+    // Waits for compiles still in flight, then destroys the compute pipelines.
+    // Graphics pipelines are owned by the pipeline library.
+    void Cleanup();
+
+    PipelineHandle CreateComputePipeline(const char *moduleName,
+        const char *entryPoint,
+        VkPipelineLayout layout,
+        VkPipelineCreateFlags flags = 0,
+        PipelineHandle fallback = INVALID_PIPELINE_HANDLE);
+
+    // Shader stages of builder are ignored, they are compiled from the given entry points.
+    PipelineHandle CreateGraphicsPipeline(const char *moduleName,
+        const char *vertexEntryPoint,
+        const char *fragmentEntryPoint,
+        const PipelineBuilder &builder,
+        PipelineHandle fallback = INVALID_PIPELINE_HANDLE);
+
+    PipelineStatus GetStatus(PipelineHandle handle) const;
+
+    VkPipeline Get(PipelineHandle handle) const;
+
+private:
+    struct PipelineEntry {
+        std::atomic<PipelineStatus> status = PipelineStatus::Pending;
+        // written by the worker before status becomes Ready
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        LinkedPipelineId linkedPipeline = INVALID_LINKED_PIPELINE;
+        PipelineHandle fallback = INVALID_PIPELINE_HANDLE;
+    };
+
+    VkDevice _device = VK_NULL_HANDLE;
+    ThreadPool *_threadPool = nullptr;
+    GraphicsPipelineLibrary *_pipelineLibrary = nullptr;
+    ShaderProgramLoader _shaderLoader;
+
+    // deque so that workers can hold on to their entry while new ones are added
+    std::deque<PipelineEntry> _entries;
+    std::atomic<uint32_t> _pendingCount = 0;
+
+    PipelineHandle AddEntry(PipelineHandle fallback);
+    const PipelineEntry *FindEntry(PipelineHandle handle) const;
+    void Submit(std::function<void()> &&compile);
+};
@@ -1,61 +1,461 @@
 ﻿#include "vk_pipelines.h"
 
-std::optional<VkShaderModule> vk::LoadShaderModule(
-    const char *shaderFileName,
-    VkDevice device,
-    Slang::ComPtr<slang::ISession> slangSession) {
+#include "vk_extensions.h"
+#include "vk_initializers.h"
+#include "vk_shader_archive.h"
 
-    slang::IModule *slangModule;
-    {
-        Slang::ComPtr<slang::IBlob> sourceBlob;
-        Slang::ComPtr<slang::IBlob> diagnosticsBlob;
-        slangModule = slangSession->loadModule(shaderFileName, diagnosticsBlob.writeRef());
-        if (diagnosticsBlob) {
-            spdlog::error("shader diagnostic: {}", static_cast<const char *>(diagnosticsBlob->getBufferPointer()));
-        }
-        if (!slangModule) {
-            spdlog::error("shader failed to load");
-            return {};
+#ifndef DIST
+#include "vk_slang.h"
+
+static void LogShaderDiagnostics(slang::IBlob *diagnosticsBlob) {
+    if (diagnosticsBlob) {
+        spdlog::error("shader diagnostic: {}", static_cast<const char *>(diagnosticsBlob->getBufferPointer()));
+    }
+}
+#endif
+
+const ShaderCode *ShaderProgram::FindStage(VkShaderStageFlagBits stage) const {
+    for (const ShaderCode &code : stages) {
+        if (code.stage == stage) {
+            return &code;
         }
     }
+    return nullptr;
+}
+
+void DynamicGraphicsState::SetExtent(VkExtent2D extent) {
+    viewport.x = 0;
+    viewport.y = 0;
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.f;
+    viewport.maxDepth = 1.f;
+
+    scissor.offset = { 0, 0 };
+    scissor.extent = extent;
+}
+
+void PipelineBuilder::Clear() {
+    shaderStages.clear();
+
+    dynamicStates = {
+        VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT,
+        VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT,
+        VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY,
+        VK_DYNAMIC_STATE_CULL_MODE,
+        VK_DYNAMIC_STATE_FRONT_FACE,
+        VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE,
+        VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,
+        VK_DYNAMIC_STATE_DEPTH_COMPARE_OP,
+    };
+
+    inputAssembly = { .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    rasterizer = { .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.f;
+
+    colorBlendAttachment = {};
+    multisampling = { .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
+    depthStencil = { .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO };
+    renderInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO };
+    colorAttachmentFormat = VK_FORMAT_UNDEFINED;
+    pipelineLayout = VK_NULL_HANDLE;
+
+    SetMultisamplingNone();
+    DisableBlending();
+}
+
+PipelineBuilder &PipelineBuilder::SetShaders(VkShaderModule vertexShader, VkShaderModule fragmentShader) {
+    shaderStages.clear();
+    shaderStages.push_back(vk::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertexShader));
+    shaderStages.push_back(vk::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader));
+    return *this;
+}
+
+PipelineBuilder &PipelineBuilder::SetPolygonMode(VkPolygonMode mode) {
+    rasterizer.polygonMode = mode;
+    return *this;
+}
+
+PipelineBuilder &PipelineBuilder::SetMultisamplingNone() {
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling.minSampleShading = 1.f;
+    multisampling.pSampleMask = nullptr;
+    multisampling.alphaToCoverageEnable = VK_FALSE;
+    multisampling.alphaToOneEnable = VK_FALSE;
+    return *this;
+}
+
+PipelineBuilder &PipelineBuilder::DisableBlending() {
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+    return *this;
+}
+
+PipelineBuilder &PipelineBuilder::EnableBlendingAdditive() {
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    return *this;
+}
+
+PipelineBuilder &PipelineBuilder::EnableBlendingAlphaBlend() {
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    return *this;
+}
+
+PipelineBuilder &PipelineBuilder::SetColorAttachmentFormat(VkFormat format) {
+    colorAttachmentFormat = format;
+    renderInfo.colorAttachmentCount = 1;
+    renderInfo.pColorAttachmentFormats = &colorAttachmentFormat;
+    return *this;
+}
+
+PipelineBuilder &PipelineBuilder::SetDepthFormat(VkFormat format) {
+    renderInfo.depthAttachmentFormat = format;
+    return *this;
+}
+
+PipelineBuilder &PipelineBuilder::SetLayout(VkPipelineLayout layout) {
+    pipelineLayout = layout;
+    return *this;
+}
+
+PipelineBuilder &PipelineBuilder::EnableExtendedDynamicState3() {
+    dynamicStates.push_back(VK_DYNAMIC_STATE_POLYGON_MODE_EXT);
+    dynamicStates.push_back(VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT);
+    dynamicStates.push_back(VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT);
+    dynamicStates.push_back(VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT);
+    return *this;
+}
+
+VkPipeline PipelineBuilder::Build(VkDevice device) {
+    // viewport and scissor counts come from the dynamic *_WITH_COUNT state
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.pNext = nullptr;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.pNext = nullptr;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.logicOp = VK_LOGIC_OP_COPY;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    // vertices are pulled from buffers in the shaders
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineDynamicStateCreateInfo dynamicInfo = {};
+    dynamicInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicInfo.pDynamicStates = dynamicStates.data();
+    dynamicInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+
+    // copies of the builder still point at the original's format
+    renderInfo.pColorAttachmentFormats = renderInfo.colorAttachmentCount > 0 ? &colorAttachmentFormat : nullptr;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = &renderInfo;
+    pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+    pipelineInfo.pStages = shaderStages.data();
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pDynamicState = &dynamicInfo;
+    pipelineInfo.layout = pipelineLayout;
+
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        spdlog::error("failed to create graphics pipeline");
+        return VK_NULL_HANDLE;
+    }
+    return pipeline;
+}
+
+#ifndef DIST
+slang::IModule *ShaderCompiler::LoadModule(const char *moduleName) {
+    if (auto it = modules.find(moduleName); it != modules.end()) {
+        return it->second;
+    }
 
-    Slang::ComPtr<slang::IEntryPoint> entryPoint;
-    slangModule->findEntryPointByName("computeMain", entryPoint.writeRef());
+    Slang::ComPtr<slang::IBlob> diagnosticsBlob;
+    Slang::ComPtr<slang::IModule> slangModule;
+    slangModule = session->loadModule(moduleName, diagnosticsBlob.writeRef());
+    LogShaderDiagnostics(diagnosticsBlob);
+    if (!slangModule) {
+        spdlog::error("shader {} failed to load", moduleName);
+        return nullptr;
+    }
 
+    modules.emplace(moduleName, slangModule);
+    return slangModule;
+}
 
-    std::vector<slang::IComponentType *> componentTypes = { slangModule, entryPoint };
+std::optional<ShaderProgram> ShaderCompiler::Compile(const char *moduleName, std::span<const char *const> entryPoints) {
+    std::lock_guard lock(mutex);
 
+    slang::IModule *slangModule = LoadModule(moduleName);
+    if (!slangModule) {
+        return {};
+    }
+
+    std::vector<Slang::ComPtr<slang::IEntryPoint>> slangEntryPoints(entryPoints.size());
+    std::vector<slang::IComponentType *> componentTypes = { slangModule };
+    for (size_t i = 0; i < entryPoints.size(); i++) {
+        if (SLANG_FAILED(slangModule->findEntryPointByName(entryPoints[i], slangEntryPoints[i].writeRef()))) {
+            spdlog::error("shader {} has no entry point {}", moduleName, entryPoints[i]);
+            return {};
+        }
+        componentTypes.push_back(slangEntryPoints[i]);
+    }
 
     Slang::ComPtr<slang::IComponentType> composedProgram;
     {
         Slang::ComPtr<slang::IBlob> diagnosticsBlob;
-        SlangResult result = slangSession->createCompositeComponentType(
+        SlangResult result = session->createCompositeComponentType(
             componentTypes.data(),
-            componentTypes.size(),
+            static_cast<SlangInt>(componentTypes.size()),
             composedProgram.writeRef(),
             diagnosticsBlob.writeRef());
-        if (diagnosticsBlob) {
-            spdlog::error("shader diagnostic: {}", static_cast<const char *>(diagnosticsBlob->getBufferPointer()));
+        LogShaderDiagnostics(diagnosticsBlob);
+        if (SLANG_FAILED(result)) {
             return {};
         }
     }
-    Slang::ComPtr<slang::IBlob> spirvCode;
+
+    Slang::ComPtr<slang::IComponentType> linkedProgram;
     {
         Slang::ComPtr<slang::IBlob> diagnosticsBlob;
-        SlangResult result = composedProgram->getEntryPointCode(0, 0, spirvCode.writeRef(), diagnosticsBlob.writeRef());
-        if (diagnosticsBlob) {
-            spdlog::error("shader diagnostic: {}", static_cast<const char *>(diagnosticsBlob->getBufferPointer()));
+        SlangResult result = composedProgram->link(linkedProgram.writeRef(), diagnosticsBlob.writeRef());
+        LogShaderDiagnostics(diagnosticsBlob);
+        if (SLANG_FAILED(result)) {
+            return {};
+        }
+    }
+
+    slang::ProgramLayout *programLayout = linkedProgram->getLayout();
+
+    ShaderProgram program;
+    for (size_t i = 0; i < entryPoints.size(); i++) {
+        Slang::ComPtr<slang::IBlob> spirvCode;
+        Slang::ComPtr<slang::IBlob> diagnosticsBlob;
+        SlangResult result = linkedProgram->getEntryPointCode(
+            static_cast<SlangInt>(i),
+            0,
+            spirvCode.writeRef(),
+            diagnosticsBlob.writeRef());
+        LogShaderDiagnostics(diagnosticsBlob);
+        if (SLANG_FAILED(result)) {
+            return {};
+        }
+
+        const SlangStage stage = programLayout->getEntryPointByIndex(i)->getStage();
+        program.stages.push_back({
+            .entryPoint = entryPoints[i],
+            .stage = vk::ToShaderStage(stage),
+            .spirv = { static_cast<const uint32_t *>(spirvCode->getBufferPointer()),
+                       spirvCode->getBufferSize() / sizeof(uint32_t) } });
+        program.blobs.push_back(spirvCode);
+    }
+
+    return program;
+}
+#endif
+
+std::optional<ShaderProgram> vk::LoadShaderProgram(
+    const ShaderArchive &archive,
+    const char *moduleName,
+    std::span<const char *const> entryPoints) {
+
+    ShaderProgram program;
+    for (const char *entryPoint : entryPoints) {
+        const ShaderArchiveEntry *entry = archive.FindEntry(moduleName, entryPoint);
+        if (!entry) {
+            spdlog::error("shader {}:{} not found in shader archive", moduleName, entryPoint);
             return {};
         }
+
+        // the code is aligned inside the mapped archive, so it can be handed to the driver as is
+        program.stages.push_back({
+            .entryPoint = entryPoint,
+            .stage = static_cast<VkShaderStageFlagBits>(entry->stage),
+            .spirv = archive.GetCode(*entry) });
     }
 
+    return program;
+}
+
+std::optional<VkShaderModule> vk::CreateShaderModule(VkDevice device, const ShaderCode &code) {
     VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
     shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     shaderModuleCreateInfo.pNext = nullptr;
-    shaderModuleCreateInfo.codeSize = spirvCode->getBufferSize();
-    shaderModuleCreateInfo.pCode = static_cast<const uint32_t *>(spirvCode->getBufferPointer());
+    shaderModuleCreateInfo.codeSize = code.spirv.size_bytes();
+    shaderModuleCreateInfo.pCode = code.spirv.data();
 
     VkShaderModule shaderModule;
     VK_CHECK(vkCreateShaderModule(device, &shaderModuleCreateInfo, nullptr, &shaderModule));
     return { shaderModule };
+}
+
+VkPipeline vk::CreateComputePipeline(VkDevice device,
+    const ShaderCode &code,
+    VkPipelineLayout layout,
+    VkPipelineCreateFlags flags) {
+    auto shaderModule = CreateShaderModule(device, code);
+    if (!shaderModule.has_value()) {
+        return VK_NULL_HANDLE;
+    }
+
+    VkComputePipelineCreateInfo computePipelineCreateInfo = {};
+    computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    computePipelineCreateInfo.pNext = nullptr;
+    computePipelineCreateInfo.flags = flags;
+    computePipelineCreateInfo.layout = layout;
+    computePipelineCreateInfo.stage = PipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, shaderModule.value());
+
+    VkPipeline pipeline;
+    const VkResult result = vkCreateComputePipelines(device,
+        VK_NULL_HANDLE,
+        1,
+        &computePipelineCreateInfo,
+        nullptr,
+        &pipeline);
+    vkDestroyShaderModule(device, shaderModule.value(), nullptr);
+
+    if (result != VK_SUCCESS) {
+        spdlog::error("failed to create compute pipeline");
+        return VK_NULL_HANDLE;
+    }
+    return pipeline;
+}
+
+std::optional<ShaderObjects> vk::CreateShaderObjects(
+    VkDevice device,
+    const ShaderProgram &program,
+    std::span<const VkDescriptorSetLayout> setLayouts,
+    std::span<const VkPushConstantRange> pushConstantRanges) {
+
+    const bool linkStages = program.stages.size() > 1;
+
+    std::vector<VkShaderCreateInfoEXT> shaderCreateInfos;
+    for (size_t i = 0; i < program.stages.size(); i++) {
+        const ShaderCode &code = program.stages[i];
+
+        VkShaderCreateInfoEXT shaderCreateInfo = {};
+        shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT;
+        shaderCreateInfo.pNext = nullptr;
+        shaderCreateInfo.flags = linkStages ? VK_SHADER_CREATE_LINK_STAGE_BIT_EXT : 0;
+        shaderCreateInfo.stage = code.stage;
+        shaderCreateInfo.nextStage = i + 1 < program.stages.size() ? program.stages[i + 1].stage : 0;
+        shaderCreateInfo.codeType = VK_SHADER_CODE_TYPE_SPIRV_EXT;
+        shaderCreateInfo.codeSize = code.spirv.size_bytes();
+        shaderCreateInfo.pCode = code.spirv.data();
+        shaderCreateInfo.pName = "main";
+        shaderCreateInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+        shaderCreateInfo.pSetLayouts = setLayouts.data();
+        shaderCreateInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+        shaderCreateInfo.pPushConstantRanges = pushConstantRanges.data();
+        shaderCreateInfo.pSpecializationInfo = nullptr;
+
+        shaderCreateInfos.push_back(shaderCreateInfo);
+    }
+
+    ShaderObjects shaderObjects;
+    shaderObjects.shaders.resize(shaderCreateInfos.size(), VK_NULL_HANDLE);
+    for (const ShaderCode &code : program.stages) {
+        shaderObjects.stages.push_back(code.stage);
+    }
+
+    VkResult result = CreateShadersEXT(device,
+        static_cast<uint32_t>(shaderCreateInfos.size()),
+        shaderCreateInfos.data(),
+        nullptr,
+        shaderObjects.shaders.data());
+    if (result != VK_SUCCESS) {
+        spdlog::error("failed to create shader objects: {}", string_VkResult(result));
+        DestroyShaderObjects(device, shaderObjects);
+        return {};
+    }
+
+    return shaderObjects;
+}
+
+void vk::DestroyShaderObjects(VkDevice device, const ShaderObjects &shaderObjects) {
+    for (VkShaderEXT shader : shaderObjects.shaders) {
+        if (shader != VK_NULL_HANDLE) {
+            DestroyShaderEXT(device, shader, nullptr);
+        }
+    }
+}
+
+void vk::BindShaderObjects(VkCommandBuffer cmd, const ShaderObjects &shaderObjects) {
+    // tessellation and geometry shaders are not enabled on the device, so those stages need no unbinding
+    CmdBindShadersEXT(cmd,
+        static_cast<uint32_t>(shaderObjects.stages.size()),
+        shaderObjects.stages.data(),
+        shaderObjects.shaders.data());
+}
+
+void vk::SetDynamicGraphicsState(VkCommandBuffer cmd, const DynamicGraphicsState &state, bool extendedDynamicState3) {
+    vkCmdSetViewportWithCount(cmd, 1, &state.viewport);
+    vkCmdSetScissorWithCount(cmd, 1, &state.scissor);
+    vkCmdSetPrimitiveTopology(cmd, state.topology);
+    vkCmdSetCullMode(cmd, state.cullMode);
+    vkCmdSetFrontFace(cmd, state.frontFace);
+    vkCmdSetDepthTestEnable(cmd, state.depthTest);
+    vkCmdSetDepthWriteEnable(cmd, state.depthWrite);
+    vkCmdSetDepthCompareOp(cmd, state.depthCompareOp);
+
+    if (extendedDynamicState3) {
+        const VkBool32 blendEnable = state.blendEnable;
+        const VkColorComponentFlags writeMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                                VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        CmdSetPolygonModeEXT(cmd, state.polygonMode);
+        CmdSetColorBlendEnableEXT(cmd, 0, 1, &blendEnable);
+        CmdSetColorBlendEquationEXT(cmd, 0, 1, &state.blendEquation);
+        CmdSetColorWriteMaskEXT(cmd, 0, 1, &writeMask);
+    }
+}
+
+void vk::SetShaderObjectGraphicsState(VkCommandBuffer cmd, const DynamicGraphicsState &state) {
+    SetDynamicGraphicsState(cmd, state, true);
+
+    vkCmdSetRasterizerDiscardEnable(cmd, VK_FALSE);
+    vkCmdSetPrimitiveRestartEnable(cmd, VK_FALSE);
+    vkCmdSetDepthBiasEnable(cmd, VK_FALSE);
+    vkCmdSetDepthBoundsTestEnable(cmd, VK_FALSE);
+    vkCmdSetStencilTestEnable(cmd, VK_FALSE);
+
+    CmdSetRasterizationSamplesEXT(cmd, VK_SAMPLE_COUNT_1_BIT);
+    const VkSampleMask sampleMask = ~0u;
+    CmdSetSampleMaskEXT(cmd, VK_SAMPLE_COUNT_1_BIT, &sampleMask);
+    CmdSetAlphaToCoverageEnableEXT(cmd, VK_FALSE);
+
+    // vertex data is pulled from buffers in the shaders, so there is no vertex input
+    CmdSetVertexInputEXT(cmd, 0, nullptr, 0, nullptr);
 }
\ No newline at end of file
@@ -1,10 +1,142 @@
 ﻿#pragma once 
+#ifndef DIST
+#include <mutex>
+#include <unordered_map>
+
 #include <slang/slang-com-ptr.h>
+#endif
 
 #include "vk_types.h"
 
+class ShaderArchive;
+
+// SPIR-V of a single entry point. Points either into a Slang blob or into the mapped shader archive.
+struct ShaderCode {
+    std::string entryPoint;
+    VkShaderStageFlagBits stage;
+    std::span<const uint32_t> spirv;
+};
+
+// Every requested entry point of one module, produced by a single link.
+struct ShaderProgram {
+    std::vector<ShaderCode> stages;
+
+#ifndef DIST
+    // owns the code the stages point into
+    std::vector<Slang::ComPtr<slang::IBlob>> blobs;
+#endif
+
+    const ShaderCode *FindStage(VkShaderStageFlagBits stage) const;
+};
+
+// VK_EXT_shader_object counterpart of a pipeline: one VkShaderEXT per stage, graphics stages linked together.
+struct ShaderObjects {
+    std::vector<VkShaderStageFlagBits> stages;
+    std::vector<VkShaderEXT> shaders;
+};
+
+// Graphics state that pipelines built by PipelineBuilder leave dynamic, so that one pipeline
+// covers every combination of it. Applied per draw with vk::SetDynamicGraphicsState.
+struct DynamicGraphicsState {
+    VkViewport viewport = {};
+    VkRect2D scissor = {};
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+    VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+    bool depthTest = false;
+    bool depthWrite = false;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;
+
+    // only dynamic with VK_EXT_extended_dynamic_state3
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    bool blendEnable = false;
+    VkColorBlendEquationEXT blendEquation = {
+        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .colorBlendOp = VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .alphaBlendOp = VK_BLEND_OP_ADD };
+
+    void SetExtent(VkExtent2D extent);
+};
+
+// Builds graphics pipelines for dynamic rendering, no render passes involved.
+// Everything listed in DynamicGraphicsState is dynamic, the builder only bakes shaders,
+// attachment formats and (without extended dynamic state 3) rasterization and blending.
+struct PipelineBuilder {
+    std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+    std::vector<VkDynamicState> dynamicStates;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly;
+    VkPipelineRasterizationStateCreateInfo rasterizer;
+    VkPipelineColorBlendAttachmentState colorBlendAttachment;
+    VkPipelineMultisampleStateCreateInfo multisampling;
+    VkPipelineDepthStencilStateCreateInfo depthStencil;
+    VkPipelineRenderingCreateInfo renderInfo;
+    VkFormat colorAttachmentFormat;
+    VkPipelineLayout pipelineLayout;
+
+    PipelineBuilder() { Clear(); }
+
+    void Clear();
+
+    PipelineBuilder &SetShaders(VkShaderModule vertexShader, VkShaderModule fragmentShader);
+    PipelineBuilder &SetPolygonMode(VkPolygonMode mode);
+    PipelineBuilder &SetMultisamplingNone();
+    PipelineBuilder &DisableBlending();
+    PipelineBuilder &EnableBlendingAdditive();
+    PipelineBuilder &EnableBlendingAlphaBlend();
+    PipelineBuilder &SetColorAttachmentFormat(VkFormat format);
+    PipelineBuilder &SetDepthFormat(VkFormat format);
+    PipelineBuilder &SetLayout(VkPipelineLayout layout);
+
+    // Also leaves polygon mode and blending dynamic. Requires VK_EXT_extended_dynamic_state3.
+    PipelineBuilder &EnableExtendedDynamicState3();
+
+    VkPipeline Build(VkDevice device);
+};
+
+#ifndef DIST
+// Keeps every loaded Slang module around so that one IModule serves all of its entry points.
+// Slang sessions are not thread safe, Compile serializes callers from different threads.
+struct ShaderCompiler {
+    Slang::ComPtr<slang::ISession> session;
+    std::unordered_map<std::string, Slang::ComPtr<slang::IModule>> modules;
+    std::mutex mutex;
+
+    slang::IModule *LoadModule(const char *moduleName);
+
+    // Composes all entry points into one program and fetches their code from a single link.
+    std::optional<ShaderProgram> Compile(const char *moduleName, std::span<const char *const> entryPoints);
+};
+#endif
+
 namespace vk {
- std::optional<VkShaderModule> LoadShaderModule(const char* shaderFileName, VkDevice device, Slang::ComPtr<slang::ISession> slangSession);
+ std::optional<ShaderProgram> LoadShaderProgram(const ShaderArchive& archive,
+    const char* moduleName,
+    std::span<const char* const> entryPoints);
+
+ std::optional<VkShaderModule> CreateShaderModule(VkDevice device, const ShaderCode& code);
+
+ VkPipeline CreateComputePipeline(VkDevice device,
+    const ShaderCode& code,
+    VkPipelineLayout layout,
+    VkPipelineCreateFlags flags = 0);
+
+ std::optional<ShaderObjects> CreateShaderObjects(VkDevice device,
+    const ShaderProgram& program,
+    std::span<const VkDescriptorSetLayout> setLayouts,
+    std::span<const VkPushConstantRange> pushConstantRanges = {});
+
+ void DestroyShaderObjects(VkDevice device, const ShaderObjects& shaderObjects);
+
+ void BindShaderObjects(VkCommandBuffer cmd, const ShaderObjects& shaderObjects);
+
+ void SetDynamicGraphicsState(VkCommandBuffer cmd, const DynamicGraphicsState& state, bool extendedDynamicState3);
 
+ // Shader objects have no baked state, every piece of graphics state must be set before drawing.
+ // Sets everything for a single color attachment from state and leaves the rest at defaults.
+ void SetShaderObjectGraphicsState(VkCommandBuffer cmd, const DynamicGraphicsState& state);
 
 };
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "vk_readback.h"
+
+#include "vk_buffers.h"
+#include "vk_images.h"
+
+// keeps every readback aligned for the texel sizes FormatTexelSize knows about
+static constexpr VkDeviceSize READBACK_ALIGNMENT = 16;
+
+void ReadbackQueue::Init(VkDevice device,
+    VmaAllocator allocator,
+    ThreadPool &threadPool,
+    ResourcePool &resources,
+    uint32_t slotCount) {
+    _device = device;
+    _allocator = allocator;
+    _threadPool = &threadPool;
+    _resources = &resources;
+
+    // slots hold an atomic and can't be moved, build them in place
+    _slots = std::vector<Slot>(slotCount);
+}
+
+void ReadbackQueue::Cleanup() {
+    for (Slot &slot : _slots) {
+        assert(slot.pendingCallbacks.load() == 0);
+        if (slot.buffer.buffer != VK_NULL_HANDLE) {
+            vk::DestroyBuffer(_allocator, slot.buffer);
+        }
+    }
+    _slots.clear();
+    _recordingSlot = nullptr;
+}
+
+void ReadbackQueue::BeginFrame(uint32_t frameIndex, uint64_t frameNumber) {
+    _frameIndex = frameIndex;
+    _frameNumber = frameNumber;
+    _recordingSlot = nullptr;
+
+    for (Slot &slot : _slots) {
+        if (slot.state == SlotState::Processing && slot.pendingCallbacks.load(std::memory_order_acquire) == 0) {
+            slot.requests.clear();
+            slot.used = 0;
+            slot.state = SlotState::Free;
+        } else if (slot.state == SlotState::Recorded && slot.frameIndex == frameIndex) {
+            Dispatch(slot);
+        }
+    }
+}
+
+bool ReadbackQueue::ReadImage(VkCommandBuffer cmd, ImageHandle image, ReadbackCallback &&callback) {
+    const VkExtent3D extent = _resources->GetImageExtent(image);
+    const VkFormat format = _resources->GetImageFormat(image);
+    const uint32_t texelSize = vk::FormatTexelSize(format);
+    if (texelSize == 0) {
+        spdlog::error("Can't read back images of format {}", string_VkFormat(format));
+        return false;
+    }
+
+    const VkDeviceSize size = VkDeviceSize(extent.width) * extent.height * extent.depth * texelSize;
+    Slot *slot = AcquireSlot(size);
+    if (!slot) {
+        spdlog::warn("Readback of frame {} dropped, every readback slot is busy", _frameNumber);
+        return false;
+    }
+    const VkDeviceSize offset = vk::AlignUp(slot->used, READBACK_ALIGNMENT);
+
+    _resources->TransitionImage(cmd,
+        image,
+        { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT },
+        false,
+        0,
+        1);
+
+    VkBufferImageCopy2 region = { .sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2 };
+    region.bufferOffset = offset;
+    // zero row length and height mean tightly packed rows
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = extent;
+
+    VkCopyImageToBufferInfo2 copyInfo = { .sType = VK_STRUCTURE_TYPE_COPY_IMAGE_TO_BUFFER_INFO_2 };
+    copyInfo.srcImage = _resources->GetImage(image);
+    copyInfo.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    copyInfo.dstBuffer = slot->buffer.buffer;
+    copyInfo.regionCount = 1;
+    copyInfo.pRegions = &region;
+    vkCmdCopyImageToBuffer2(cmd, &copyInfo);
+
+    VkBufferMemoryBarrier2 barrier = { .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = slot->buffer.buffer;
+    barrier.offset = offset;
+    barrier.size = size;
+
+    VkDependencyInfo depInfo = {};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.bufferMemoryBarrierCount = 1;
+    depInfo.pBufferMemoryBarriers = &barrier;
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+
+    slot->requests.push_back({
+        .offset = offset,
+        .size = size,
+        .extent = extent,
+        .format = format,
+        .callback = std::move(callback),
+    });
+    slot->used = offset + size;
+    return true;
+}
+
+void ReadbackQueue::Dispatch(Slot &slot) {
+    if (slot.requests.empty()) {
+        slot.used = 0;
+        slot.state = SlotState::Free;
+        return;
+    }
+
+    // the frame's fence has been waited on and the copies are visible to the host domain
+    vmaInvalidateAllocation(_allocator, slot.buffer.allocation, 0, slot.used);
+
+    slot.state = SlotState::Processing;
+    slot.pendingCallbacks.store(static_cast<uint32_t>(slot.requests.size()), std::memory_order_relaxed);
+    for (size_t i = 0; i < slot.requests.size(); i++) {
+        _threadPool->Submit([&slot, i] {
+            const Request &request = slot.requests[i];
+            const ReadbackResult result = {
+                .data = { static_cast<const std::byte *>(slot.buffer.mapped) + request.offset, request.size },
+                .extent = request.extent,
+                .format = request.format,
+                .frameNumber = slot.frameNumber,
+            };
+            request.callback(result);
+            slot.pendingCallbacks.fetch_sub(1, std::memory_order_release);
+        });
+    }
+}
+
+ReadbackQueue::Slot *ReadbackQueue::AcquireSlot(VkDeviceSize size) {
+    if (_recordingSlot && vk::AlignUp(_recordingSlot->used, READBACK_ALIGNMENT) + size <= _recordingSlot->buffer.size) {
+        return _recordingSlot;
+    }
+
+    // a free slot big enough already, otherwise the first free one is grown
+    Slot *slot = nullptr;
+    for (Slot &candidate : _slots) {
+        if (candidate.state != SlotState::Free) {
+            continue;
+        }
+        if (candidate.buffer.size >= size) {
+            slot = &candidate;
+            break;
+        }
+        if (!slot) {
+            slot = &candidate;
+        }
+    }
+    if (!slot) {
+        return nullptr;
+    }
+
+    if (slot->buffer.size < size) {
+        if (slot->buffer.buffer != VK_NULL_HANDLE) {
+            vk::DestroyBuffer(_allocator, slot->buffer);
+        }
+        slot->buffer = vk::CreateBuffer(_device,
+            _allocator,
+            size,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VMA_MEMORY_USAGE_AUTO,
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    }
+
+    slot->state = SlotState::Recorded;
+    slot->frameIndex = _frameIndex;
+    slot->frameNumber = _frameNumber;
+    slot->used = 0;
+    _recordingSlot = slot;
+    return slot;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+
+#include "engine/core/thread_pool.h"
+#include "vk_resources.h"
+
+// Pixels of one readback, rows tightly packed. data points into the readback buffer and is only
+// valid during the callback, copy it out to keep it.
+struct ReadbackResult {
+    std::span<const std::byte> data;
+    VkExtent3D extent;
+    VkFormat format;
+    // frame the copy was recorded in
+    uint64_t frameNumber;
+};
+
+// Runs on a worker thread, so it may encode, hash or write the pixels to disk at its own pace.
+using ReadbackCallback = std::function<void(const ReadbackResult &result)>;
+
+// Copies images back to the cpu without ever waiting on the gpu, for screenshots, frame capture
+// and image comparison tests. ReadImage records a copy into a host visible buffer of the frame
+// being recorded. When the same frame slot comes around again its fence has been waited on, and
+// BeginFrame hands every readback of that frame to the thread pool.
+//
+// The buffers form a ring of slotCount slots. A slot stays with its callbacks until the last one
+// has returned, so with slow callbacks readbacks are dropped (ReadImage returns false) instead of
+// stalling the frame. Buffers grow to the largest frame's readbacks and are kept.
+class ReadbackQueue {
+public:
+    void Init(VkDevice device,
+        VmaAllocator allocator,
+        ThreadPool &threadPool,
+        ResourcePool &resources,
+        uint32_t slotCount);
+
+    // The device must be idle and the thread pool stopped. Readbacks not handed to a worker yet
+    // are dropped without their callback.
+    void Cleanup();
+
+    // After the wait on the fence of frameIndex.
+    void BeginFrame(uint32_t frameIndex, uint64_t frameNumber);
+
+    // Copies level 0 of image, moving it to TRANSFER_SRC_OPTIMAL through the resource pool.
+    // Formats need a fixed texel size, block compressed ones are rejected.
+    bool ReadImage(VkCommandBuffer cmd, ImageHandle image, ReadbackCallback &&callback);
+
+private:
+    enum class SlotState : uint8_t {
+        Free,
+        // copies recorded, waiting for their frame's fence
+        Recorded,
+        // callbacks running on workers
+        Processing,
+    };
+
+    struct Request {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        VkExtent3D extent;
+        VkFormat format;
+        ReadbackCallback callback;
+    };
+
+    struct Slot {
+        SlotState state = SlotState::Free;
+        AllocatedBuffer buffer = {};
+        VkDeviceSize used = 0;
+        std::vector<Request> requests;
+        uint32_t frameIndex = 0;
+        uint64_t frameNumber = 0;
+        std::atomic<uint32_t> pendingCallbacks = 0;
+    };
+
+    VkDevice _device = VK_NULL_HANDLE;
+    VmaAllocator _allocator = nullptr;
+    ThreadPool *_threadPool = nullptr;
+    ResourcePool *_resources = nullptr;
+
+    // never resized after Init, workers hold on to their slot
+    std::vector<Slot> _slots;
+    Slot *_recordingSlot = nullptr;
+    uint32_t _frameIndex = 0;
+    uint64_t _frameNumber = 0;
+
+    void Dispatch(Slot &slot);
+    Slot *AcquireSlot(VkDeviceSize size);
+};
@@ -0,0 +1,299 @@
+#include "vk_resources.h"
+
+#include <algorithm>
+
+#include "vk_buffers.h"
+#include "vk_initializers.h"
+
+static constexpr VkAccessFlags2 WRITE_ACCESS = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+                                               VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+                                               VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                               VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT |
+                                               VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+static VkImageAspectFlags AspectMask(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+        case VK_FORMAT_D32_SFLOAT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT;
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        case VK_FORMAT_S8_UINT:
+            return VK_IMAGE_ASPECT_STENCIL_BIT;
+        default:
+            return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+void ResourcePool::Init(VkDevice device, VmaAllocator allocator) {
+    _device = device;
+    _allocator = allocator;
+}
+
+void ResourcePool::Cleanup() {
+    _images.ForEach([this](ImageHandle,
+        VkImage image,
+        VkImageView view,
+        VkExtent3D,
+        VkFormat,
+        VmaAllocation allocation,
+        const ImageState &) {
+        vkDestroyImageView(_device, view, nullptr);
+        vmaDestroyImage(_allocator, image, allocation);
+    });
+    _images.Clear();
+
+    _buffers.ForEach([this](BufferHandle,
+        VkBuffer buffer,
+        VkDeviceAddress,
+        void *,
+        VkDeviceSize,
+        VkBufferUsageFlags,
+        VmaAllocation allocation) {
+        vmaDestroyBuffer(_allocator, buffer, allocation);
+    });
+    _buffers.Clear();
+
+    _samplers.ForEach([this](SamplerHandle, VkSampler sampler) {
+        vkDestroySampler(_device, sampler, nullptr);
+    });
+    _samplers.Clear();
+}
+
+ImageHandle ResourcePool::CreateImage(VkFormat format,
+    VkExtent3D extent,
+    VkImageUsageFlags usage,
+    VkImageAspectFlags aspectFlags,
+    uint32_t mipLevels) {
+    AllocatedImage newImage = {};
+    newImage.imageFormat = format;
+    newImage.imageExtent = extent;
+    newImage.mipLevels = mipLevels;
+
+    VkImageCreateInfo imageInfo = vk::ImageCreateInfo(format, usage, extent, mipLevels);
+
+    VmaAllocationCreateInfo allocationInfo = {};
+    allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    allocationInfo.requiredFlags = static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VK_CHECK(vmaCreateImage(_allocator, &imageInfo, &allocationInfo, &newImage.image, &newImage.allocation, nullptr));
+
+    VkImageViewCreateInfo viewInfo = vk::ImageviewCreateInfo(format, newImage.image, aspectFlags, mipLevels);
+    VK_CHECK(vkCreateImageView(_device, &viewInfo, nullptr, &newImage.imageView));
+
+    return AddImage(newImage);
+}
+
+ImageHandle ResourcePool::AddImage(const AllocatedImage &image, const ImageAccess &initialAccess) {
+    ImageState state;
+    state.aspectMask = AspectMask(image.imageFormat);
+    state.levels.assign(image.mipLevels, LevelState{ .access = initialAccess });
+
+    const ImageHandle handle = _images.Create(image.image,
+        image.imageView,
+        image.imageExtent,
+        image.imageFormat,
+        image.allocation,
+        std::move(state));
+    if (handle.IsNull()) {
+        spdlog::error("resource pool is out of image handles");
+    }
+    return handle;
+}
+
+void ResourcePool::DestroyImage(ImageHandle handle) {
+    if (!_images.IsValid(handle)) {
+        spdlog::error("destroying stale image handle {:#x}", handle.Value());
+        return;
+    }
+    vkDestroyImageView(_device, *_images.Get<IMAGE_VIEW>(handle), nullptr);
+    vmaDestroyImage(_allocator, *_images.Get<IMAGE>(handle), *_images.Get<IMAGE_ALLOCATION>(handle));
+    _images.Destroy(handle);
+}
+
+void ResourcePool::TransitionImage(VkCommandBuffer cmd,
+    ImageHandle handle,
+    const ImageAccess &next,
+    bool discardContents,
+    uint32_t baseMipLevel,
+    uint32_t levelCount) {
+    ImageState *state = _images.Get<IMAGE_STATE>(handle);
+    assert(state && "stale or null resource handle");
+    if (!state) {
+        return;
+    }
+
+    const uint32_t endLevel = levelCount == VK_REMAINING_MIP_LEVELS ?
+                                  static_cast<uint32_t>(state->levels.size()) :
+                                  baseMipLevel + levelCount;
+    const bool nextWrites = (next.access & WRITE_ACCESS) != 0;
+
+    // levels sharing their previous state share a barrier
+    std::vector<VkImageMemoryBarrier2> barriers;
+    for (uint32_t level = baseMipLevel; level < endLevel; level++) {
+        LevelState &levelState = state->levels[level];
+        ImageAccess &previous = levelState.access;
+        const bool previousWrote = (previous.access & WRITE_ACCESS) != 0;
+        const bool readAfterRead = !discardContents && previous.layout == next.layout && !previousWrote && !nextWrites;
+
+        const VkImageLayout oldLayout = discardContents ? VK_IMAGE_LAYOUT_UNDEFINED : previous.layout;
+        // only writes need to be made available, earlier reads just have to finish
+        VkPipelineStageFlags2 srcStages = previous.stages;
+        VkAccessFlags2 srcAccess = previous.access & WRITE_ACCESS;
+        if (readAfterRead) {
+            if ((next.stages & ~previous.stages) == 0 && (next.access & ~previous.access) == 0) {
+                continue;
+            }
+            // The new stages never waited on the last write. previous.stages were the destination
+            // of the barrier that did, or of a later layout transition, so waiting on them as well
+            // orders the read after both.
+            srcStages |= levelState.writeStages;
+            srcAccess = levelState.writeAccess;
+            previous.stages |= next.stages;
+            previous.access |= next.access;
+        } else {
+            previous = next;
+            // discarded contents leave no write behind to wait on
+            if (nextWrites || discardContents) {
+                levelState.writeStages = nextWrites ? next.stages : VK_PIPELINE_STAGE_2_NONE;
+                levelState.writeAccess = next.access & WRITE_ACCESS;
+            }
+        }
+
+        if (!barriers.empty()) {
+            VkImageMemoryBarrier2 &last = barriers.back();
+            if (last.subresourceRange.baseMipLevel + last.subresourceRange.levelCount == level &&
+                last.oldLayout == oldLayout && last.srcStageMask == srcStages && last.srcAccessMask == srcAccess) {
+                last.subresourceRange.levelCount++;
+                continue;
+            }
+        }
+
+        VkImageMemoryBarrier2 barrier = { .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+        barrier.srcStageMask = srcStages;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstStageMask = next.stages;
+        barrier.dstAccessMask = next.access;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = next.layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = *_images.Get<IMAGE>(handle);
+        barrier.subresourceRange = vk::ImageSubresourceRange(state->aspectMask);
+        barrier.subresourceRange.baseMipLevel = level;
+        barrier.subresourceRange.levelCount = 1;
+        barriers.push_back(barrier);
+    }
+
+    if (barriers.empty()) {
+        return;
+    }
+    VkDependencyInfo depInfo = {};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size());
+    depInfo.pImageMemoryBarriers = barriers.data();
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+}
+
+void ResourcePool::SetImageAccess(ImageHandle handle,
+    const ImageAccess &access,
+    uint32_t baseMipLevel,
+    uint32_t levelCount) {
+    ImageState *state = _images.Get<IMAGE_STATE>(handle);
+    assert(state && "stale or null resource handle");
+    if (!state) {
+        return;
+    }
+
+    const uint32_t endLevel = levelCount == VK_REMAINING_MIP_LEVELS ?
+                                  static_cast<uint32_t>(state->levels.size()) :
+                                  baseMipLevel + levelCount;
+    // the barrier that produced access made everything before it visible to access.stages, later
+    // reads chain behind those stages
+    std::fill(state->levels.begin() + baseMipLevel, state->levels.begin() + endLevel, LevelState{ .access = access });
+}
+
+ImageAccess ResourcePool::GetImageAccess(ImageHandle handle, uint32_t mipLevel) const {
+    const ImageState *state = _images.Get<IMAGE_STATE>(handle);
+    assert(state && "stale or null resource handle");
+    return state ? state->levels[mipLevel].access : ImageAccess{};
+}
+
+BufferHandle ResourcePool::CreateBuffer(VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    VmaMemoryUsage memoryUsage,
+    VmaAllocationCreateFlags flags) {
+    return AddBuffer(vk::CreateBuffer(_device, _allocator, size, usage, memoryUsage, flags));
+}
+
+BufferHandle ResourcePool::AddBuffer(const AllocatedBuffer &buffer) {
+    const BufferHandle handle = _buffers.Create(buffer.buffer,
+        buffer.deviceAddress,
+        buffer.mapped,
+        buffer.size,
+        buffer.usage,
+        buffer.allocation);
+    if (handle.IsNull()) {
+        spdlog::error("resource pool is out of buffer handles");
+        return handle;
+    }
+
+    // lets defragmentation map the allocations it moves back to their handles
+    vmaSetAllocationUserData(_allocator, buffer.allocation, reinterpret_cast<void *>(uintptr_t(handle.Value())));
+    return handle;
+}
+
+BufferHandle ResourcePool::FindBuffer(VmaAllocation allocation) const {
+    VmaAllocationInfo allocationInfo;
+    vmaGetAllocationInfo(_allocator, allocation, &allocationInfo);
+
+    BufferHandle handle;
+    if (allocationInfo.pUserData) {
+        const auto value = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(allocationInfo.pUserData));
+        handle = BufferHandle(value & BufferHandle::INDEX_MASK, value >> BufferHandle::INDEX_BITS);
+    }
+
+    const VmaAllocation *owner = _buffers.Get<BUFFER_ALLOCATION>(handle);
+    return owner && *owner == allocation ? handle : BufferHandle{};
+}
+
+void ResourcePool::ReplaceBuffer(BufferHandle handle, VkBuffer buffer, VkDeviceAddress deviceAddress) {
+    if (!_buffers.IsValid(handle)) {
+        spdlog::error("replacing stale buffer handle {:#x}", handle.Value());
+        return;
+    }
+    *_buffers.Get<BUFFER>(handle) = buffer;
+    *_buffers.Get<BUFFER_ADDRESS>(handle) = deviceAddress;
+}
+
+void ResourcePool::DestroyBuffer(BufferHandle handle) {
+    if (!_buffers.IsValid(handle)) {
+        spdlog::error("destroying stale buffer handle {:#x}", handle.Value());
+        return;
+    }
+    vmaDestroyBuffer(_allocator, *_buffers.Get<BUFFER>(handle), *_buffers.Get<BUFFER_ALLOCATION>(handle));
+    _buffers.Destroy(handle);
+}
+
+SamplerHandle ResourcePool::CreateSampler(const VkSamplerCreateInfo &createInfo) {
+    VkSampler sampler;
+    VK_CHECK(vkCreateSampler(_device, &createInfo, nullptr, &sampler));
+
+    const SamplerHandle handle = _samplers.Create(sampler);
+    if (handle.IsNull()) {
+        spdlog::error("resource pool is out of sampler handles");
+    }
+    return handle;
+}
+
+void ResourcePool::DestroySampler(SamplerHandle handle) {
+    if (!_samplers.IsValid(handle)) {
+        spdlog::error("destroying stale sampler handle {:#x}", handle.Value());
+        return;
+    }
+    vkDestroySampler(_device, *_samplers.Get<SAMPLER>(handle), nullptr);
+    _samplers.Destroy(handle);
+}
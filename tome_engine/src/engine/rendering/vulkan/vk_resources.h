@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cassert>
+
+#include "engine/core/handle_pool.h"
+#include "vk_types.h"
+
+using ImageHandle = Handle<struct ImageTag>;
+using BufferHandle = Handle<struct BufferTag>;
+using SamplerHandle = Handle<struct SamplerTag>;
+
+// The vertex buffer address is looked up per draw, defragmentation may move the buffer.
+struct GPUMeshBuffers {
+    BufferHandle indexBuffer;
+    BufferHandle vertexBuffer;
+};
+
+// Owns the engine's images, buffers and samplers behind 32 bit generational handles. Each field is
+// stored in its own dense array, so render code touching only views or addresses stays on a few
+// cache lines, and a handle to a destroyed resource asserts instead of reading a recycled one.
+//
+// Destroy* releases the resource immediately, defer it with a frame's deletion queue while the
+// gpu may still use it. Pipelines have their own handles, see PipelineManager.
+//
+// Images remember the last access of each mip level, so TransitionImage only needs the state to
+// move to and waits on exactly what came before. This assumes command buffers are submitted in
+// the order they were recorded, on one queue. Barriers recorded by other code, such as the
+// acquire of an upload, are reported back with SetImageAccess.
+class ResourcePool {
+public:
+    void Init(VkDevice device, VmaAllocator allocator);
+
+    // Destroys every resource still alive.
+    void Cleanup();
+
+    // The view covers all mipLevels, see vk::MipLevelCount for a full chain.
+    ImageHandle CreateImage(VkFormat format,
+        VkExtent3D extent,
+        VkImageUsageFlags usage,
+        VkImageAspectFlags aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT,
+        uint32_t mipLevels = 1);
+    // Takes ownership of an image created elsewhere, whose levels are all in state initialAccess.
+    ImageHandle AddImage(const AllocatedImage &image, const ImageAccess &initialAccess = {});
+    void DestroyImage(ImageHandle handle);
+
+    // Records a barrier from the tracked state of each level in the range to next, if one is
+    // needed. A read after reads in the same layout records nothing when an earlier barrier already
+    // covered its stages and accesses, otherwise it waits on the level's last write again. With
+    // discardContents the old layout is UNDEFINED, for images about to be overwritten.
+    void TransitionImage(VkCommandBuffer cmd,
+        ImageHandle handle,
+        const ImageAccess &next,
+        bool discardContents = false,
+        uint32_t baseMipLevel = 0,
+        uint32_t levelCount = VK_REMAINING_MIP_LEVELS);
+    void SetImageAccess(ImageHandle handle,
+        const ImageAccess &access,
+        uint32_t baseMipLevel = 0,
+        uint32_t levelCount = VK_REMAINING_MIP_LEVELS);
+    ImageAccess GetImageAccess(ImageHandle handle, uint32_t mipLevel = 0) const;
+
+    bool IsValid(ImageHandle handle) const { return _images.IsValid(handle); }
+    VkImage GetImage(ImageHandle handle) const { return GetField<IMAGE>(_images, handle); }
+    VkImageView GetImageView(ImageHandle handle) const { return GetField<IMAGE_VIEW>(_images, handle); }
+    VkExtent3D GetImageExtent(ImageHandle handle) const { return GetField<IMAGE_EXTENT>(_images, handle); }
+    VkFormat GetImageFormat(ImageHandle handle) const { return GetField<IMAGE_FORMAT>(_images, handle); }
+    // Null for images placed in memory they do not own, such as transient images.
+    VmaAllocation GetImageAllocation(ImageHandle handle) const { return GetField<IMAGE_ALLOCATION>(_images, handle); }
+
+    BufferHandle CreateBuffer(VkDeviceSize size,
+        VkBufferUsageFlags usage,
+        VmaMemoryUsage memoryUsage,
+        VmaAllocationCreateFlags flags = 0);
+    // Takes ownership of a buffer created elsewhere.
+    BufferHandle AddBuffer(const AllocatedBuffer &buffer);
+    void DestroyBuffer(BufferHandle handle);
+
+    bool IsValid(BufferHandle handle) const { return _buffers.IsValid(handle); }
+    VkBuffer GetBuffer(BufferHandle handle) const { return GetField<BUFFER>(_buffers, handle); }
+    VkDeviceAddress GetBufferAddress(BufferHandle handle) const { return GetField<BUFFER_ADDRESS>(_buffers, handle); }
+    void *GetBufferMapped(BufferHandle handle) const { return GetField<BUFFER_MAPPED>(_buffers, handle); }
+    VkDeviceSize GetBufferSize(BufferHandle handle) const { return GetField<BUFFER_SIZE>(_buffers, handle); }
+    VkBufferUsageFlags GetBufferUsage(BufferHandle handle) const { return GetField<BUFFER_USAGE>(_buffers, handle); }
+
+    // Buffer owning allocation, null when the allocation does not belong to a pool buffer.
+    BufferHandle FindBuffer(VmaAllocation allocation) const;
+
+    // Points handle at a buffer bound to the moved memory of its allocation, see DefragmentationService.
+    void ReplaceBuffer(BufferHandle handle, VkBuffer buffer, VkDeviceAddress deviceAddress);
+
+    SamplerHandle CreateSampler(const VkSamplerCreateInfo &createInfo);
+    void DestroySampler(SamplerHandle handle);
+
+    bool IsValid(SamplerHandle handle) const { return _samplers.IsValid(handle); }
+    VkSampler GetSampler(SamplerHandle handle) const { return GetField<SAMPLER>(_samplers, handle); }
+
+private:
+    // field indices of the pools below
+    static constexpr size_t IMAGE = 0, IMAGE_VIEW = 1, IMAGE_EXTENT = 2, IMAGE_FORMAT = 3, IMAGE_ALLOCATION = 4,
+                            IMAGE_STATE = 5;
+    static constexpr size_t BUFFER = 0, BUFFER_ADDRESS = 1, BUFFER_MAPPED = 2, BUFFER_SIZE = 3, BUFFER_USAGE = 4,
+                            BUFFER_ALLOCATION = 5;
+    static constexpr size_t SAMPLER = 0;
+
+    VkDevice _device = VK_NULL_HANDLE;
+    VmaAllocator _allocator = nullptr;
+
+    struct LevelState {
+        // layout plus the last write, or the reads made to wait on it since
+        ImageAccess access;
+        // kept while reads follow, those in stages not synchronized yet wait on it
+        VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+    };
+
+    struct ImageState {
+        VkImageAspectFlags aspectMask;
+        // one per mip level
+        std::vector<LevelState> levels;
+    };
+
+    HandlePool<ImageTag, VkImage, VkImageView, VkExtent3D, VkFormat, VmaAllocation, ImageState> _images;
+    HandlePool<BufferTag, VkBuffer, VkDeviceAddress, void *, VkDeviceSize, VkBufferUsageFlags, VmaAllocation> _buffers;
+    HandlePool<SamplerTag, VkSampler> _samplers;
+
+    template<size_t I, typename Pool, typename HandleType>
+    static auto GetField(const Pool &pool, HandleType handle) {
+        const auto *field = pool.template Get<I>(handle);
+        assert(field && "stale or null resource handle");
+        return field ? *field : std::remove_cvref_t<decltype(*field)>{};
+    }
+};
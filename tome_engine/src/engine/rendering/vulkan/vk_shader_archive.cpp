@@ -0,0 +1,134 @@
+#include "vk_shader_archive.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+ShaderArchive::~ShaderArchive() {
+    Close();
+}
+
+bool ShaderArchive::Open(const char *path) {
+    Close();
+
+#ifdef _WIN32
+    _file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE) {
+        _file = nullptr;
+        spdlog::error("failed to open shader archive {}", path);
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(_file, &fileSize);
+    _size = static_cast<size_t>(fileSize.QuadPart);
+
+    _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping) {
+        _data = static_cast<const std::byte *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    _file = open(path, O_RDONLY);
+    if (_file < 0) {
+        spdlog::error("failed to open shader archive {}", path);
+        return false;
+    }
+
+    struct stat fileStat = {};
+    fstat(_file, &fileStat);
+    _size = static_cast<size_t>(fileStat.st_size);
+
+    void *mapped = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _file, 0);
+    if (mapped != MAP_FAILED) {
+        _data = static_cast<const std::byte *>(mapped);
+    }
+#endif
+
+    if (!_data) {
+        spdlog::error("failed to map shader archive {}", path);
+        Close();
+        return false;
+    }
+
+    if (!Validate()) {
+        spdlog::error("shader archive {} is corrupt or out of date", path);
+        Close();
+        return false;
+    }
+
+    spdlog::info("mapped shader archive {} ({} entry points)", path, GetHeader().entryCount);
+    return true;
+}
+
+void ShaderArchive::Close() {
+#ifdef _WIN32
+    if (_data) UnmapViewOfFile(_data);
+    if (_mapping) CloseHandle(_mapping);
+    if (_file) CloseHandle(_file);
+    _mapping = nullptr;
+    _file = nullptr;
+#else
+    if (_data) munmap(const_cast<std::byte *>(_data), _size);
+    if (_file >= 0) close(_file);
+    _file = -1;
+#endif
+    _data = nullptr;
+    _size = 0;
+}
+
+const ShaderArchiveEntry *ShaderArchive::FindEntry(std::string_view moduleName, std::string_view entryPoint) const {
+    for (const ShaderArchiveEntry &entry : GetEntries()) {
+        if (GetString(entry.moduleNameOffset) == moduleName && GetString(entry.entryPointNameOffset) == entryPoint) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+std::span<const ShaderArchiveEntry> ShaderArchive::GetEntries() const {
+    const ShaderArchiveHeader &header = GetHeader();
+    return { reinterpret_cast<const ShaderArchiveEntry *>(_data + header.entriesOffset), header.entryCount };
+}
+
+std::span<const ShaderArchiveBinding> ShaderArchive::GetBindings(const ShaderArchiveEntry &entry) const {
+    const ShaderArchiveHeader &header = GetHeader();
+    const auto *bindings = reinterpret_cast<const ShaderArchiveBinding *>(_data + header.bindingsOffset);
+    return { bindings + entry.firstBinding, entry.bindingCount };
+}
+
+std::span<const uint32_t> ShaderArchive::GetCode(const ShaderArchiveEntry &entry) const {
+    return { reinterpret_cast<const uint32_t *>(_data + entry.codeOffset), entry.codeSize / sizeof(uint32_t) };
+}
+
+std::string_view ShaderArchive::GetString(uint32_t offset) const {
+    return { reinterpret_cast<const char *>(_data + GetHeader().stringsOffset + offset) };
+}
+
+bool ShaderArchive::Validate() const {
+    if (_size < sizeof(ShaderArchiveHeader)) return false;
+
+    const ShaderArchiveHeader &header = GetHeader();
+    if (header.magic != SHADER_ARCHIVE_MAGIC || header.version != SHADER_ARCHIVE_VERSION) return false;
+
+    if (header.entriesOffset + header.entryCount * sizeof(ShaderArchiveEntry) > _size) return false;
+    if (header.bindingsOffset + header.bindingCount * sizeof(ShaderArchiveBinding) > _size) return false;
+    if (header.stringsOffset + header.stringsSize > _size) return false;
+    if (header.stringsSize > 0 && _data[header.stringsOffset + header.stringsSize - 1] != std::byte{ 0 }) return false;
+
+    for (const ShaderArchiveEntry &entry : GetEntries()) {
+        if (entry.codeOffset % SHADER_ARCHIVE_ALIGNMENT != 0 || entry.codeSize % sizeof(uint32_t) != 0) return false;
+        if (entry.codeOffset + entry.codeSize > _size) return false;
+        if (entry.firstBinding + entry.bindingCount > header.bindingCount) return false;
+        if (entry.moduleNameOffset >= header.stringsSize || entry.entryPointNameOffset >= header.stringsSize) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "vk_types.h"
+
+#include <string_view>
+
+// On-disk layout of the offline shader archive written by tome_shaderc.
+//
+// [ShaderArchiveHeader][ShaderArchiveEntry * entryCount][ShaderArchiveBinding * bindingCount][string table]
+// followed by the SPIR-V blobs, each starting on a SHADER_ARCHIVE_ALIGNMENT boundary so the
+// mapped pages can be handed to vkCreateShaderModule without copying.
+
+constexpr uint32_t SHADER_ARCHIVE_MAGIC = 0x52415354; // "TSAR"
+constexpr uint32_t SHADER_ARCHIVE_VERSION = 1;
+constexpr uint64_t SHADER_ARCHIVE_ALIGNMENT = 64;
+constexpr const char *SHADER_ARCHIVE_FILE_NAME = "tome_shaders.pak";
+
+struct ShaderArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t bindingCount;
+    uint64_t entriesOffset;
+    uint64_t bindingsOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+};
+
+struct ShaderArchiveEntry {
+    uint32_t moduleNameOffset;
+    uint32_t entryPointNameOffset;
+    uint32_t stage; // VkShaderStageFlagBits
+    uint32_t pushConstantSize;
+    uint32_t threadGroupSize[3];
+    uint32_t firstBinding;
+    uint32_t bindingCount;
+    uint32_t padding;
+    uint64_t codeOffset;
+    uint64_t codeSize;
+};
+
+struct ShaderArchiveBinding {
+    uint32_t set;
+    uint32_t binding;
+    uint32_t descriptorType; // VkDescriptorType
+    uint32_t descriptorCount;
+};
+
+static_assert(sizeof(ShaderArchiveHeader) == 48);
+static_assert(sizeof(ShaderArchiveEntry) == 56);
+static_assert(sizeof(ShaderArchiveBinding) == 16);
+
+// Read-only view over a memory mapped shader archive. Nothing is copied out of the mapping,
+// so the archive must stay open for as long as spans returned by it are in use.
+class ShaderArchive {
+public:
+    ShaderArchive() = default;
+    ~ShaderArchive();
+
+    ShaderArchive(const ShaderArchive &) = delete;
+    ShaderArchive &operator=(const ShaderArchive &) = delete;
+
+    bool Open(const char *path);
+    void Close();
+
+    bool IsOpen() const { return _data != nullptr; }
+
+    const ShaderArchiveEntry *FindEntry(std::string_view moduleName, std::string_view entryPoint) const;
+
+    std::span<const ShaderArchiveEntry> GetEntries() const;
+    std::span<const ShaderArchiveBinding> GetBindings(const ShaderArchiveEntry &entry) const;
+    std::span<const uint32_t> GetCode(const ShaderArchiveEntry &entry) const;
+    std::string_view GetString(uint32_t offset) const;
+
+private:
+    const std::byte *_data = nullptr;
+    size_t _size = 0;
+
+#ifdef _WIN32
+    void *_file = nullptr;
+    void *_mapping = nullptr;
+#else
+    int _file = -1;
+#endif
+
+    const ShaderArchiveHeader &GetHeader() const { return *reinterpret_cast<const ShaderArchiveHeader *>(_data); }
+    bool Validate() const;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "vk_types.h"
+
+#include "slang/slang.h"
+
+// Translation between Slang reflection enums and their Vulkan counterparts.
+// Shared between the runtime compiler and the offline tome_shaderc tool.
+
+namespace vk {
+
+inline VkShaderStageFlagBits ToShaderStage(SlangStage stage) {
+    switch (stage) {
+        case SLANG_STAGE_VERTEX: return VK_SHADER_STAGE_VERTEX_BIT;
+        case SLANG_STAGE_HULL: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+        case SLANG_STAGE_DOMAIN: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+        case SLANG_STAGE_GEOMETRY: return VK_SHADER_STAGE_GEOMETRY_BIT;
+        case SLANG_STAGE_FRAGMENT: return VK_SHADER_STAGE_FRAGMENT_BIT;
+        case SLANG_STAGE_COMPUTE: return VK_SHADER_STAGE_COMPUTE_BIT;
+        case SLANG_STAGE_MESH: return VK_SHADER_STAGE_MESH_BIT_EXT;
+        case SLANG_STAGE_AMPLIFICATION: return VK_SHADER_STAGE_TASK_BIT_EXT;
+        case SLANG_STAGE_RAY_GENERATION: return VK_SHADER_STAGE_RAYGEN_BIT_KHR;
+        case SLANG_STAGE_INTERSECTION: return VK_SHADER_STAGE_INTERSECTION_BIT_KHR;
+        case SLANG_STAGE_ANY_HIT: return VK_SHADER_STAGE_ANY_HIT_BIT_KHR;
+        case SLANG_STAGE_CLOSEST_HIT: return VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
+        case SLANG_STAGE_MISS: return VK_SHADER_STAGE_MISS_BIT_KHR;
+        case SLANG_STAGE_CALLABLE: return VK_SHADER_STAGE_CALLABLE_BIT_KHR;
+        default: return VK_SHADER_STAGE_FLAG_BITS_MAX_ENUM;
+    }
+}
+
+inline VkDescriptorType ToDescriptorType(slang::BindingType bindingType) {
+    switch (bindingType) {
+        case slang::BindingType::Sampler: return VK_DESCRIPTOR_TYPE_SAMPLER;
+        case slang::BindingType::Texture: return VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        case slang::BindingType::CombinedTextureSampler: return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        case slang::BindingType::MutableTexture: return VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        case slang::BindingType::TypedBuffer: return VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+        case slang::BindingType::MutableTypedBuffer: return VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+        case slang::BindingType::RawBuffer:
+        case slang::BindingType::MutableRawBuffer: return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        case slang::BindingType::ConstantBuffer:
+        case slang::BindingType::ParameterBlock: return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        case slang::BindingType::InputRenderTarget: return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        case slang::BindingType::RayTracingAccelerationStructure: return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+        default: return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    }
+}
+
+}
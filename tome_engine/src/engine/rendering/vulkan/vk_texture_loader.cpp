@@ -0,0 +1,280 @@
+#include "vk_texture_loader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "vk_buffers.h"
+#include "vk_images.h"
+#include "vk_initializers.h"
+
+// https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+static constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+struct Ktx2Header {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+struct Ktx2Level {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+static_assert(sizeof(Ktx2Header) == 80);
+static_assert(sizeof(Ktx2Level) == 24);
+
+void TextureLoader::Init(VkDevice device,
+    VkPhysicalDevice physicalDevice,
+    VmaAllocator allocator,
+    ThreadPool &threadPool,
+    UploadQueue &uploadQueue,
+    ResourcePool &resources) {
+    _device = device;
+    _physicalDevice = physicalDevice;
+    _allocator = allocator;
+    _threadPool = &threadPool;
+    _uploadQueue = &uploadQueue;
+    _resources = &resources;
+}
+
+void TextureLoader::Load(const std::string &path, TextureLoadedCallback &&callback) {
+    LoadLevels(path, {}, [callback = std::move(callback)](ImageHandle image, const TextureLevels &) {
+        if (callback) {
+            callback(image);
+        }
+    });
+}
+
+void TextureLoader::LoadLevels(const std::string &path,
+    TextureLevelRange range,
+    TextureLevelsLoadedCallback &&callback) {
+    _pendingCount.fetch_add(1, std::memory_order_relaxed);
+    _threadPool->Submit([this, path, range, callback = std::move(callback)]() mutable {
+        if (!LoadKtx2(path, range, callback)) {
+            std::lock_guard lock(_failedMutex);
+            _failed.push_back(std::move(callback));
+        }
+    });
+}
+
+void TextureLoader::Update() {
+    std::vector<TextureLevelsLoadedCallback> failed;
+    {
+        std::lock_guard lock(_failedMutex);
+        failed.swap(_failed);
+    }
+
+    for (TextureLevelsLoadedCallback &callback : failed) {
+        _pendingCount.fetch_sub(1, std::memory_order_relaxed);
+        if (callback) {
+            callback({}, {});
+        }
+    }
+}
+
+bool TextureLoader::LoadKtx2(const std::string &path, TextureLevelRange range, TextureLevelsLoadedCallback &callback) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        spdlog::error("Failed to open texture {}", path);
+        return false;
+    }
+
+    const uint64_t fileSize = file.tellg();
+    file.seekg(0);
+
+    Ktx2Header header;
+    if (fileSize < sizeof(header) || !file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+        spdlog::error("{} is not a KTX2 file", path);
+        return false;
+    }
+
+    if (header.vkFormat == VK_FORMAT_UNDEFINED || header.supercompressionScheme != 0) {
+        spdlog::error("{} is Basis Universal or supercompressed, which needs a transcoder", path);
+        return false;
+    }
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1 || header.layerCount > 1 ||
+        header.faceCount != 1) {
+        spdlog::error("{} is not a 2D texture", path);
+        return false;
+    }
+
+    const auto format = static_cast<VkFormat>(header.vkFormat);
+    if (vk::GetFormatBlock(format).size == 0) {
+        spdlog::error("{}: unsupported format {}", path, string_VkFormat(format));
+        return false;
+    }
+
+    // levels past the 1x1 one would shift the extent by 32 or more below
+    const VkExtent2D extent = { header.pixelWidth, header.pixelHeight };
+    if (header.levelCount > vk::MipLevelCount(extent)) {
+        spdlog::error("{} has {} levels, more than a {}x{} texture can have",
+            path,
+            header.levelCount,
+            extent.width,
+            extent.height);
+        return false;
+    }
+
+    // a level count of 0 asks the loader to generate mips, only the base level is stored
+    const uint32_t storedLevelCount = std::max(1u, header.levelCount);
+    std::vector<Ktx2Level> levels(storedLevelCount);
+    if (sizeof(header) + storedLevelCount * sizeof(Ktx2Level) > fileSize ||
+        !file.read(reinterpret_cast<char *>(levels.data()),
+            static_cast<std::streamsize>(storedLevelCount * sizeof(Ktx2Level)))) {
+        spdlog::error("{} is truncated", path);
+        return false;
+    }
+
+    uint32_t firstLevel = std::min(range.firstLevel, storedLevelCount - 1);
+    while (firstLevel + 1 < storedLevelCount &&
+           std::max(header.pixelWidth >> firstLevel, header.pixelHeight >> firstLevel) > range.maxExtent) {
+        firstLevel++;
+    }
+
+    TextureLevels textureLevels;
+    textureLevels.extent = { header.pixelWidth, header.pixelHeight };
+    textureLevels.levelCount = storedLevelCount;
+    textureLevels.firstLevel = firstLevel;
+    textureLevels.format = format;
+
+    // levels are stored back to back, smallest first, the requested ones are read in one go
+    uint64_t dataBegin = UINT64_MAX;
+    uint64_t dataEnd = 0;
+    for (uint32_t level = 0; level < storedLevelCount; level++) {
+        const Ktx2Level &levelIndex = levels[level];
+        // compared without adding the two, which could wrap around
+        if (levelIndex.byteOffset > fileSize || levelIndex.byteLength > fileSize - levelIndex.byteOffset) {
+            spdlog::error("{} is truncated", path);
+            return false;
+        }
+        const VkExtent2D levelExtent = { std::max(1u, extent.width >> level), std::max(1u, extent.height >> level) };
+        if (levelIndex.byteLength < vk::ImageByteSize(format, levelExtent)) {
+            spdlog::error("{}: level {} holds {} bytes, a {}x{} {} level needs {}",
+                path,
+                level,
+                levelIndex.byteLength,
+                levelExtent.width,
+                levelExtent.height,
+                string_VkFormat(format),
+                vk::ImageByteSize(format, levelExtent));
+            return false;
+        }
+        if (level >= firstLevel) {
+            dataBegin = std::min(dataBegin, levelIndex.byteOffset);
+            dataEnd = std::max(dataEnd, levelIndex.byteOffset + levelIndex.byteLength);
+        }
+    }
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(_physicalDevice, format, &formatProperties);
+    constexpr VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                                      VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+    if ((formatProperties.optimalTilingFeatures & requiredFeatures) != requiredFeatures) {
+        spdlog::error("{}: the device cannot sample {}", path, string_VkFormat(format));
+        return false;
+    }
+
+    ImageUpload upload;
+    upload.image.mipLevels = storedLevelCount - firstLevel;
+    upload.image.imageFormat = format;
+    upload.image.imageExtent = {
+        std::max(1u, header.pixelWidth >> firstLevel),
+        std::max(1u, header.pixelHeight >> firstLevel),
+        1
+    };
+
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if (header.levelCount == 0) {
+        const MipGenerationMethod method = MipGenerator::GetMethod(_physicalDevice, format);
+        if (method != MipGenerationMethod::None) {
+            upload.image.mipLevels = vk::MipLevelCount({ header.pixelWidth, header.pixelHeight });
+            upload.generateMips = upload.image.mipLevels > 1;
+            usage |= MipGenerator::GetRequiredUsage(method);
+            textureLevels.levelCount = upload.image.mipLevels;
+        } else {
+            spdlog::warn("{}: cannot generate mips for {}, loading the base level only", path, string_VkFormat(format));
+        }
+    }
+
+    upload.staging = vk::CreateBuffer(_device,
+        _allocator,
+        dataEnd - dataBegin,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VMA_MEMORY_USAGE_AUTO,
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    file.seekg(static_cast<std::streamoff>(dataBegin));
+    if (!file.read(static_cast<char *>(upload.staging.mapped), static_cast<std::streamsize>(dataEnd - dataBegin))) {
+        spdlog::error("Failed to read {}", path);
+        vk::DestroyBuffer(_allocator, upload.staging);
+        return false;
+    }
+    vmaFlushAllocation(_allocator, upload.staging.allocation, 0, VK_WHOLE_SIZE);
+
+    // level offsets are aligned to the texel block size in the file, so they stay aligned relative to dataBegin
+    for (uint32_t level = firstLevel; level < storedLevelCount; level++) {
+        VkBufferImageCopy region = {};
+        region.bufferOffset = levels[level].byteOffset - dataBegin;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level - firstLevel;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {
+            std::max(1u, header.pixelWidth >> level),
+            std::max(1u, header.pixelHeight >> level),
+            1
+        };
+        upload.regions.push_back(region);
+    }
+
+    VkImageCreateInfo imageInfo = vk::ImageCreateInfo(format,
+        usage,
+        upload.image.imageExtent,
+        upload.image.mipLevels);
+
+    VmaAllocationCreateInfo allocationInfo = {};
+    allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    allocationInfo.requiredFlags = static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VK_CHECK(vmaCreateImage(_allocator,
+        &imageInfo,
+        &allocationInfo,
+        &upload.image.image,
+        &upload.image.allocation,
+        nullptr));
+
+    VkImageViewCreateInfo viewInfo = vk::ImageviewCreateInfo(format,
+        upload.image.image,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        upload.image.mipLevels);
+    VK_CHECK(vkCreateImageView(_device, &viewInfo, nullptr, &upload.image.imageView));
+
+    upload.onComplete = [this, textureLevels = std::move(textureLevels), callback = std::move(callback)](
+        const AllocatedImage &image) {
+        const ImageHandle handle = _resources->AddImage(image,
+            { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+              VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+              VK_ACCESS_2_SHADER_SAMPLED_READ_BIT });
+        _pendingCount.fetch_sub(1, std::memory_order_relaxed);
+        if (callback) {
+            callback(handle, textureLevels);
+        }
+    };
+    _uploadQueue->Enqueue(std::move(upload));
+    return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+#include "engine/core/thread_pool.h"
+#include "vk_resources.h"
+#include "vk_upload.h"
+
+// Receives the loaded texture on the render thread, a null handle when loading failed.
+using TextureLoadedCallback = std::function<void(ImageHandle image)>;
+
+// Mip chain of a texture file and the part of it a loaded image holds.
+struct TextureLevels {
+    // extent of level 0 and length of the full chain, including levels generated on load
+    VkExtent2D extent = {};
+    uint32_t levelCount = 0;
+    // file level that became level 0 of the image
+    uint32_t firstLevel = 0;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+};
+
+// Levels to load: the finest one is the first at or after firstLevel that fits in maxExtent on
+// both axes. The coarsest level is always loaded, and files without stored mips load whole.
+struct TextureLevelRange {
+    uint32_t firstLevel = 0;
+    uint32_t maxExtent = UINT32_MAX;
+};
+
+using TextureLevelsLoadedCallback = std::function<void(ImageHandle image, const TextureLevels &levels)>;
+
+// Loads KTX2 textures without blocking the render thread. A worker reads and parses the file,
+// checks that the device can sample its format, creates the image and fills a staging buffer,
+// then hands both to the UploadQueue. Once the copy has completed the image is added to the
+// ResourcePool and the callback runs from UploadQueue::Update.
+//
+// Block compressed (BCn, ASTC) and uncompressed formats are copied as stored, one region per mip
+// level, and only the requested levels are read from disk. Files without mips (a level count of 0)
+// get a full chain generated on the gpu when the format allows it. Basis Universal and zstd
+// supercompressed files need a transcoder and are rejected.
+class TextureLoader {
+public:
+    void Init(VkDevice device,
+        VkPhysicalDevice physicalDevice,
+        VmaAllocator allocator,
+        ThreadPool &threadPool,
+        UploadQueue &uploadQueue,
+        ResourcePool &resources);
+
+    // Thread safe, callback always runs on the render thread.
+    void Load(const std::string &path, TextureLoadedCallback &&callback);
+    // As Load, for part of the mip chain, see TextureStreamer.
+    void LoadLevels(const std::string &path, TextureLevelRange range, TextureLevelsLoadedCallback &&callback);
+
+    // Render thread, runs the callbacks of loads that failed on a worker.
+    void Update();
+
+    uint32_t GetPendingCount() const { return _pendingCount.load(std::memory_order_relaxed); }
+
+private:
+    VkDevice _device = VK_NULL_HANDLE;
+    VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+    VmaAllocator _allocator = nullptr;
+    ThreadPool *_threadPool = nullptr;
+    UploadQueue *_uploadQueue = nullptr;
+    ResourcePool *_resources = nullptr;
+
+    std::atomic<uint32_t> _pendingCount = 0;
+
+    std::mutex _failedMutex;
+    std::vector<TextureLevelsLoadedCallback> _failed;
+
+    // Worker side of LoadLevels, returns false when nothing was enqueued.
+    bool LoadKtx2(const std::string &path, TextureLevelRange range, TextureLevelsLoadedCallback &callback);
+};
@@ -0,0 +1,359 @@
+#include "vk_texture_streaming.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "vk_buffers.h"
+#include "vk_images.h"
+
+void TextureStreamer::Init(VkDevice device,
+    VmaAllocator allocator,
+    TextureLoader &textureLoader,
+    ResourcePool &resources,
+    BindlessHeap &bindlessHeap,
+    MemoryBudget &memoryBudget,
+    uint32_t framesInFlight,
+    VkDeviceSize budget) {
+    _device = device;
+    _allocator = allocator;
+    _textureLoader = &textureLoader;
+    _resources = &resources;
+    _bindlessHeap = &bindlessHeap;
+    _memoryBudget = &memoryBudget;
+    _budget = budget;
+
+    _feedback.resize(framesInFlight);
+    for (FeedbackBuffer &feedback : _feedback) {
+        feedback.buffer = vk::CreateBuffer(_device,
+            _allocator,
+            MAX_TEXTURES * sizeof(uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_AUTO,
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+        memset(feedback.buffer.mapped, 0xFF, feedback.buffer.size);
+        vmaFlushAllocation(_allocator, feedback.buffer.allocation, 0, VK_WHOLE_SIZE);
+        feedback.bindlessIndex = _bindlessHeap->RegisterStorageBuffer(feedback.buffer.buffer);
+    }
+    _retired.resize(framesInFlight);
+
+    _memoryBudget->AddEvictionCallback(EVICTION_PRIORITY, [this](uint32_t heapIndex, VkDeviceSize bytesToFree) {
+        return Evict(heapIndex, bytesToFree);
+    });
+}
+
+void TextureStreamer::Cleanup() {
+    for (StreamedTexture &texture : _textures) {
+        Retire(texture.tail);
+        Retire(texture.detail);
+    }
+    _textures.clear();
+    _freeIds.clear();
+
+    for (const std::vector<ResidentImage> &retired : _retired) {
+        for (const ResidentImage &image : retired) {
+            Release(image);
+        }
+    }
+    _retired.clear();
+
+    for (const FeedbackBuffer &feedback : _feedback) {
+        _bindlessHeap->Release(BindlessResourceType::StorageBuffer, feedback.bindlessIndex);
+        vk::DestroyBuffer(_allocator, feedback.buffer);
+    }
+    _feedback.clear();
+}
+
+StreamedTextureId TextureStreamer::Register(const std::string &path) {
+    StreamedTextureId id;
+    if (!_freeIds.empty()) {
+        id = _freeIds.back();
+        _freeIds.pop_back();
+    } else if (_textures.size() < MAX_TEXTURES) {
+        id = static_cast<StreamedTextureId>(_textures.size());
+        _textures.emplace_back();
+    } else {
+        spdlog::error("Texture streamer is full, cannot stream {}", path);
+        return INVALID_STREAMED_TEXTURE;
+    }
+
+    StreamedTexture &texture = _textures[id];
+    texture.path = path;
+    texture.registered = true;
+    texture.lastRequestFrame = _frameNumber;
+
+    const uint32_t generation = texture.generation;
+    _textureLoader->LoadLevels(path,
+        { .firstLevel = 0, .maxExtent = MIP_TAIL_EXTENT },
+        [this, id, generation](ImageHandle image, const TextureLevels &levels) {
+            if (_textures[id].generation != generation) {
+                ResidentImage stale = { .image = image };
+                Retire(stale);
+                return;
+            }
+            OnTailLoaded(id, image, levels);
+        });
+    return id;
+}
+
+void TextureStreamer::Unregister(StreamedTextureId id) {
+    StreamedTexture &texture = _textures[id];
+    Retire(texture.tail);
+    Retire(texture.detail);
+
+    const uint32_t generation = texture.generation + 1;
+    texture = {};
+    texture.generation = generation;
+    _freeIds.push_back(id);
+}
+
+void TextureStreamer::RequestScreenSize(StreamedTextureId id, float screenSize) {
+    const StreamedTexture &texture = _textures[id];
+    if (!texture.TailLoaded()) {
+        return;
+    }
+    const float textureSize = static_cast<float>(std::max(texture.levels.extent.width, texture.levels.extent.height));
+    const float mip = std::floor(std::log2(textureSize / std::max(screenSize, 1.0f)));
+    RequestMip(id, static_cast<uint32_t>(std::max(mip, 0.0f)));
+}
+
+void TextureStreamer::RequestMip(StreamedTextureId id, uint32_t mip) {
+    StreamedTexture &texture = _textures[id];
+    texture.requestedMip = std::min(texture.requestedMip, mip);
+}
+
+void TextureStreamer::Update(uint32_t frameIndex, uint64_t frameNumber) {
+    _frameIndex = frameIndex;
+    _frameNumber = frameNumber;
+
+    for (const ResidentImage &image : _retired[_frameIndex]) {
+        Release(image);
+    }
+    _retired[_frameIndex].clear();
+
+    ReadFeedback();
+
+    std::vector<StreamedTextureId> upgrades;
+    for (StreamedTextureId id = 0; id < _textures.size(); id++) {
+        StreamedTexture &texture = _textures[id];
+        if (!texture.registered || !texture.TailLoaded()) {
+            continue;
+        }
+
+        if (texture.requestedMip != UINT32_MAX) {
+            texture.wantedMip = std::min(texture.requestedMip, texture.TailMip());
+            texture.lastRequestFrame = _frameNumber;
+        } else if (_frameNumber - texture.lastRequestFrame > EVICT_AFTER_FRAMES) {
+            texture.wantedMip = texture.TailMip();
+        }
+        texture.requestedMip = UINT32_MAX;
+
+        if (texture.loadingMip != UINT32_MAX) {
+            continue;
+        }
+        const uint32_t residentMip = texture.ResidentMip();
+        if (texture.wantedMip > residentMip) {
+            // coarser than resident: fall back to the tail right away, or reload a smaller detail
+            if (texture.wantedMip == texture.TailMip()) {
+                Retire(texture.detail);
+            } else if (_pendingLoads < MAX_PENDING_LOADS) {
+                StartDetailLoad(id, texture.wantedMip);
+            }
+        } else if (texture.wantedMip < residentMip) {
+            upgrades.push_back(id);
+        }
+    }
+
+    // textures missing the most levels first, anything that does not fit leaves room for smaller ones
+    std::ranges::sort(upgrades, [this](StreamedTextureId a, StreamedTextureId b) {
+        return _textures[a].ResidentMip() - _textures[a].wantedMip >
+               _textures[b].ResidentMip() - _textures[b].wantedMip;
+    });
+    VkDeviceSize available = GetAvailable();
+    for (StreamedTextureId id : upgrades) {
+        if (_pendingLoads >= MAX_PENDING_LOADS) {
+            break;
+        }
+        // the current detail is released when the new one arrives
+        const StreamedTexture &texture = _textures[id];
+        const VkDeviceSize size = GetDetailSize(texture, texture.wantedMip);
+        const VkDeviceSize extra = size - std::min(size, texture.detail.size);
+        if (extra > available) {
+            continue;
+        }
+        available -= extra;
+        StartDetailLoad(id, texture.wantedMip);
+    }
+}
+
+void TextureStreamer::EndFrame(VkCommandBuffer cmd) const {
+    VkMemoryBarrier2 barrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+    VkDependencyInfo depInfo = {};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.memoryBarrierCount = 1;
+    depInfo.pMemoryBarriers = &barrier;
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+}
+
+BindlessIndex TextureStreamer::GetBindlessIndex(StreamedTextureId id) const {
+    const StreamedTexture &texture = _textures[id];
+    return texture.detail.image.IsNull() ? texture.tail.bindlessIndex : texture.detail.bindlessIndex;
+}
+
+uint32_t TextureStreamer::GetResidentMip(StreamedTextureId id) const {
+    return _textures[id].ResidentMip();
+}
+
+void TextureStreamer::ReadFeedback() {
+    // written by the frame that just retired, and cleared for the one about to be recorded
+    const FeedbackBuffer &feedback = _feedback[_frameIndex];
+    vmaInvalidateAllocation(_allocator, feedback.buffer.allocation, 0, VK_WHOLE_SIZE);
+
+    const auto *mips = static_cast<const uint32_t *>(feedback.buffer.mapped);
+    for (StreamedTextureId id = 0; id < _textures.size(); id++) {
+        if (mips[id] != UINT32_MAX && _textures[id].registered) {
+            RequestMip(id, mips[id]);
+        }
+    }
+
+    memset(feedback.buffer.mapped, 0xFF, _textures.size() * sizeof(uint32_t));
+    vmaFlushAllocation(_allocator, feedback.buffer.allocation, 0, _textures.size() * sizeof(uint32_t));
+}
+
+void TextureStreamer::StartDetailLoad(StreamedTextureId id, uint32_t mip) {
+    StreamedTexture &texture = _textures[id];
+    const VkDeviceSize size = GetDetailSize(texture, mip);
+    texture.loadingMip = mip;
+    _pendingLoads++;
+    _loadingBytes += size;
+
+    const uint32_t generation = texture.generation;
+    _textureLoader->LoadLevels(texture.path,
+        { .firstLevel = mip },
+        [this, id, generation, size](ImageHandle image, const TextureLevels &levels) {
+            _pendingLoads--;
+            _loadingBytes -= size;
+            if (_textures[id].generation != generation) {
+                ResidentImage stale = { .image = image };
+                Retire(stale);
+                return;
+            }
+            OnDetailLoaded(id, image, levels);
+        });
+}
+
+void TextureStreamer::OnTailLoaded(StreamedTextureId id, ImageHandle image, const TextureLevels &levels) {
+    if (image.IsNull()) {
+        spdlog::error("Failed to stream {}", _textures[id].path);
+        return;
+    }
+
+    StreamedTexture &texture = _textures[id];
+    texture.levels = levels;
+    texture.tail = MakeResident(image);
+    texture.wantedMip = texture.TailMip();
+}
+
+void TextureStreamer::OnDetailLoaded(StreamedTextureId id, ImageHandle image, const TextureLevels &levels) {
+    StreamedTexture &texture = _textures[id];
+    texture.loadingMip = UINT32_MAX;
+    if (image.IsNull()) {
+        // keeps what is resident, the next Update tries again
+        return;
+    }
+
+    Retire(texture.detail);
+    texture.detail = MakeResident(image);
+    texture.detailMip = levels.firstLevel;
+}
+
+VkDeviceSize TextureStreamer::Evict(uint32_t heapIndex, VkDeviceSize bytesToFree) {
+    if (heapIndex != _heapIndex) {
+        return 0;
+    }
+
+    // least recently wanted first
+    std::vector<StreamedTextureId> candidates;
+    for (StreamedTextureId id = 0; id < _textures.size(); id++) {
+        if (!_textures[id].detail.image.IsNull()) {
+            candidates.push_back(id);
+        }
+    }
+    std::ranges::sort(candidates, [this](StreamedTextureId a, StreamedTextureId b) {
+        return _textures[a].lastRequestFrame < _textures[b].lastRequestFrame;
+    });
+
+    // the memory is returned once the frames still sampling the detail have retired
+    VkDeviceSize freed = 0;
+    for (StreamedTextureId id : candidates) {
+        if (freed >= bytesToFree) {
+            break;
+        }
+        StreamedTexture &texture = _textures[id];
+        freed += texture.detail.size;
+        Retire(texture.detail);
+    }
+    return freed;
+}
+
+TextureStreamer::ResidentImage TextureStreamer::MakeResident(ImageHandle image) {
+    ResidentImage resident;
+    resident.image = image;
+    resident.bindlessIndex = _bindlessHeap->RegisterSampledImage(_resources->GetImageView(image));
+
+    VmaAllocationInfo allocationInfo;
+    vmaGetAllocationInfo(_allocator, _resources->GetImageAllocation(image), &allocationInfo);
+    resident.size = allocationInfo.size;
+    if (_heapIndex == UINT32_MAX) {
+        _heapIndex = _memoryBudget->GetHeapIndex(allocationInfo.memoryType);
+    }
+
+    _residentBytes += resident.size;
+    return resident;
+}
+
+void TextureStreamer::Retire(ResidentImage &image) {
+    if (image.image.IsNull()) {
+        return;
+    }
+    _residentBytes -= image.size;
+    _retired[_frameIndex].push_back(image);
+    image = {};
+}
+
+void TextureStreamer::Release(const ResidentImage &image) {
+    if (image.bindlessIndex != INVALID_BINDLESS_INDEX) {
+        _bindlessHeap->Release(BindlessResourceType::SampledImage, image.bindlessIndex);
+    }
+    _resources->DestroyImage(image.image);
+}
+
+VkDeviceSize TextureStreamer::GetDetailSize(const StreamedTexture &texture, uint32_t mip) const {
+    // Every level of the image down to 1x1, mips generated on load included. That counts the
+    // levels the tail holds a second time, the detail view needs them for sampling at a distance.
+    // Tightly packed, the allocation's padding is only known once it is resident.
+    VkDeviceSize size = 0;
+    for (uint32_t level = mip; level < texture.levels.levelCount; level++) {
+        const VkExtent2D extent = {
+            std::max(1u, texture.levels.extent.width >> level),
+            std::max(1u, texture.levels.extent.height >> level)
+        };
+        size += vk::ImageByteSize(texture.levels.format, extent);
+    }
+    return size;
+}
+
+VkDeviceSize TextureStreamer::GetAvailable() const {
+    const VkDeviceSize used = _residentBytes + _loadingBytes;
+    VkDeviceSize available = _budget > used ? _budget - used : 0;
+    if (_heapIndex != UINT32_MAX) {
+        const VkDeviceSize heapAvailable = _memoryBudget->GetAvailable(_heapIndex);
+        available = std::min(available, heapAvailable > _loadingBytes ? heapAvailable - _loadingBytes : 0);
+    }
+    return available;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "vk_bindless.h"
+#include "vk_memory_budget.h"
+#include "vk_texture_loader.h"
+
+using StreamedTextureId = uint32_t;
+
+constexpr StreamedTextureId INVALID_STREAMED_TEXTURE = ~0u;
+
+// Keeps as many mip levels of a large texture set resident as the screen needs and the memory
+// budget allows. Each texture always has its mip tail loaded, the levels that fit in
+// MIP_TAIL_EXTENT. Finer levels live in a detail image holding every level from the resident mip
+// down, the tail's included, and loaded from disk again whenever the resident mip changes. The
+// budget counts those duplicated tail levels. Evicting detail frees its
+// memory without waiting on a load, and the sampled view never reaches levels that are not
+// resident, so it doubles as the min LOD clamp.
+//
+// The wanted mip of a texture is the finest one asked for during a frame, from the cpu with
+// RequestScreenSize or by shaders through the feedback buffer (see shaders/texture_streaming.slang),
+// which is read once the frame that wrote it has retired. Textures nobody asks for keep their
+// detail for EVICT_AFTER_FRAMES frames. GetBindlessIndex changes as levels arrive and leave, read
+// it when recording each frame.
+class TextureStreamer {
+public:
+    static constexpr uint32_t MAX_TEXTURES = 4096;
+    static constexpr uint32_t MIP_TAIL_EXTENT = 128;
+    static constexpr uint32_t MAX_PENDING_LOADS = 8;
+    static constexpr uint64_t EVICT_AFTER_FRAMES = 120;
+    // detail is the first thing given up when a heap runs over its budget
+    static constexpr uint32_t EVICTION_PRIORITY = 0;
+
+    void Init(VkDevice device,
+        VmaAllocator allocator,
+        TextureLoader &textureLoader,
+        ResourcePool &resources,
+        BindlessHeap &bindlessHeap,
+        MemoryBudget &memoryBudget,
+        uint32_t framesInFlight,
+        VkDeviceSize budget);
+
+    // The device must be idle.
+    void Cleanup();
+
+    StreamedTextureId Register(const std::string &path);
+    void Unregister(StreamedTextureId id);
+
+    // screenSize is the projected size in pixels of the texture's longer axis.
+    void RequestScreenSize(StreamedTextureId id, float screenSize);
+    void RequestMip(StreamedTextureId id, uint32_t mip);
+
+    // After the wait on the fence of frameIndex. Reads the feedback that frame wrote, releases what
+    // it retired and starts loads and evictions.
+    void Update(uint32_t frameIndex, uint64_t frameNumber);
+
+    // Last command of the frame, makes the feedback written by shaders visible to the host.
+    void EndFrame(VkCommandBuffer cmd) const;
+
+    // INVALID_BINDLESS_INDEX until the mip tail has loaded.
+    BindlessIndex GetBindlessIndex(StreamedTextureId id) const;
+    // Finest resident level, relative to the full resolution texture.
+    uint32_t GetResidentMip(StreamedTextureId id) const;
+    // Extent of the full resolution level, zero until the mip tail has loaded.
+    VkExtent2D GetExtent(StreamedTextureId id) const { return _textures[id].levels.extent; }
+    // Storage buffer the current frame's shaders write feedback to, one uint per texture.
+    BindlessIndex GetFeedbackBufferIndex() const { return _feedback[_frameIndex].bindlessIndex; }
+
+    VkDeviceSize GetResidentBytes() const { return _residentBytes; }
+    void SetBudget(VkDeviceSize budget) { _budget = budget; }
+
+private:
+    struct ResidentImage {
+        ImageHandle image;
+        BindlessIndex bindlessIndex = INVALID_BINDLESS_INDEX;
+        VkDeviceSize size = 0;
+    };
+
+    struct StreamedTexture {
+        std::string path;
+        // filled in when the tail arrives
+        TextureLevels levels;
+        ResidentImage tail;
+        // levels from detailMip down, no image while only the tail is resident
+        ResidentImage detail;
+        uint32_t detailMip = 0;
+
+        uint32_t requestedMip = UINT32_MAX;
+        uint32_t wantedMip = 0;
+        uint64_t lastRequestFrame = 0;
+        // detail load in flight
+        uint32_t loadingMip = UINT32_MAX;
+        // bumped on Unregister, loads completing for an older generation are dropped
+        uint32_t generation = 0;
+        bool registered = false;
+
+        bool TailLoaded() const { return !tail.image.IsNull(); }
+        uint32_t TailMip() const { return levels.firstLevel; }
+        uint32_t ResidentMip() const { return detail.image.IsNull() ? TailMip() : detailMip; }
+    };
+
+    struct FeedbackBuffer {
+        AllocatedBuffer buffer;
+        BindlessIndex bindlessIndex = INVALID_BINDLESS_INDEX;
+    };
+
+    VkDevice _device = VK_NULL_HANDLE;
+    VmaAllocator _allocator = nullptr;
+    TextureLoader *_textureLoader = nullptr;
+    ResourcePool *_resources = nullptr;
+    BindlessHeap *_bindlessHeap = nullptr;
+    MemoryBudget *_memoryBudget = nullptr;
+
+    std::vector<StreamedTexture> _textures;
+    std::vector<StreamedTextureId> _freeIds;
+
+    std::vector<FeedbackBuffer> _feedback;
+    // images replaced or evicted while recording each frame, released once it has retired
+    std::vector<std::vector<ResidentImage>> _retired;
+    uint32_t _frameIndex = 0;
+    uint64_t _frameNumber = 0;
+
+    VkDeviceSize _budget = 0;
+    VkDeviceSize _residentBytes = 0;
+    VkDeviceSize _loadingBytes = 0;
+    uint32_t _pendingLoads = 0;
+    // heap the streamed images are allocated from, known after the first load
+    uint32_t _heapIndex = UINT32_MAX;
+
+    void ReadFeedback();
+    void StartDetailLoad(StreamedTextureId id, uint32_t mip);
+    void OnTailLoaded(StreamedTextureId id, ImageHandle image, const TextureLevels &levels);
+    void OnDetailLoaded(StreamedTextureId id, ImageHandle image, const TextureLevels &levels);
+    VkDeviceSize Evict(uint32_t heapIndex, VkDeviceSize bytesToFree);
+
+    ResidentImage MakeResident(ImageHandle image);
+    void Retire(ResidentImage &image);
+    void Release(const ResidentImage &image);
+
+    VkDeviceSize GetDetailSize(const StreamedTexture &texture, uint32_t mip) const;
+    VkDeviceSize GetAvailable() const;
+};
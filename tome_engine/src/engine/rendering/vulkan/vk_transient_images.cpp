@@ -0,0 +1,222 @@
+#include "vk_transient_images.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "vk_buffers.h"
+#include "vk_initializers.h"
+
+static bool operator==(const TransientImageDesc &a, const TransientImageDesc &b) {
+    return a.format == b.format && a.extent.width == b.extent.width && a.extent.height == b.extent.height &&
+           a.extent.depth == b.extent.depth && a.usage == b.usage && a.aspectFlags == b.aspectFlags &&
+           a.firstPass == b.firstPass && a.lastPass == b.lastPass && a.lastStage == b.lastStage &&
+           a.lastAccess == b.lastAccess;
+}
+
+static bool LifetimesOverlap(const TransientImageDesc &a, const TransientImageDesc &b) {
+    return a.firstPass <= b.lastPass && b.firstPass <= a.lastPass;
+}
+
+void TransientImageAllocator::Init(VkDevice device, VmaAllocator allocator, ResourcePool &resources) {
+    _device = device;
+    _allocator = allocator;
+    _resources = &resources;
+}
+
+void TransientImageAllocator::Cleanup() {
+    Release();
+    _pending.clear();
+    _built.clear();
+}
+
+TransientImageId TransientImageAllocator::Declare(const TransientImageDesc &desc) {
+    _pending.push_back(desc);
+    return static_cast<TransientImageId>(_pending.size() - 1);
+}
+
+void TransientImageAllocator::Build() {
+    if (_pending == _built && !_placements.empty()) {
+        _pending.clear();
+        return;
+    }
+
+    Release();
+    _built = std::move(_pending);
+    _pending.clear();
+
+    const size_t imageCount = _built.size();
+    std::vector<VkImageCreateInfo> imageInfos(imageCount);
+    std::vector<VkMemoryRequirements> requirements(imageCount);
+    for (size_t i = 0; i < imageCount; i++) {
+        const TransientImageDesc &desc = _built[i];
+        imageInfos[i] = vk::ImageCreateInfo(desc.format, desc.usage, desc.extent);
+
+        VkDeviceImageMemoryRequirements requirementsInfo = {};
+        requirementsInfo.sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS;
+        requirementsInfo.pCreateInfo = &imageInfos[i];
+
+        VkMemoryRequirements2 memoryRequirements = {};
+        memoryRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        vkGetDeviceImageMemoryRequirements(_device, &requirementsInfo, &memoryRequirements);
+        requirements[i] = memoryRequirements.memoryRequirements;
+    }
+
+    // largest first, so small targets fill the gaps left between large ones
+    std::vector<uint32_t> order(imageCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, [&](uint32_t a, uint32_t b) { return requirements[a].size > requirements[b].size; });
+
+    _placements.resize(imageCount);
+    std::vector<uint32_t> placed;
+    std::vector<std::pair<VkDeviceSize, VkDeviceSize>> occupied;
+    for (uint32_t image : order) {
+        const VkMemoryRequirements &imageRequirements = requirements[image];
+        Placement &placement = _placements[image];
+        placement.size = imageRequirements.size;
+
+        bool fits = false;
+        for (uint32_t block = 0; block < _blocks.size() && !fits; block++) {
+            VkMemoryRequirements &blockRequirements = _blocks[block].requirements;
+            if ((blockRequirements.memoryTypeBits & imageRequirements.memoryTypeBits) == 0) {
+                continue;
+            }
+
+            occupied.clear();
+            for (uint32_t other : placed) {
+                const Placement &otherPlacement = _placements[other];
+                if (otherPlacement.block == block && LifetimesOverlap(_built[image], _built[other])) {
+                    occupied.emplace_back(otherPlacement.offset, otherPlacement.offset + otherPlacement.size);
+                }
+            }
+            std::ranges::sort(occupied);
+
+            // lowest gap between the ranges in use during this image's lifetime, the block grows if needed
+            VkDeviceSize offset = 0;
+            for (const auto &[begin, end] : occupied) {
+                if (vk::AlignUp(offset, imageRequirements.alignment) + imageRequirements.size <= begin) {
+                    break;
+                }
+                offset = std::max(offset, end);
+            }
+            offset = vk::AlignUp(offset, imageRequirements.alignment);
+
+            placement.block = block;
+            placement.offset = offset;
+            blockRequirements.size = std::max(blockRequirements.size, offset + imageRequirements.size);
+            blockRequirements.alignment = std::max(blockRequirements.alignment, imageRequirements.alignment);
+            blockRequirements.memoryTypeBits &= imageRequirements.memoryTypeBits;
+            fits = true;
+        }
+
+        if (!fits) {
+            placement.block = static_cast<uint32_t>(_blocks.size());
+            placement.offset = 0;
+            _blocks.push_back({ .allocation = nullptr, .requirements = imageRequirements });
+        }
+        placed.push_back(image);
+    }
+
+    for (MemoryBlock &block : _blocks) {
+        VmaAllocationCreateInfo allocationInfo = {};
+        allocationInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        VK_CHECK(vmaAllocateMemory(_allocator, &block.requirements, &allocationInfo, &block.allocation, nullptr));
+    }
+
+    for (size_t i = 0; i < imageCount; i++) {
+        const TransientImageDesc &desc = _built[i];
+        Placement &placement = _placements[i];
+
+        AllocatedImage newImage = {};
+        newImage.imageFormat = desc.format;
+        newImage.imageExtent = desc.extent;
+        // the memory belongs to the block, the resource pool only destroys the image and view
+        newImage.allocation = nullptr;
+
+        VK_CHECK(vmaCreateAliasingImage2(_allocator,
+            _blocks[placement.block].allocation,
+            placement.offset,
+            &imageInfos[i],
+            &newImage.image));
+
+        VkImageViewCreateInfo viewInfo = vk::ImageviewCreateInfo(desc.format, newImage.image, desc.aspectFlags);
+        VK_CHECK(vkCreateImageView(_device, &viewInfo, nullptr, &newImage.imageView));
+
+        placement.image = _resources->AddImage(newImage);
+
+        // the previous occupant of any byte of this image may be any image sharing those bytes,
+        // including this image itself in the previous frame
+        for (size_t other = 0; other < imageCount; other++) {
+            const Placement &otherPlacement = _placements[other];
+            if (otherPlacement.block == placement.block && otherPlacement.offset < placement.offset + placement.size &&
+                placement.offset < otherPlacement.offset + otherPlacement.size) {
+                placement.aliasedStages |= _built[other].lastStage;
+                placement.aliasedAccess |= _built[other].lastAccess;
+            }
+        }
+    }
+
+    spdlog::info("Transient images: {} in {} blocks, {} KiB allocated, {} KiB without aliasing",
+        imageCount,
+        _blocks.size(),
+        GetAllocatedSize() / 1024,
+        GetRequestedSize() / 1024);
+}
+
+ImageHandle TransientImageAllocator::GetImage(TransientImageId id) const {
+    return id < _placements.size() ? _placements[id].image : ImageHandle{};
+}
+
+void TransientImageAllocator::BeginUse(VkCommandBuffer cmd,
+    TransientImageId id,
+    VkImageLayout layout,
+    VkPipelineStageFlags2 dstStage,
+    VkAccessFlags2 dstAccess) const {
+    const Placement &placement = _placements[id];
+
+    VkImageMemoryBarrier2 imageBarrier = { .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+    imageBarrier.srcStageMask = placement.aliasedStages;
+    imageBarrier.srcAccessMask = placement.aliasedAccess;
+    imageBarrier.dstStageMask = dstStage;
+    imageBarrier.dstAccessMask = dstAccess;
+    // contents of whatever lived in this memory before are discarded
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageBarrier.newLayout = layout;
+    imageBarrier.subresourceRange = vk::ImageSubresourceRange(_built[id].aspectFlags);
+    imageBarrier.image = _resources->GetImage(placement.image);
+
+    VkDependencyInfo depInfo = {};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.imageMemoryBarrierCount = 1;
+    depInfo.pImageMemoryBarriers = &imageBarrier;
+
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+
+    _resources->SetImageAccess(placement.image, { layout, dstStage, dstAccess });
+}
+
+VkDeviceSize TransientImageAllocator::GetAllocatedSize() const {
+    VkDeviceSize size = 0;
+    for (const MemoryBlock &block : _blocks) {
+        size += block.requirements.size;
+    }
+    return size;
+}
+
+VkDeviceSize TransientImageAllocator::GetRequestedSize() const {
+    VkDeviceSize size = 0;
+    for (const Placement &placement : _placements) {
+        size += placement.size;
+    }
+    return size;
+}
+
+void TransientImageAllocator::Release() {
+    for (const Placement &placement : _placements) {
+        _resources->DestroyImage(placement.image);
+    }
+    for (const MemoryBlock &block : _blocks) {
+        vmaFreeMemory(_allocator, block.allocation);
+    }
+    _placements.clear();
+    _blocks.clear();
+}
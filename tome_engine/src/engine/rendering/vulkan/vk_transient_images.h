@@ -0,0 +1,86 @@
+#pragma once
+
+#include "vk_resources.h"
+#include "vk_types.h"
+
+using TransientImageId = uint32_t;
+
+// Declaration of a render target that only lives within a frame. Passes are numbered in the
+// order the frame records them, the image is live from the start of firstPass to the end of
+// lastPass. lastStage and lastAccess describe that last use, they are what the next image placed
+// in the same memory has to wait for.
+struct TransientImageDesc {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent3D extent = {};
+    VkImageUsageFlags usage = 0;
+    VkImageAspectFlags aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
+
+    uint32_t firstPass = 0;
+    uint32_t lastPass = 0;
+    VkPipelineStageFlags2 lastStage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    VkAccessFlags2 lastAccess = VK_ACCESS_2_MEMORY_WRITE_BIT;
+};
+
+// Places transient render targets whose pass ranges do not overlap in the same device memory.
+// Images are sorted by size and put at the lowest offset of a shared block that no image with an
+// overlapping lifetime occupies, then created with vmaCreateAliasingImage2 on top of one VMA
+// allocation per block. Peak memory becomes the largest set of simultaneously live targets
+// instead of the sum of all of them.
+//
+// Every image is registered in the ResourcePool, so render code uses plain ImageHandles. Contents
+// never survive a frame: the first use of an image each frame must go through BeginUse, which
+// discards the old contents and waits for the last use of every image sharing its memory.
+class TransientImageAllocator {
+public:
+    void Init(VkDevice device, VmaAllocator allocator, ResourcePool &resources);
+    void Cleanup();
+
+    // Declarations are collected until the next Build and replace the previous set.
+    TransientImageId Declare(const TransientImageDesc &desc);
+
+    // Recreates images and memory when the declarations differ from the last build, which
+    // invalidates the handles of the previous build. Must not run while frames using them are in
+    // flight, meant for startup and resizes rather than every frame.
+    void Build();
+
+    ImageHandle GetImage(TransientImageId id) const;
+
+    // Aliasing barrier for the first use of id in a frame, moves it from UNDEFINED to layout. Later
+    // transitions in the frame go through ResourcePool::TransitionImage.
+    void BeginUse(VkCommandBuffer cmd,
+        TransientImageId id,
+        VkImageLayout layout,
+        VkPipelineStageFlags2 dstStage,
+        VkAccessFlags2 dstAccess) const;
+
+    // Bytes actually allocated and bytes the images would take without aliasing.
+    VkDeviceSize GetAllocatedSize() const;
+    VkDeviceSize GetRequestedSize() const;
+
+private:
+    struct Placement {
+        uint32_t block = 0;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        ImageHandle image;
+        // union of the last uses of every image overlapping this one's memory, itself included
+        VkPipelineStageFlags2 aliasedStages = 0;
+        VkAccessFlags2 aliasedAccess = 0;
+    };
+
+    struct MemoryBlock {
+        VmaAllocation allocation = nullptr;
+        VkMemoryRequirements requirements = {};
+    };
+
+    VkDevice _device = VK_NULL_HANDLE;
+    VmaAllocator _allocator = nullptr;
+    ResourcePool *_resources = nullptr;
+
+    std::vector<TransientImageDesc> _pending;
+    std::vector<TransientImageDesc> _built;
+    std::vector<Placement> _placements;
+    std::vector<MemoryBlock> _blocks;
+
+    void Release();
+};
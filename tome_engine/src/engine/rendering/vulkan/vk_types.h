@@ -16,6 +16,7 @@
 #include "spdlog/spdlog.h"
 
 #include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
 #include "glm/vec4.hpp"
 
 #define VK_CHECK(x)                                                     \
@@ -27,10 +28,83 @@
         }                                                               \
     } while (0)
 
+struct DeletionQueue {
+    std::deque<std::function<void()>> deletors;
+
+    void PushFunction(std::function<void()>&& function) {
+        deletors.push_back(function);
+    }
+
+    void Flush() {
+        for (auto it = deletors.rbegin(); it!= deletors.rend(); it++) {
+            (*it)();
+        }
+        deletors.clear();
+    }
+};
+
+namespace vk {
+
+template<typename T>
+void HashCombine(size_t &seed, const T &value) {
+    seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+}
+
+struct AllocatedBuffer {
+    VkBuffer buffer;
+    VmaAllocation allocation;
+    // null unless the buffer was created host visible and mapped
+    void *mapped;
+    // zero unless created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+    VkDeviceAddress deviceAddress;
+    VkDeviceSize size;
+    VkBufferUsageFlags usage;
+};
+
+// Vertices are read by the vertex shader through a device address, not through vertex input
+// bindings. uvs are interleaved with position and normal to keep the struct tightly packed,
+// the layout must match Vertex in shaders/mesh.slang.
+struct Vertex {
+    glm::vec3 position;
+    float uvX;
+    glm::vec3 normal;
+    float uvY;
+    glm::vec4 color;
+};
+
+// Per draw constants of shaders/mesh.slang, written to the frame ring buffer.
+struct GPUDrawData {
+    glm::mat4 worldMatrix;
+    // bindless indices, texture is INVALID_BINDLESS_INDEX for draws using only vertex colors
+    uint32_t texture;
+    uint32_t sampler;
+    // TextureStreamer id and full resolution extent the shader reports the mip it wants for
+    uint32_t streamedTexture;
+    uint32_t feedbackBuffer;
+    glm::vec2 textureSize;
+};
+
+// Push constants of shaders/mesh.slang, fits in BindlessHeap::PUSH_CONSTANT_SIZE.
+struct GPUDrawPushConstants {
+    VkDeviceAddress drawData;
+    VkDeviceAddress vertexBuffer;
+};
+
 struct AllocatedImage {
     VkImage image;
     VkImageView imageView;
     VmaAllocation allocation;
     VkExtent3D imageExtent;
     VkFormat imageFormat;
+    uint32_t mipLevels = 1;
+};
+
+// How a subresource was last used: its layout plus the stages and accesses since its last
+// layout change or write, which the next barrier has to wait on.
+struct ImageAccess {
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 access = VK_ACCESS_2_NONE;
 };
\ No newline at end of file
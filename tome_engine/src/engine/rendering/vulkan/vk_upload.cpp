@@ -0,0 +1,218 @@
+#include "vk_upload.h"
+
+#include <algorithm>
+
+#include "vk_initializers.h"
+
+static VkImageMemoryBarrier2 UploadBarrier(const ImageUpload &upload) {
+    VkImageMemoryBarrier2 barrier = { .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = upload.image.image;
+    barrier.subresourceRange = vk::ImageSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
+    barrier.subresourceRange.levelCount = upload.image.mipLevels;
+    return barrier;
+}
+
+// Layout the copy leaves the image in, mips are generated from TRANSFER_DST_OPTIMAL on the graphics queue.
+static VkImageLayout CopiedLayout(const ImageUpload &upload) {
+    return upload.generateMips ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+}
+
+static void PipelineBarrier(VkCommandBuffer cmd, std::span<const VkImageMemoryBarrier2> barriers) {
+    VkDependencyInfo depInfo = {};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size());
+    depInfo.pImageMemoryBarriers = barriers.data();
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+}
+
+void UploadQueue::Init(VkDevice device,
+    VmaAllocator allocator,
+    VkQueue transferQueue,
+    uint32_t transferQueueFamily,
+    uint32_t graphicsQueueFamily,
+    MipGenerator &mipGenerator) {
+    _device = device;
+    _allocator = allocator;
+    _transferQueue = transferQueue;
+    _transferQueueFamily = transferQueueFamily;
+    _graphicsQueueFamily = graphicsQueueFamily;
+    _mipGenerator = &mipGenerator;
+
+    VkCommandPoolCreateInfo commandPoolCreateInfo = vk::CommanPollCreateInfo(_transferQueueFamily,
+        VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    VK_CHECK(vkCreateCommandPool(_device, &commandPoolCreateInfo, nullptr, &_commandPool));
+}
+
+void UploadQueue::Cleanup() {
+    auto destroyUpload = [this](const ImageUpload &upload) {
+        vmaDestroyBuffer(_allocator, upload.staging.buffer, upload.staging.allocation);
+        vkDestroyImageView(_device, upload.image.imageView, nullptr);
+        vmaDestroyImage(_allocator, upload.image.image, upload.image.allocation);
+    };
+
+    for (const ImageUpload &upload : _queued) {
+        destroyUpload(upload);
+    }
+    _queued.clear();
+
+    for (Batch &batch : _inFlight) {
+        for (const ImageUpload &upload : batch.uploads) {
+            destroyUpload(upload);
+        }
+        batch.uploads.clear();
+        _freeBatches.push_back(std::move(batch));
+    }
+    _inFlight.clear();
+
+    for (const Batch &batch : _freeBatches) {
+        vkDestroyFence(_device, batch.fence, nullptr);
+    }
+    _freeBatches.clear();
+
+    vkDestroyCommandPool(_device, _commandPool, nullptr);
+}
+
+void UploadQueue::Enqueue(ImageUpload &&upload) {
+    std::lock_guard lock(_queuedMutex);
+    _queued.push_back(std::move(upload));
+}
+
+void UploadQueue::Update(VkCommandBuffer cmd) {
+    for (auto it = _inFlight.begin(); it != _inFlight.end();) {
+        if (vkGetFenceStatus(_device, it->fence) != VK_SUCCESS || !CanComplete(*it)) {
+            ++it;
+            continue;
+        }
+        Complete(*it, cmd);
+        _freeBatches.push_back(std::move(*it));
+        it = _inFlight.erase(it);
+    }
+
+    std::vector<ImageUpload> uploads;
+    {
+        std::lock_guard lock(_queuedMutex);
+        uploads.swap(_queued);
+    }
+    if (!uploads.empty()) {
+        Submit(std::move(uploads));
+    }
+}
+
+void UploadQueue::Submit(std::vector<ImageUpload> &&uploads) {
+    Batch batch;
+    if (!_freeBatches.empty()) {
+        batch = std::move(_freeBatches.back());
+        _freeBatches.pop_back();
+        VK_CHECK(vkResetFences(_device, 1, &batch.fence));
+        VK_CHECK(vkResetCommandBuffer(batch.cmd, 0));
+    } else {
+        VkCommandBufferAllocateInfo allocateInfo = vk::CommandBufferAllocateInfo(_commandPool);
+        VK_CHECK(vkAllocateCommandBuffers(_device, &allocateInfo, &batch.cmd));
+
+        VkFenceCreateInfo fenceCreateInfo = vk::FenceCreateInfo();
+        VK_CHECK(vkCreateFence(_device, &fenceCreateInfo, nullptr, &batch.fence));
+    }
+    batch.uploads = std::move(uploads);
+
+    const VkCommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    VK_CHECK(vkBeginCommandBuffer(batch.cmd, &beginInfo));
+
+    std::vector<VkImageMemoryBarrier2> barriers;
+    barriers.reserve(batch.uploads.size());
+    for (const ImageUpload &upload : batch.uploads) {
+        VkImageMemoryBarrier2 barrier = UploadBarrier(upload);
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+        barrier.srcAccessMask = VK_ACCESS_2_NONE;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers.push_back(barrier);
+    }
+    PipelineBarrier(batch.cmd, barriers);
+
+    for (const ImageUpload &upload : batch.uploads) {
+        vkCmdCopyBufferToImage(batch.cmd,
+            upload.staging.buffer,
+            upload.image.image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(upload.regions.size()),
+            upload.regions.data());
+    }
+
+    // on a separate family this is the release half of the ownership transfer, stages and
+    // accesses after it belong to the acquire barrier recorded on the graphics queue
+    barriers.clear();
+    for (const ImageUpload &upload : batch.uploads) {
+        VkImageMemoryBarrier2 barrier = UploadBarrier(upload);
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = CopiedLayout(upload);
+        if (HasDedicatedQueue()) {
+            barrier.srcQueueFamilyIndex = _transferQueueFamily;
+            barrier.dstQueueFamilyIndex = _graphicsQueueFamily;
+            barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+            barrier.dstAccessMask = VK_ACCESS_2_NONE;
+        } else if (upload.generateMips) {
+            barrier.dstStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+            barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        } else {
+            barrier.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+            barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        }
+        barriers.push_back(barrier);
+    }
+    PipelineBarrier(batch.cmd, barriers);
+
+    VK_CHECK(vkEndCommandBuffer(batch.cmd));
+
+    VkCommandBufferSubmitInfo cmdSubmitInfo = vk::CommandBufferSubmitInfo(batch.cmd);
+    VkSubmitInfo2 submit = vk::SubmitInfo(&cmdSubmitInfo, nullptr, nullptr);
+    VK_CHECK(vkQueueSubmit2(_transferQueue, 1, &submit, batch.fence));
+
+    _inFlight.push_back(std::move(batch));
+}
+
+bool UploadQueue::CanComplete(const Batch &batch) const {
+    return std::ranges::all_of(batch.uploads, [this](const ImageUpload &upload) {
+        return !upload.generateMips || _mipGenerator->IsReady(upload.image.imageFormat);
+    });
+}
+
+void UploadQueue::Complete(Batch &batch, VkCommandBuffer cmd) {
+    if (HasDedicatedQueue()) {
+        std::vector<VkImageMemoryBarrier2> barriers;
+        barriers.reserve(batch.uploads.size());
+        for (const ImageUpload &upload : batch.uploads) {
+            VkImageMemoryBarrier2 barrier = UploadBarrier(upload);
+            barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+            barrier.srcAccessMask = VK_ACCESS_2_NONE;
+            barrier.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+            barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+            if (upload.generateMips) {
+                barrier.dstStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+                barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+            }
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = CopiedLayout(upload);
+            barrier.srcQueueFamilyIndex = _transferQueueFamily;
+            barrier.dstQueueFamilyIndex = _graphicsQueueFamily;
+            barriers.push_back(barrier);
+        }
+        PipelineBarrier(cmd, barriers);
+    }
+
+    for (ImageUpload &upload : batch.uploads) {
+        vmaDestroyBuffer(_allocator, upload.staging.buffer, upload.staging.allocation);
+        if (upload.generateMips) {
+            _mipGenerator->Generate(cmd, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        }
+        if (upload.onComplete) {
+            upload.onComplete(upload.image);
+        }
+    }
+    batch.uploads.clear();
+}
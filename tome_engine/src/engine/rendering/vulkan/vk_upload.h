@@ -0,0 +1,75 @@
+#pragma once
+
+#include <mutex>
+
+#include "vk_mipmaps.h"
+#include "vk_types.h"
+
+// Copy of a filled staging buffer into the mip levels of an image. staging and image are handed
+// over to the UploadQueue, onComplete runs on the render thread once the image can be sampled
+// (in SHADER_READ_ONLY_OPTIMAL) and takes back ownership of image. The staging buffer is freed.
+//
+// With generateMips the regions only fill level 0 and the other levels are generated on the
+// graphics queue before onComplete, see MipGenerator for the usage flags the image needs.
+struct ImageUpload {
+    AllocatedImage image;
+    bool generateMips = false;
+    AllocatedBuffer staging;
+    std::vector<VkBufferImageCopy> regions;
+    std::function<void(const AllocatedImage &image)> onComplete;
+};
+
+// Staging uploads on a dedicated transfer queue, falling back to the graphics queue when the
+// device has none. Uploads can be enqueued from any thread, everything else runs on the render
+// thread: Update submits what was enqueued since the last frame as one batch and completes the
+// batches whose fence signaled, without ever waiting on the gpu.
+//
+// With a separate transfer family the batch releases its images to the graphics family and
+// Update records the matching acquire barriers into the frame's command buffer.
+class UploadQueue {
+public:
+    void Init(VkDevice device,
+        VmaAllocator allocator,
+        VkQueue transferQueue,
+        uint32_t transferQueueFamily,
+        uint32_t graphicsQueueFamily,
+        MipGenerator &mipGenerator);
+
+    // Destroys whatever has not completed, the device must be idle.
+    void Cleanup();
+
+    // Thread safe.
+    void Enqueue(ImageUpload &&upload);
+
+    // Render thread, once per frame with cmd recording on the graphics queue.
+    void Update(VkCommandBuffer cmd);
+
+    bool HasDedicatedQueue() const { return _transferQueueFamily != _graphicsQueueFamily; }
+
+private:
+    struct Batch {
+        VkCommandBuffer cmd = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        std::vector<ImageUpload> uploads;
+    };
+
+    VkDevice _device = VK_NULL_HANDLE;
+    VmaAllocator _allocator = nullptr;
+    VkQueue _transferQueue = VK_NULL_HANDLE;
+    uint32_t _transferQueueFamily = 0;
+    uint32_t _graphicsQueueFamily = 0;
+    MipGenerator *_mipGenerator = nullptr;
+    VkCommandPool _commandPool = VK_NULL_HANDLE;
+
+    std::mutex _queuedMutex;
+    std::vector<ImageUpload> _queued;
+
+    std::vector<Batch> _inFlight;
+    // command buffers and fences of completed batches, ready for reuse
+    std::vector<Batch> _freeBatches;
+
+    void Submit(std::vector<ImageUpload> &&uploads);
+    // False while a mip generation pipeline the batch needs is still compiling.
+    bool CanComplete(const Batch &batch) const;
+    void Complete(Batch &batch, VkCommandBuffer cmd);
+};
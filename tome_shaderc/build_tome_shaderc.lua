@@ -0,0 +1,59 @@
+project "tome_shaderc"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++20"
+   targetdir "binaries/%{cfg.buildcfg}"
+   staticruntime "off"
+
+   files {
+      "src/**.h",
+      "src/**.cpp",
+      "../tome_engine/src/engine/rendering/vulkan/vk_shader_archive.h",
+      "../tome_engine/src/engine/rendering/vulkan/vk_slang.h",
+   }
+
+   includedirs
+   {
+      "src",
+
+	  -- archive format and slang helpers are shared with the engine
+	  "../tome_engine/src",
+
+	  "$(VULKAN_SDK)/include",
+	  "../tome_engine/third_party/spdlog/include",
+	  "../tome_engine/third_party/vma/include",
+	  "../tome_engine/third_party/glm",
+   }
+
+   links
+   {
+      "spdlog",
+      "$(VULKAN_SDK)/lib/slang"
+   }
+
+   targetdir ("../binaries/" .. OutputDir .. "/%{prj.name}")
+   objdir ("../binaries/intermediates/" .. OutputDir .. "/%{prj.name}")
+
+   filter "system:windows"
+       systemversion "latest"
+       defines { "WINDOWS" }
+       buildoptions {
+           "/utf-8"
+       }
+
+   filter "configurations:Debug"
+       defines { "DEBUG" }
+       runtime "Debug"
+       symbols "On"
+
+   filter "configurations:Release"
+       defines { "RELEASE" }
+       runtime "Release"
+       optimize "On"
+       symbols "On"
+
+   filter "configurations:Dist"
+       defines { "DIST" }
+       runtime "Release"
+       optimize "On"
+       symbols "Off"
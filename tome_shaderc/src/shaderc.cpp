@@ -0,0 +1,299 @@
+// tome_shaderc: compiles every .slang module under a directory into a single shader archive
+// (see vk_shader_archive.h) that Dist builds map at runtime instead of running Slang.
+//
+// usage: tome_shaderc <shader directory> <output archive>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+
+#include "engine/rendering/vulkan/vk_shader_archive.h"
+#include "engine/rendering/vulkan/vk_slang.h"
+
+#include "slang/slang.h"
+#include "slang/slang-com-ptr.h"
+
+namespace fs = std::filesystem;
+
+struct CompiledEntryPoint {
+    std::string moduleName;
+    std::string entryPointName;
+    ShaderArchiveEntry entry = {};
+    std::vector<ShaderArchiveBinding> bindings;
+    Slang::ComPtr<slang::IBlob> spirvCode;
+};
+
+class StringTable {
+public:
+    uint32_t Add(const std::string &string) {
+        if (auto it = _offsets.find(string); it != _offsets.end()) {
+            return it->second;
+        }
+        const auto offset = static_cast<uint32_t>(_data.size());
+        _data.insert(_data.end(), string.begin(), string.end());
+        _data.push_back('\0');
+        _offsets.emplace(string, offset);
+        return offset;
+    }
+
+    const std::vector<char> &GetData() const { return _data; }
+
+private:
+    std::vector<char> _data;
+    std::unordered_map<std::string, uint32_t> _offsets;
+};
+
+static void LogDiagnostics(slang::IBlob *diagnosticsBlob) {
+    if (diagnosticsBlob) {
+        spdlog::error("shader diagnostic: {}", static_cast<const char *>(diagnosticsBlob->getBufferPointer()));
+    }
+}
+
+static void CollectParameter(slang::VariableLayoutReflection *parameter,
+    bool entryPointParameter,
+    ShaderArchiveEntry &entry,
+    std::vector<ShaderArchiveBinding> &bindings) {
+    slang::TypeLayoutReflection *typeLayout = parameter->getTypeLayout();
+
+    switch (parameter->getCategory()) {
+        case slang::ParameterCategory::DescriptorTableSlot: {
+            if (typeLayout->getBindingRangeCount() == 0) break;
+            bindings.push_back({
+                .set = static_cast<uint32_t>(parameter->getBindingSpace()),
+                .binding = static_cast<uint32_t>(parameter->getBindingIndex()),
+                .descriptorType = static_cast<uint32_t>(vk::ToDescriptorType(typeLayout->getBindingRangeType(0))),
+                .descriptorCount = static_cast<uint32_t>(typeLayout->getBindingRangeBindingCount(0)) });
+            break;
+        }
+        case slang::ParameterCategory::PushConstantBuffer:
+            entry.pushConstantSize += static_cast<uint32_t>(typeLayout->getElementTypeLayout()->getSize());
+            break;
+        case slang::ParameterCategory::Uniform:
+            // plain data entry point parameters are lowered to push constants, loose globals go to
+            // the default uniform buffer, recorded once per program by the caller
+            if (entryPointParameter) {
+                entry.pushConstantSize += static_cast<uint32_t>(typeLayout->getSize());
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static bool CompileModule(slang::ISession *session,
+    const fs::path &relativePath,
+    std::vector<CompiledEntryPoint> &compiledEntryPoints) {
+    const std::string modulePath = relativePath.generic_string();
+    const std::string moduleName = fs::path(relativePath).replace_extension().generic_string();
+
+    Slang::ComPtr<slang::IBlob> diagnosticsBlob;
+    slang::IModule *slangModule = session->loadModule(modulePath.c_str(), diagnosticsBlob.writeRef());
+    LogDiagnostics(diagnosticsBlob);
+    if (!slangModule) {
+        spdlog::error("{}: failed to load", modulePath);
+        return false;
+    }
+
+    const SlangInt32 entryPointCount = slangModule->getDefinedEntryPointCount();
+    if (entryPointCount == 0) {
+        // modules without entry points are only imported by other modules
+        return true;
+    }
+
+    std::vector<Slang::ComPtr<slang::IEntryPoint>> entryPoints(entryPointCount);
+    std::vector<slang::IComponentType *> componentTypes = { slangModule };
+    for (SlangInt32 i = 0; i < entryPointCount; i++) {
+        slangModule->getDefinedEntryPoint(i, entryPoints[i].writeRef());
+        componentTypes.push_back(entryPoints[i]);
+    }
+
+    Slang::ComPtr<slang::IComponentType> composedProgram;
+    session->createCompositeComponentType(componentTypes.data(),
+        static_cast<SlangInt>(componentTypes.size()),
+        composedProgram.writeRef(),
+        diagnosticsBlob.writeRef());
+    LogDiagnostics(diagnosticsBlob);
+
+    Slang::ComPtr<slang::IComponentType> linkedProgram;
+    if (!composedProgram || SLANG_FAILED(composedProgram->link(linkedProgram.writeRef(), diagnosticsBlob.writeRef()))) {
+        LogDiagnostics(diagnosticsBlob);
+        spdlog::error("{}: failed to link", modulePath);
+        return false;
+    }
+
+    slang::ProgramLayout *programLayout = linkedProgram->getLayout(0, diagnosticsBlob.writeRef());
+    if (!programLayout) {
+        LogDiagnostics(diagnosticsBlob);
+        return false;
+    }
+
+    for (SlangInt32 i = 0; i < entryPointCount; i++) {
+        CompiledEntryPoint compiled;
+        compiled.moduleName = moduleName;
+
+        if (SLANG_FAILED(linkedProgram->getEntryPointCode(i, 0, compiled.spirvCode.writeRef(), diagnosticsBlob.writeRef()))) {
+            LogDiagnostics(diagnosticsBlob);
+            spdlog::error("{}: failed to generate code for entry point {}", modulePath, i);
+            return false;
+        }
+
+        slang::EntryPointReflection *entryPointLayout = programLayout->getEntryPointByIndex(i);
+        compiled.entryPointName = entryPointLayout->getName();
+        compiled.entry.stage = static_cast<uint32_t>(vk::ToShaderStage(entryPointLayout->getStage()));
+
+        SlangUInt threadGroupSize[3] = { 1, 1, 1 };
+        entryPointLayout->getComputeThreadGroupSize(3, threadGroupSize);
+        for (int axis = 0; axis < 3; axis++) {
+            compiled.entry.threadGroupSize[axis] = static_cast<uint32_t>(threadGroupSize[axis]);
+        }
+
+        for (unsigned p = 0; p < programLayout->getParameterCount(); p++) {
+            CollectParameter(programLayout->getParameterByIndex(p), false, compiled.entry, compiled.bindings);
+        }
+        if (programLayout->getGlobalConstantBufferSize() > 0) {
+            compiled.bindings.push_back({
+                .set = 0,
+                .binding = static_cast<uint32_t>(programLayout->getGlobalConstantBufferBinding()),
+                .descriptorType = static_cast<uint32_t>(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER),
+                .descriptorCount = 1 });
+        }
+        for (unsigned p = 0; p < entryPointLayout->getParameterCount(); p++) {
+            CollectParameter(entryPointLayout->getParameterByIndex(p), true, compiled.entry, compiled.bindings);
+        }
+
+        spdlog::info("{}:{} ({} bytes)", moduleName, compiled.entryPointName, compiled.spirvCode->getBufferSize());
+        compiledEntryPoints.push_back(std::move(compiled));
+    }
+
+    return true;
+}
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static bool WriteArchive(const fs::path &outputPath, std::vector<CompiledEntryPoint> &compiledEntryPoints) {
+    StringTable strings;
+    std::vector<ShaderArchiveEntry> entries;
+    std::vector<ShaderArchiveBinding> bindings;
+
+    for (CompiledEntryPoint &compiled : compiledEntryPoints) {
+        ShaderArchiveEntry entry = compiled.entry;
+        entry.moduleNameOffset = strings.Add(compiled.moduleName);
+        entry.entryPointNameOffset = strings.Add(compiled.entryPointName);
+        entry.firstBinding = static_cast<uint32_t>(bindings.size());
+        entry.bindingCount = static_cast<uint32_t>(compiled.bindings.size());
+        entry.codeSize = compiled.spirvCode->getBufferSize();
+        bindings.insert(bindings.end(), compiled.bindings.begin(), compiled.bindings.end());
+        entries.push_back(entry);
+    }
+
+    ShaderArchiveHeader header = {};
+    header.magic = SHADER_ARCHIVE_MAGIC;
+    header.version = SHADER_ARCHIVE_VERSION;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.bindingCount = static_cast<uint32_t>(bindings.size());
+    header.entriesOffset = sizeof(ShaderArchiveHeader);
+    header.bindingsOffset = header.entriesOffset + entries.size() * sizeof(ShaderArchiveEntry);
+    header.stringsOffset = header.bindingsOffset + bindings.size() * sizeof(ShaderArchiveBinding);
+    header.stringsSize = strings.GetData().size();
+
+    uint64_t codeOffset = header.stringsOffset + header.stringsSize;
+    for (ShaderArchiveEntry &entry : entries) {
+        codeOffset = AlignUp(codeOffset, SHADER_ARCHIVE_ALIGNMENT);
+        entry.codeOffset = codeOffset;
+        codeOffset += entry.codeSize;
+    }
+
+    fs::create_directories(outputPath.parent_path());
+    std::ofstream file(outputPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        spdlog::error("failed to open {} for writing", outputPath.string());
+        return false;
+    }
+
+    auto writeBytes = [&file](const void *data, uint64_t size) {
+        file.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+    };
+
+    writeBytes(&header, sizeof(header));
+    writeBytes(entries.data(), entries.size() * sizeof(ShaderArchiveEntry));
+    writeBytes(bindings.data(), bindings.size() * sizeof(ShaderArchiveBinding));
+    writeBytes(strings.GetData().data(), strings.GetData().size());
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        const uint64_t padding = entries[i].codeOffset - static_cast<uint64_t>(file.tellp());
+        const std::array<char, SHADER_ARCHIVE_ALIGNMENT> zeros = {};
+        writeBytes(zeros.data(), padding);
+        writeBytes(compiledEntryPoints[i].spirvCode->getBufferPointer(), entries[i].codeSize);
+    }
+
+    return file.good();
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        spdlog::error("usage: tome_shaderc <shader directory> <output archive>");
+        return 1;
+    }
+
+    const fs::path shaderDirectory = argv[1];
+    const fs::path outputPath = argv[2];
+
+    using namespace slang;
+
+    Slang::ComPtr<IGlobalSession> globalSession;
+    createGlobalSession(globalSession.writeRef());
+
+    // keep in sync with Engine::InitShaderCompiler
+    SessionDesc sessionDesc = {};
+
+    TargetDesc targetDesc = {};
+    targetDesc.format = SLANG_SPIRV;
+    targetDesc.profile = globalSession->findProfile("spirv_1_5");
+    targetDesc.flags = 0;
+
+    const std::string searchPath = shaderDirectory.generic_string();
+    const char *searchPaths[] = { searchPath.c_str() };
+    sessionDesc.searchPaths = searchPaths;
+    sessionDesc.searchPathCount = 1;
+
+    sessionDesc.targets = &targetDesc;
+    sessionDesc.targetCount = 1;
+
+    std::vector<CompilerOptionEntry> compilerOptions;
+    compilerOptions.push_back({ .name = CompilerOptionName::EmitSpirvDirectly,
+                                .value = {
+                                    .kind = CompilerOptionValueKind::Int, .intValue0 = 1, .intValue1 = 0,
+                                    .stringValue0 = nullptr,
+                                    .stringValue1 = nullptr } });
+    sessionDesc.compilerOptionEntries = compilerOptions.data();
+    sessionDesc.compilerOptionEntryCount = static_cast<uint32_t>(compilerOptions.size());
+
+    Slang::ComPtr<ISession> session;
+    globalSession->createSession(sessionDesc, session.writeRef());
+
+    // sort so the archive is byte for byte reproducible
+    std::vector<fs::path> modulePaths;
+    for (const auto &directoryEntry : fs::recursive_directory_iterator(shaderDirectory)) {
+        if (directoryEntry.is_regular_file() && directoryEntry.path().extension() == ".slang") {
+            modulePaths.push_back(fs::relative(directoryEntry.path(), shaderDirectory));
+        }
+    }
+    std::sort(modulePaths.begin(), modulePaths.end());
+
+    std::vector<CompiledEntryPoint> compiledEntryPoints;
+    for (const fs::path &modulePath : modulePaths) {
+        if (!CompileModule(session, modulePath, compiledEntryPoints)) {
+            return 1;
+        }
+    }
+
+    if (!WriteArchive(outputPath, compiledEntryPoints)) {
+        return 1;
+    }
+
+    spdlog::info("wrote {} entry points to {}", compiledEntryPoints.size(), outputPath.string());
+    return 0;
+}